@@ -1,20 +1,146 @@
 #pragma once
+#include <sched.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <bit>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <format>
+#include <fstream>
 #include <iostream>
 #include <limits>
 #include <numeric>
 #include <optional>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include <boost/json.hpp>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
 using BenchTiming = std::vector<double>; // milliseconds
 using ChronoUnit = std::chrono::duration<double, std::milli>;
 
+/// event name and count
+using BenchEvents = std::vector<std::pair<std::string, double>>;
+
+/// hardware performance counters of the calling thread
+/// \details
+///    uses perf_event_open on Linux. Events that cannot be opened
+///    (e.g., inside containers, on virtual machines without a PMU, or
+///    due to perf_event_paranoid) are skipped; if none can be opened,
+///    available() returns false and totals() is empty.
+///    Only user-space events are counted.
+class PerfCounters {
+public:
+  PerfCounters() {
+#if defined(__linux__)
+    struct event {
+      const char *name;
+      std::uint32_t type;
+      std::uint64_t config;
+    };
+
+    constexpr std::uint64_t READ_MISS = (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    const event events[] = {
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {"L1d-misses", PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_L1D | READ_MISS},
+        {"LLC-misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | READ_MISS},
+        {"dTLB-misses", PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_DTLB | READ_MISS},
+    };
+
+    for (const event &ev : events) {
+      perf_event_attr attr;
+
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = ev.type;
+      attr.config = ev.config;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format =
+          PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      const int fd = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+
+      if (fd >= 0)
+        counters.push_back({ev.name, fd, 0});
+    }
+#endif
+  }
+
+  ~PerfCounters() {
+    for (const counter &ctr : counters)
+      close(ctr.fd);
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  bool available() const { return !counters.empty(); }
+
+  /// resets and enables the counters
+  void start() {
+#if defined(__linux__)
+    for (const counter &ctr : counters) {
+      ioctl(ctr.fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(ctr.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  /// disables the counters and adds their values to the totals
+  void stop() {
+#if defined(__linux__)
+    for (counter &ctr : counters)
+      ioctl(ctr.fd, PERF_EVENT_IOC_DISABLE, 0);
+
+    for (counter &ctr : counters) {
+      std::uint64_t vals[3] = {0, 0, 0}; // value, enabled, running
+
+      if (read(ctr.fd, vals, sizeof(vals)) != sizeof(vals) || vals[2] == 0)
+        continue;
+
+      // scale multiplexed counters to the enabled time
+      ctr.total += double(vals[0]) * double(vals[1]) / double(vals[2]);
+    }
+#endif
+  }
+
+  BenchEvents totals() const {
+    BenchEvents res;
+
+    for (const counter &ctr : counters)
+      res.emplace_back(ctr.name, ctr.total);
+
+    return res;
+  }
+
+private:
+  struct counter {
+    const char *name;
+    int fd;
+    double total;
+  };
+
+  std::vector<counter> counters;
+};
+
 class BenchmarkResult {
 public:
   BenchmarkResult() = default;
@@ -48,8 +174,20 @@ public:
         "n_runs: {}, ttl: {:.3f} ms, min: {:.3f} ms, "
         "max: {:.3f} ms, mean: {:.3f} ms, std: {:.3f} ms\n",
         timing.size(), sum, timing[0], timing[timing.size() - 1], mean, stddev);
+
+    if (events.empty())
+      return;
+
+    std::cout << "  per eval:";
+    for (const auto &[event, count] : events)
+      std::cout << std::format(" {}: {:.2f}", event, count);
+    std::cout << "\n";
   }
 
+  /// sets hardware event counts per evaluation
+  void set_events(BenchEvents per_eval) { events = std::move(per_eval); }
+  const BenchEvents &events_per_eval() const { return events; }
+
   std::optional<double> compare_ratio(const BenchmarkResult &other) const {
     if (timing.empty() || other.timing.empty()) {
       std::cerr << "No timing data available for comparison.\n";
@@ -84,12 +222,41 @@ public:
                              other.name, name, relation, rat);
   }
 
+  const std::string &label() const { return name; }
+  const BenchTiming &timings() const { return timing; }
+  double mean_time() const { return mean; }
+  double min_time() const { return timing.empty() ? 0 : timing.front(); }
+
+  boost::json::object to_json() const {
+    boost::json::object res;
+
+    res["name"] = name;
+    res["kind"] = "runs";
+    res["n_runs"] = timing.size();
+    res["mean_ms"] = mean;
+    res["min_ms"] = min_time();
+    res["max_ms"] = timing.empty() ? 0 : timing.back();
+    res["stddev_ms"] = stddev;
+
+    if (!events.empty()) {
+      boost::json::object per_eval;
+
+      for (const auto &[event, count] : events)
+        per_eval[event] = count;
+
+      res["events_per_eval"] = std::move(per_eval);
+    }
+
+    return res;
+  }
+
 private:
   std::string name;
   BenchTiming timing;
   double sum = 0;
   double mean = 0;
   double stddev = 0;
+  BenchEvents events;
 };
 
 template <typename F> class Benchmark {
@@ -97,25 +264,366 @@ public:
   Benchmark(std::string name, F func, ChronoUnit addl_time = ChronoUnit{0})
       : name(std::move(name)), func(func), addl_time(addl_time) {}
 
+  /// sets the number of untimed runs before the timed runs
+  Benchmark &warmup(size_t n_runs) {
+    warmup_runs = n_runs;
+    return *this;
+  }
+
+  /// counts hardware events around each timed run and reports them
+  ///   per evaluation; a run performs \p n_evals evaluations.
+  Benchmark &count_events(size_t n_evals) {
+    evals_per_run = n_evals;
+    return *this;
+  }
+
   BenchmarkResult run(size_t n_runs, auto &&...args) {
     BenchTiming timings;
+    std::optional<PerfCounters> perf;
+
+    if (evals_per_run)
+      perf.emplace();
+
     std::cout << "Running Benchmark " << name << ": " << n_runs << "\n";
+    for (size_t i = 0; i < warmup_runs; ++i)
+      func(args...);
+
     for (size_t i = 0; i < n_runs; ++i) {
+      if (perf)
+        perf->start();
+
       std::chrono::steady_clock::time_point start =
           std::chrono::steady_clock::now();
       func(args...);
       std::chrono::steady_clock::time_point end =
           std::chrono::steady_clock::now();
 
+      if (perf)
+        perf->stop();
+
       ChronoUnit elapsed = end - start + addl_time;
       timings.push_back(elapsed.count());
     }
     std::ranges::sort(timings);
-    return BenchmarkResult{name, timings};
+
+    BenchmarkResult res{name, timings};
+
+    if (perf && perf->available() && n_runs) {
+      BenchEvents events = perf->totals();
+
+      for (auto &[event, count] : events)
+        count /= double(n_runs * evals_per_run);
+
+      res.set_events(std::move(events));
+    } else if (perf) {
+      std::cout << "  hardware counters unavailable\n";
+    }
+
+    return res;
   }
 
 private:
   std::string name;
   F func;
   ChronoUnit addl_time;
+  size_t warmup_runs = 0;
+  size_t evals_per_run = 0;
+};
+
+/// log-linear histogram of latencies in nanoseconds (HDR-style)
+/// \details
+///    values below 2^SUB_BITS are recorded exactly; larger values are
+///    recorded in 2^SUB_BITS sub-buckets per power of two, i.e., with a
+///    relative error below 2^-SUB_BITS (1.6%).
+class LatencyHistogram {
+public:
+  static constexpr int SUB_BITS = 6;
+  static constexpr std::uint64_t SUB_BUCKETS = std::uint64_t(1) << SUB_BITS;
+
+  void record(std::uint64_t ns) {
+    ++counts[bucket(ns)];
+    ++total;
+    sum += ns;
+    largest = std::max(largest, ns);
+  }
+
+  std::uint64_t count() const { return total; }
+  std::uint64_t max() const { return largest; }
+  double mean() const { return total ? double(sum) / double(total) : 0; }
+
+  /// returns the smallest recorded value v such that a fraction
+  ///   \p p (0 < p <= 1) of all values is <= v (within the bucket error)
+  std::uint64_t percentile(double p) const {
+    const auto rank = static_cast<std::uint64_t>(std::ceil(p * double(total)));
+    std::uint64_t seen = 0;
+
+    for (size_t b = 0; b < counts.size(); ++b) {
+      seen += counts[b];
+
+      if (seen >= rank && seen > 0)
+        return std::min(bucket_value(b + 1) - 1, largest);
+    }
+
+    return largest;
+  }
+
+private:
+  static size_t bucket(std::uint64_t v) {
+    if (v < SUB_BUCKETS)
+      return v;
+
+    const int shift = std::bit_width(v) - 1 - SUB_BITS;
+
+    return (shift + 1) * SUB_BUCKETS + ((v >> shift) - SUB_BUCKETS);
+  }
+
+  /// returns the smallest value in bucket \p b
+  static std::uint64_t bucket_value(size_t b) {
+    if (b < SUB_BUCKETS)
+      return b;
+
+    const size_t shift = b / SUB_BUCKETS - 1;
+
+    return ((b % SUB_BUCKETS) + SUB_BUCKETS) << shift;
+  }
+
+  std::vector<std::uint64_t> counts =
+      std::vector<std::uint64_t>((64 - SUB_BITS + 1) * SUB_BUCKETS, 0);
+  std::uint64_t total = 0;
+  std::uint64_t sum = 0;
+  std::uint64_t largest = 0;
+};
+
+/// per-iteration latencies of a benchmark
+class LatencyResult {
+public:
+  LatencyResult(std::string name, LatencyHistogram hist)
+      : name(std::move(name)), hist(std::move(hist)) {}
+
+  void summarize() const {
+    std::cout << std::format(
+        "{}: n: {}, mean: {:.1f} ns, p50: {} ns, p90: {} ns, p99: {} ns, "
+        "p99.9: {} ns, max: {} ns\n",
+        name, hist.count(), hist.mean(), hist.percentile(0.5),
+        hist.percentile(0.9), hist.percentile(0.99), hist.percentile(0.999),
+        hist.max());
+  }
+
+  const std::string &label() const { return name; }
+  const LatencyHistogram &histogram() const { return hist; }
+
+  boost::json::object to_json() const {
+    boost::json::object res;
+
+    res["name"] = name;
+    res["kind"] = "latency";
+    res["count"] = hist.count();
+    res["mean_ns"] = hist.mean();
+    res["p50_ns"] = hist.percentile(0.5);
+    res["p90_ns"] = hist.percentile(0.9);
+    res["p99_ns"] = hist.percentile(0.99);
+    res["p999_ns"] = hist.percentile(0.999);
+    res["max_ns"] = hist.max();
+    return res;
+  }
+
+private:
+  std::string name;
+  LatencyHistogram hist;
+};
+
+/// samples the latency of each call to a function
+/// \details
+///    each iteration is timed separately; the clock overhead
+///    (tens of ns) is included in the samples.
+template <typename F> class LatencyBenchmark {
+public:
+  LatencyBenchmark(std::string name, F func, size_t warmup = 0)
+      : name(std::move(name)), func(func), warmup_iterations(warmup) {}
+
+  LatencyResult run(size_t n_iterations) {
+    using clock = std::chrono::steady_clock;
+
+    LatencyHistogram hist;
+    std::cout << "Running Latency Benchmark " << name << ": " << n_iterations
+              << "\n";
+    for (size_t i = 0; i < warmup_iterations; ++i)
+      func();
+
+    for (size_t i = 0; i < n_iterations; ++i) {
+      const clock::time_point start = clock::now();
+      func();
+      const clock::time_point end = clock::now();
+
+      hist.record(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+              .count());
+    }
+
+    return LatencyResult{name, std::move(hist)};
+  }
+
+private:
+  std::string name;
+  F func;
+  size_t warmup_iterations;
+};
+
+/// pins the calling thread to \p cpu
+/// \return true if successful
+inline bool pin_to_cpu(int cpu) {
+#if defined(__linux__)
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  (void)cpu;
+  return false;
+#endif
+}
+
+/// options shared by all benchmark programs
+struct BenchSettings {
+  size_t warmup = 1;         // untimed runs (or iterations) before timing
+  int cpu = -1;              // cpu to pin to; -1 does not pin
+  bool perf = false;         // counts hardware events, if available
+  std::string json_file;     // writes results as JSON, if set
+  std::string baseline_file; // compares results to a saved JSON, if set
+  double threshold = 10;     // tolerated slowdown vs. the baseline in %
+};
+
+/// extracts the common benchmark options from \p argv
+/// \details
+///    recognizes --warmup N, --cpu K, --perf, --json FILE,
+///    --baseline FILE and --threshold PCT. Recognized options are removed from argv and
+///    argc is updated, so that a program can parse its own arguments
+///    afterwards.
+inline BenchSettings parse_bench_settings(int &argc, const char **argv) {
+  BenchSettings settings;
+  int out = 1;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+
+    if (arg == "--warmup" && has_value)
+      settings.warmup = std::stoul(argv[++i]);
+    else if (arg == "--cpu" && has_value)
+      settings.cpu = std::stoi(argv[++i]);
+    else if (arg == "--perf")
+      settings.perf = true;
+    else if (arg == "--json" && has_value)
+      settings.json_file = argv[++i];
+    else if (arg == "--baseline" && has_value)
+      settings.baseline_file = argv[++i];
+    else if (arg == "--threshold" && has_value)
+      settings.threshold = std::stod(argv[++i]);
+    else
+      argv[out++] = argv[i];
+  }
+
+  argc = out;
+  return settings;
+}
+
+/// collects results, exports them and compares them to a baseline
+class BenchReport {
+public:
+  explicit BenchReport(BenchSettings config) : settings(std::move(config)) {
+    if (settings.cpu >= 0 && !pin_to_cpu(settings.cpu))
+      std::cerr << "Unable to pin to cpu " << settings.cpu << "\n";
+  }
+
+  size_t warmup() const { return settings.warmup; }
+  bool perf() const { return settings.perf; }
+
+  void add(const BenchmarkResult &res) { results.push_back(res.to_json()); }
+  void add(const LatencyResult &res) { results.push_back(res.to_json()); }
+
+  /// writes the JSON report and compares against the baseline
+  /// \return 0, or 1 if a result regressed beyond the threshold
+  int finish() const {
+    if (!settings.json_file.empty()) {
+      std::ofstream os(settings.json_file);
+      boost::json::object report;
+
+      report["results"] = results;
+      os << report << std::endl;
+      if (!os)
+        std::cerr << "Unable to write " << settings.json_file << "\n";
+    }
+
+    if (settings.baseline_file.empty())
+      return 0;
+
+    std::ifstream is(settings.baseline_file);
+    std::stringstream buf;
+
+    buf << is.rdbuf();
+    if (!is)
+      throw std::runtime_error("Failed to open file: " +
+                               settings.baseline_file);
+
+    const boost::json::value baseline = boost::json::parse(buf.str());
+    int regressions = 0;
+
+    for (const boost::json::value &cur : results)
+      regressions += compare(cur.as_object(),
+                             baseline.as_object().at("results").as_array());
+
+    std::cout << std::format("{} regression(s) beyond {:.1f}% of {}\n",
+                             regressions, settings.threshold,
+                             settings.baseline_file);
+    return regressions ? 1 : 0;
+  }
+
+private:
+  static double number(const boost::json::value &val) {
+    return val.is_double() ? val.as_double()
+           : val.is_int64() ? double(val.as_int64())
+                            : double(val.as_uint64());
+  }
+
+  /// compares the metrics of \p cur with its entry in \p baseline
+  /// \return the number of regressed metrics
+  int compare(const boost::json::object &cur,
+              const boost::json::array &baseline) const {
+    const std::string_view name = cur.at("name").as_string();
+    const auto pos = std::ranges::find_if(
+        baseline, [name](const boost::json::value &base) -> bool {
+          return std::string_view(base.as_object().at("name").as_string()) ==
+                 name;
+        });
+
+    if (pos == baseline.end())
+      return 0;
+
+    // tail latency is what matters; the mean for whole runs
+    static constexpr const char *metrics[] = {"mean_ms", "p50_ns", "p99_ns"};
+    const boost::json::object &base = pos->as_object();
+    int regressions = 0;
+
+    for (const char *metric : metrics) {
+      if (!cur.contains(metric) || !base.contains(metric))
+        continue;
+
+      const double now = number(cur.at(metric));
+      const double then = number(base.at(metric));
+      const bool regressed =
+          then > 0 && now > then * (1 + settings.threshold / 100);
+
+      std::cout << std::format("{} {}: {:.3f} vs. {:.3f} baseline ({:+.1f}%){}\n",
+                               name, metric, now, then,
+                               then > 0 ? (now / then - 1) * 100 : 0.0,
+                               regressed ? " REGRESSION" : "");
+      regressions += regressed;
+    }
+
+    return regressions;
+  }
+
+  BenchSettings settings;
+  boost::json::array results;
 };
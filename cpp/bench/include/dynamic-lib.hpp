@@ -0,0 +1,89 @@
+#pragma once
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace experimental {
+
+/// a shared object loaded with dlopen
+struct dynamic_lib {
+  explicit dynamic_lib(const char *dllname)
+      : handle(dlopen(dllname, RTLD_LAZY)) {
+    if (handle == nullptr)
+      throw std::runtime_error{std::string{"Unable to load shared object: "} +
+                               dlerror()};
+  }
+
+  ~dynamic_lib() {
+    if (handle != nullptr)
+      dlclose(handle);
+  }
+
+  dynamic_lib(dynamic_lib &&other) noexcept {
+    std::swap(this->handle, other.handle);
+  }
+
+  dynamic_lib &operator=(dynamic_lib &&other) noexcept {
+    std::swap(this->handle, other.handle);
+    return *this;
+  }
+
+  template <class FnType> FnType function(const char *name) const {
+    return (FnType)(dlsym(handle, name));
+  }
+
+  dynamic_lib() = delete;
+  dynamic_lib(const dynamic_lib &) = delete;
+  dynamic_lib &operator=(const dynamic_lib &) = delete;
+
+private:
+  void *handle = nullptr;
+};
+
+/// compiles \p code into the shared object \p libname (in the current
+///   directory) and loads it
+/// \param flags additional compiler flags, e.g. include directories
+inline dynamic_lib compile_and_load(const std::string &code,
+                                    const std::string &libname,
+                                    const std::string &flags = "") {
+  // Step 1: Write code to a temporary file.
+  char template_name[] = "/tmp/temp_XXXXXX.cpp";
+  int fd = mkstemps(template_name, 4);
+  if (fd == -1) {
+    throw std::runtime_error("Failed to create temporary source file");
+  }
+  ssize_t written = write(fd, code.c_str(), code.length());
+  close(fd);
+
+  if (written != static_cast<ssize_t>(code.length())) {
+    std::remove(template_name); // Clean up on failure
+    throw std::runtime_error("Failed to write to temporary source file");
+  }
+
+  // Step 2: Compile the source file into a shared object
+  std::string compileCommand =
+      "g++ -Wall -Wextra -O3 -march=native -std=c++20 -shared -fPIC " +
+      flags + " -o " + libname + " " + template_name;
+
+  std::cerr << compileCommand << std::endl;
+
+  int compileResult = std::system(compileCommand.c_str());
+  if (compileResult != 0)
+    throw std::runtime_error{"Compilation failed."};
+
+  std::remove(template_name);
+
+  std::filesystem::path currentPath = std::filesystem::current_path();
+  std::string fullPath = currentPath / libname;
+  return dynamic_lib{fullPath.c_str()};
+}
+
+} // namespace experimental
@@ -0,0 +1,474 @@
+#pragma once
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/json.hpp>
+
+/// thrown when a rule cannot be translated into native code
+struct native_unsupported : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+/// generates a native C++ predicate that is equivalent to a JSONLogic rule
+/// \details
+///    variables are statically typed with benchmark-generic's type codes:
+///    'i' = int, 'd' = double, 's' = string, 'b' = bool.
+///    The generated function has C linkage and the signature
+///      std::size_t fn(std::size_t n, const void *const *columns)
+///    It counts the rows for which the rule is truthy. columns[k] points
+///    to the column of the k-th variable, stored as std::int64_t, double,
+///    std::string_view, or unsigned char (for bool).
+///
+///    Supported are variables, number, string and bool literals, ==, !=,
+///    ===, !==, <, <=, >, >=, and, or, !, !!, if, +, -, *, /, %, min, max,
+///    and in (with a literal array or a string). Combinations that
+///    require JSONLogic's dynamic type conversions (e.g., comparing
+///    strings with numbers, arithmetic on booleans) are not supported
+///    and raise native_unsupported.
+class NativeRuleGenerator {
+public:
+  NativeRuleGenerator(std::vector<std::string> names, std::vector<char> types)
+      : var_names(std::move(names)), var_types(std::move(types)) {}
+
+  /// returns the source code of the function \p fnname computing \p rule
+  std::string generate(const boost::json::value &rule,
+                       const std::string &fnname) {
+    const term body = truthy(gen(rule));
+    std::string code = PRELUDE;
+
+    code += std::format("extern \"C\" std::size_t {}(std::size_t n, "
+                        "const void *const *columns) {{\n",
+                        fnname);
+
+    for (std::size_t k = 0; k < var_types.size(); ++k)
+      code += std::format("  const {} *v{} = static_cast<const {} *>"
+                          "(columns[{}]);\n",
+                          cxx_type(var_types[k]), k, cxx_type(var_types[k]),
+                          k);
+
+    code += "  std::size_t matches = 0;\n"
+            "  for (std::size_t i = 0; i < n; ++i)\n"
+            "    matches += " +
+            body.code +
+            ";\n"
+            "  return matches;\n"
+            "}\n";
+
+    return code;
+  }
+
+private:
+  static constexpr const char *PRELUDE = R"(#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+using namespace std::literals;
+
+namespace {
+inline bool truthy(bool v) { return v; }
+inline bool truthy(std::int64_t v) { return v != 0; }
+inline bool truthy(double v) { return v != 0 && !std::isnan(v); }
+inline bool truthy(std::string_view v) { return !v.empty(); }
+} // namespace
+
+)";
+
+  /// a C++ expression and its static type code
+  /// \details
+  ///    besides the variable type codes, 't' marks and/or expressions
+  ///    with non-boolean operands. In JSONLogic they yield one of their
+  ///    operands; here only their truth value is computed, so they must
+  ///    not be used as values.
+  struct term {
+    std::string code;
+    char type;
+  };
+
+  static const char *cxx_type(char type) {
+    switch (type) {
+    case 'i':
+      return "std::int64_t";
+    case 'd':
+      return "double";
+    case 's':
+      return "std::string_view";
+    case 'b':
+      return "unsigned char";
+    default:
+      throw native_unsupported(std::string("unknown type code: '") + type +
+                               "'");
+    }
+  }
+
+  static bool numeric(const term &t) { return t.type == 'i' || t.type == 'd'; }
+
+  static term truthy(const term &t) {
+    if (t.type == 't')
+      return {t.code, 'b'};
+
+    return t.type == 'b' ? t : term{"truthy(" + t.code + ")", 'b'};
+  }
+
+  static const term &value(const term &t) {
+    if (t.type == 't')
+      throw native_unsupported("and/or used as a value");
+
+    return t;
+  }
+
+  static term as_double(const term &t) {
+    if (!numeric(t))
+      throw native_unsupported("numeric operand expected");
+
+    return t.type == 'd' ? t : term{"double(" + t.code + ")", 'd'};
+  }
+
+  static std::string string_literal(std::string_view s) {
+    std::string res = "\"";
+
+    for (char c : s) {
+      const unsigned char uc = static_cast<unsigned char>(c);
+
+      // control characters as three digit octal escapes, which, unlike
+      //   hex escapes, cannot absorb the following characters
+      if (uc < 0x20 || uc == 0x7f) {
+        res += '\\';
+        res += char('0' + (uc >> 6));
+        res += char('0' + ((uc >> 3) & 7));
+        res += char('0' + (uc & 7));
+        continue;
+      }
+
+      if (c == '"' || c == '\\')
+        res += '\\';
+
+      res += c;
+    }
+
+    return res + "\"sv";
+  }
+
+  term variable(const boost::json::value &arg) {
+    const boost::json::value *name = &arg;
+
+    if (arg.is_array()) {
+      if (arg.get_array().size() != 1)
+        throw native_unsupported("var with default value");
+
+      name = &arg.get_array()[0];
+    }
+
+    if (!name->is_string())
+      throw native_unsupported("computed variable name");
+
+    const std::string_view nm = name->get_string();
+
+    for (std::size_t k = 0; k < var_names.size(); ++k) {
+      if (var_names[k] != nm)
+        continue;
+
+      const std::string ref = std::format("v{}[i]", k);
+
+      return var_types[k] == 'b' ? term{"bool(" + ref + ")", 'b'}
+                                 : term{ref, var_types[k]};
+    }
+
+    throw native_unsupported("untyped variable: " + std::string(nm));
+  }
+
+  term literal(const boost::json::value &n) {
+    switch (n.kind()) {
+    case boost::json::kind::int64: {
+      const std::int64_t val = n.get_int64();
+
+      // the literal 9223372036854775808 does not fit an int64
+      if (val == std::numeric_limits<std::int64_t>::min())
+        return {"(std::int64_t(-9223372036854775807) - 1)", 'i'};
+
+      return {std::format("std::int64_t({})", val), 'i'};
+    }
+    case boost::json::kind::uint64:
+      // json integers that fit an int64 are parsed as int64
+      throw native_unsupported("integer literal beyond the int64 range");
+    case boost::json::kind::double_:
+      // the exponent keeps the literal a double (e.g., -0.0 is not -0)
+      return {std::format("double({:.17e})", n.get_double()), 'd'};
+    case boost::json::kind::bool_:
+      return {n.get_bool() ? "true" : "false", 'b'};
+    case boost::json::kind::string:
+      return {string_literal(n.get_string()), 's'};
+    default:
+      throw native_unsupported("unsupported literal");
+    }
+  }
+
+  std::vector<term> operands(const boost::json::value &args) {
+    std::vector<term> res;
+
+    if (!args.is_array()) {
+      res.push_back(gen(args));
+      return res;
+    }
+
+    for (const boost::json::value &arg : args.get_array())
+      res.push_back(gen(arg));
+
+    return res;
+  }
+
+  /// (in)equality of two terms
+  static term equality(const std::string &op, const term &lhs,
+                       const term &rhs) {
+    value(lhs);
+    value(rhs);
+
+    const bool strict = op.size() == 3;
+    const bool negate = op[0] == '!';
+    const std::string cmp = negate ? " != " : " == ";
+
+    if (lhs.type == rhs.type)
+      return {"(" + lhs.code + cmp + rhs.code + ")", 'b'};
+
+    // strict equality also distinguishes int from double
+    if (strict)
+      return {negate ? "true" : "false", 'b'};
+
+    if (numeric(lhs) && numeric(rhs))
+      return {"(" + as_double(lhs).code + cmp + as_double(rhs).code + ")",
+              'b'};
+
+    throw native_unsupported("loose equality of different types");
+  }
+
+  /// ordering of two terms
+  static term ordering(const std::string &op, const term &lhs,
+                       const term &rhs) {
+    value(lhs);
+    value(rhs);
+
+    if (numeric(lhs) && numeric(rhs)) {
+      if (lhs.type == rhs.type)
+        return {"(" + lhs.code + " " + op + " " + rhs.code + ")", 'b'};
+
+      return {"(" + as_double(lhs).code + " " + op + " " +
+                  as_double(rhs).code + ")",
+              'b'};
+    }
+
+    if (lhs.type == 's' && rhs.type == 's')
+      return {"(" + lhs.code + " " + op + " " + rhs.code + ")", 'b'};
+
+    throw native_unsupported("ordering of non-numeric operands");
+  }
+
+  /// rejects % unless its divisor is an integer literal other than 0 and -1
+  /// \details
+  ///    JSONLogic yields null for x % 0, which has no native equivalent,
+  ///    and in C++, x % 0 and INT64_MIN % -1 are undefined.
+  static void divisor(const boost::json::value &args) {
+    const boost::json::array *arr = args.if_array();
+
+    if (arr == nullptr || arr->size() != 2 || !(*arr)[1].is_int64() ||
+        (*arr)[1].get_int64() == 0 || (*arr)[1].get_int64() == -1)
+      throw native_unsupported("% requires a divisor literal other than 0 and -1");
+  }
+
+  term arithmetic(const std::string &op, const std::vector<term> &args) {
+    for (const term &arg : args)
+      if (!numeric(arg))
+        throw native_unsupported("arithmetic on non-numeric operands");
+
+    if (op == "-" && args.size() == 1)
+      return {"(-" + args[0].code + ")", args[0].type};
+
+    if (op == "+" && args.size() == 1)
+      return args[0];
+
+    if (args.size() < 2 || ((op == "/" || op == "%" || op == "-") &&
+                            args.size() != 2))
+      throw native_unsupported("unsupported arity of " + op);
+
+    bool integral = true;
+    for (const term &arg : args)
+      integral = integral && arg.type == 'i';
+
+    if (op == "/")
+      return {"(" + as_double(args[0]).code + " / " + as_double(args[1]).code +
+                  ")",
+              'd'};
+
+    if (op == "%") {
+      if (!integral)
+        throw native_unsupported("% on non-integral operands");
+
+      return {"(" + args[0].code + " % " + args[1].code + ")", 'i'};
+    }
+
+    std::string code = "(";
+
+    for (std::size_t k = 0; k < args.size(); ++k) {
+      if (k)
+        code += " " + op + " ";
+
+      code += integral ? args[k].code : as_double(args[k]).code;
+    }
+
+    return {code + ")", integral ? 'i' : 'd'};
+  }
+
+  term extremum(const std::string &op, const std::vector<term> &args) {
+    if (args.empty())
+      throw native_unsupported(op + " without operands");
+
+    bool integral = true;
+    for (const term &arg : args) {
+      if (!numeric(arg))
+        throw native_unsupported(op + " of non-numeric operands");
+
+      integral = integral && arg.type == 'i';
+    }
+
+    std::string code = "std::" + op + "({";
+
+    for (std::size_t k = 0; k < args.size(); ++k)
+      code += (k ? ", " : "") +
+              (integral ? args[k].code : as_double(args[k]).code);
+
+    return {code + "})", integral ? 'i' : 'd'};
+  }
+
+  term membership(const boost::json::value &args) {
+    if (!args.is_array() || args.get_array().size() != 2)
+      throw native_unsupported("in requires two operands");
+
+    const term elem = value(gen(args.get_array()[0]));
+    const boost::json::value &coll = args.get_array()[1];
+
+    if (!coll.is_array()) {
+      const term str = gen(coll);
+
+      if (str.type != 's' || elem.type != 's')
+        throw native_unsupported("in on a non-string");
+
+      return {"(" + str.code + ".find(" + elem.code +
+                  ") != std::string_view::npos)",
+              'b'};
+    }
+
+    // elements match only values of the same type (e.g., 7 is not in [7.0])
+    std::string code = "(false";
+
+    for (const boost::json::value &val : coll.get_array()) {
+      const term cand = literal(val);
+
+      if (elem.type == cand.type)
+        code += " || (" + elem.code + " == " + cand.code + ")";
+    }
+
+    return {code + ")", 'b'};
+  }
+
+  term gen(const boost::json::value &n) {
+    if (n.is_array())
+      throw native_unsupported("array values");
+
+    if (!n.is_object())
+      return literal(n);
+
+    const boost::json::object &obj = n.get_object();
+
+    if (obj.size() != 1)
+      throw native_unsupported("object values");
+
+    const std::string op(obj.begin()->key());
+    const boost::json::value &args = obj.begin()->value();
+
+    if (op == "var")
+      return variable(args);
+
+    if (op == "in")
+      return membership(args);
+
+    const std::vector<term> ops = operands(args);
+
+    if (op == "==" || op == "!=" || op == "===" || op == "!==") {
+      if (ops.size() != 2)
+        throw native_unsupported("unsupported arity of " + op);
+
+      return equality(op, ops[0], ops[1]);
+    }
+
+    if (op == "<" || op == "<=" || op == ">" || op == ">=") {
+      if (ops.size() == 2)
+        return ordering(op, ops[0], ops[1]);
+
+      // between: a < b < c
+      if (ops.size() == 3 && (op == "<" || op == "<="))
+        return {"(" + ordering(op, ops[0], ops[1]).code + " && " +
+                    ordering(op, ops[1], ops[2]).code + ")",
+                'b'};
+
+      throw native_unsupported("unsupported arity of " + op);
+    }
+
+    if (op == "and" || op == "or") {
+      // JSONLogic yields null without operands
+      if (ops.empty())
+        throw native_unsupported(op + " without operands");
+
+      std::string code = "(";
+      bool boolean = true;
+
+      for (std::size_t k = 0; k < ops.size(); ++k) {
+        code += (k ? (op == "and" ? " && " : " || ") : "") +
+                truthy(ops[k]).code;
+        boolean = boolean && ops[k].type == 'b';
+      }
+
+      return {code + ")", boolean ? 'b' : 't'};
+    }
+
+    if ((op == "!" || op == "!!") && ops.empty())
+      throw native_unsupported(op + " without operands");
+
+    if (op == "!")
+      return {"(!" + truthy(ops[0]).code + ")", 'b'};
+
+    if (op == "!!")
+      return truthy(ops[0]);
+
+    if (op == "if") {
+      if (ops.size() != 3)
+        throw native_unsupported("if requires three operands");
+
+      if (ops[1].type != ops[2].type || ops[1].type == 't')
+        throw native_unsupported("if with branches of different types");
+
+      return {"(" + truthy(ops[0]).code + " ? " + ops[1].code + " : " +
+                  ops[2].code + ")",
+              ops[1].type};
+    }
+
+    if (op == "+" || op == "-" || op == "*" || op == "/" || op == "%") {
+      if (op == "%")
+        divisor(args);
+
+      return arithmetic(op, ops);
+    }
+
+    if (op == "min" || op == "max")
+      return extremum(op, ops);
+
+    throw native_unsupported("unsupported operator: " + op);
+  }
+
+  std::vector<std::string> var_names;
+  std::vector<char> var_types;
+};
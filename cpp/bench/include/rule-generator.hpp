@@ -0,0 +1,286 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/json.hpp>
+
+/// parameters of a synthetic rule
+/// \details
+///    variable types use benchmark-generic's type codes:
+///    'i' = int, 'd' = double, 's' = string, 'b' = bool.
+struct RuleShape {
+  std::size_t depth = 3;        // nesting levels of logical operators
+  std::size_t fanout = 3;       // operands per and/or
+  std::size_t variables = 4;    // number of distinct variables
+  std::size_t constants = 16;   // size of the constant set per type
+  std::size_t array_length = 8; // length of the arrays tested by "in"
+  std::string types = "idsb";   // variable types, assigned round-robin
+
+  /// operator weights; operators with weight 0 are never generated
+  /// \details
+  ///    logical operators ("and", "or", "!", "if") form the inner nodes,
+  ///    predicates ("==", "!=", "<", "<=", ">", ">=", "in") the leaves.
+  ///    Arithmetic operators ("+", "-", "*") wrap numeric operands
+  ///    of predicates.
+  std::map<std::string, unsigned> mix = {
+      {"and", 3}, {"or", 3}, {"!", 1},  {"if", 1},  {"==", 3}, {"!=", 1},
+      {"<", 2},   {">", 2},  {"<=", 1}, {">=", 1},  {"in", 2}, {"+", 1},
+      {"-", 1},   {"*", 1}};
+};
+
+/// parses an operator mix of the form "op:weight,op:weight,..."
+/// \details
+///    operators that are not listed get weight 0.
+inline std::map<std::string, unsigned> parse_mix(const std::string &spec) {
+  std::map<std::string, unsigned> mix;
+  std::size_t pos = 0;
+
+  while (pos < spec.size()) {
+    std::size_t end = spec.find(',', pos);
+    if (end == std::string::npos)
+      end = spec.size();
+
+    const std::string item = spec.substr(pos, end - pos);
+    const std::size_t colon = item.rfind(':');
+
+    if (colon == std::string::npos || colon == 0)
+      throw std::runtime_error("invalid operator mix entry: " + item);
+
+    mix[item.substr(0, colon)] = std::stoul(item.substr(colon + 1));
+    pos = end + 1;
+  }
+
+  return mix;
+}
+
+/// generates random, but valid rules of a given shape with matching data
+/// \details
+///    rules are deterministic for a given shape and seed. Every generated
+///    rule evaluates without error on the generated data; values are drawn
+///    from the constant sets, so predicates are true for a fraction of rows.
+class RuleGenerator {
+public:
+  explicit RuleGenerator(RuleShape shape, std::uint64_t seed = 42)
+      : shape_(std::move(shape)), rng_(seed) {
+    if (shape_.types.empty())
+      throw std::runtime_error("at least one variable type is required");
+    if (shape_.variables == 0)
+      throw std::runtime_error("at least one variable is required");
+    if (shape_.constants == 0)
+      shape_.constants = 1;
+
+    for (char type : shape_.types)
+      if (type != 'i' && type != 'd' && type != 's' && type != 'b')
+        throw std::runtime_error(std::string("Unknown type code: '") + type +
+                                 "'");
+
+    for (const auto &[op, weight] : shape_.mix) {
+      if (weight == 0)
+        continue;
+
+      if (op == "and" || op == "or" || op == "!" || op == "if")
+        logical_.push_back({op, weight});
+      else if (op == "==" || op == "!=" || op == "<" || op == ">" ||
+               op == "<=" || op == ">=" || op == "in")
+        predicates_.push_back({op, weight});
+      else if (op == "+" || op == "-" || op == "*")
+        arithmetic_.push_back({op, weight});
+      else
+        throw std::runtime_error("unsupported operator in mix: " + op);
+    }
+
+    if (predicates_.empty())
+      throw std::runtime_error("the operator mix contains no predicate");
+  }
+
+  /// name of the i-th variable
+  static std::string variable_name(std::size_t i) {
+    return "v" + std::to_string(i);
+  }
+
+  /// type code of the i-th variable
+  char variable_type(std::size_t i) const {
+    return shape_.types[i % shape_.types.size()];
+  }
+
+  /// the "types" object of a benchmark-generic input file
+  boost::json::object types() const {
+    boost::json::object res;
+
+    for (std::size_t i = 0; i < shape_.variables; ++i)
+      res[variable_name(i)] = std::string(1, variable_type(i));
+
+    return res;
+  }
+
+  /// generates a new rule
+  boost::json::value rule() { return logical(shape_.depth); }
+
+  /// generates a rule in benchmark-generic's input format
+  boost::json::object benchmark_input() {
+    boost::json::object res;
+
+    res["rule"] = rule();
+    res["types"] = types();
+    return res;
+  }
+
+  /// generates a data row binding all variables
+  boost::json::object row() {
+    boost::json::object res;
+
+    for (std::size_t i = 0; i < shape_.variables; ++i)
+      res[variable_name(i)] = constant(variable_type(i));
+
+    return res;
+  }
+
+  /// returns the number of operator nodes in \p rule
+  static std::size_t operator_count(const boost::json::value &rule) {
+    if (rule.is_array()) {
+      std::size_t res = 0;
+
+      for (const boost::json::value &elem : rule.get_array())
+        res += operator_count(elem);
+
+      return res;
+    }
+
+    if (!rule.is_object())
+      return 0;
+
+    std::size_t res = 0;
+
+    for (const auto &kv : rule.get_object())
+      res += 1 + operator_count(kv.value());
+
+    return res;
+  }
+
+private:
+  using weighted = std::vector<std::pair<std::string, unsigned>>;
+
+  const std::string &pick(const weighted &ops) {
+    unsigned total = 0;
+    for (const auto &[op, weight] : ops)
+      total += weight;
+
+    unsigned n = std::uniform_int_distribution<unsigned>(0, total - 1)(rng_);
+
+    for (const auto &[op, weight] : ops) {
+      if (n < weight)
+        return op;
+
+      n -= weight;
+    }
+
+    return ops.back().first;
+  }
+
+  std::size_t uniform(std::size_t n) {
+    return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng_);
+  }
+
+  static boost::json::value op(const std::string &name,
+                               boost::json::array args) {
+    boost::json::object res;
+
+    res[name] = std::move(args);
+    return res;
+  }
+
+  static boost::json::value var(std::size_t i) {
+    boost::json::object res;
+
+    res["var"] = variable_name(i);
+    return res;
+  }
+
+  /// draws a value of type \p type from the constant set
+  boost::json::value constant(char type) {
+    const std::size_t k = uniform(shape_.constants);
+
+    switch (type) {
+    case 'i':
+      return std::int64_t(k);
+    case 'd':
+      return double(k) + 0.5;
+    case 's':
+      return "s" + std::to_string(k);
+    default:
+      return k % 2 == 0;
+    }
+  }
+
+  /// a boolean-valued expression with \p depth levels of logical operators
+  boost::json::value logical(std::size_t depth) {
+    if (depth == 0 || logical_.empty())
+      return predicate();
+
+    const std::string &name = pick(logical_);
+    boost::json::array args;
+
+    if (name == "!") {
+      args.push_back(logical(depth - 1));
+    } else if (name == "if") {
+      for (int i = 0; i < 3; ++i)
+        args.push_back(logical(depth - 1));
+    } else {
+      for (std::size_t i = 0; i < std::max<std::size_t>(shape_.fanout, 1); ++i)
+        args.push_back(logical(depth - 1));
+    }
+
+    return op(name, std::move(args));
+  }
+
+  /// a numeric operand over variable \p i, possibly wrapped in arithmetic
+  boost::json::value numeric_operand(std::size_t i) {
+    if (arithmetic_.empty() || uniform(2) == 0)
+      return var(i);
+
+    boost::json::array args;
+
+    args.push_back(var(i));
+    args.push_back(constant(variable_type(i)));
+    return op(pick(arithmetic_), std::move(args));
+  }
+
+  /// a comparison or membership test of a variable
+  boost::json::value predicate() {
+    const std::size_t i = uniform(shape_.variables);
+    const char type = variable_type(i);
+    std::string name = pick(predicates_);
+    boost::json::array args;
+
+    if (name == "in") {
+      boost::json::array elems;
+
+      for (std::size_t k = 0; k < shape_.array_length; ++k)
+        elems.push_back(constant(type));
+
+      args.push_back(var(i));
+      args.push_back(std::move(elems));
+      return op(name, std::move(args));
+    }
+
+    // only numbers are ordered; other types are tested for equality
+    const bool numeric = type == 'i' || type == 'd';
+
+    if (!numeric && name != "==" && name != "!=")
+      name = "==";
+
+    args.push_back(numeric ? numeric_operand(i) : var(i));
+    args.push_back(constant(type));
+    return op(name, std::move(args));
+  }
+
+  RuleShape shape_;
+  std::mt19937_64 rng_;
+  weighted logical_;
+  weighted predicates_;
+  weighted arithmetic_;
+};
@@ -0,0 +1,239 @@
+#include <bench.hpp>
+#include <boost/json.hpp>
+#include <boost/json/src.hpp>
+#include <cxxopts.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <jsonlogic/logic.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+#if !defined(JSONLOGIC_TEST_CORPUS)
+#define JSONLOGIC_TEST_CORPUS "tests/json"
+#endif /* !defined(JSONLOGIC_TEST_CORPUS) */
+
+namespace bjsn = boost::json;
+namespace fs = std::filesystem;
+
+std::string read_file(const std::string &filename) {
+  std::ifstream file(filename);
+  if (!file)
+    throw std::runtime_error("Failed to open file: " + filename);
+  return {std::istreambuf_iterator<char>(file),
+          std::istreambuf_iterator<char>()};
+}
+
+/// converts a json value to a value_variant
+/// \return nullopt if \p n has no value_variant representation
+std::optional<jsonlogic::value_variant> to_value_variant(const bjsn::value &n) {
+  switch (n.kind()) {
+  case bjsn::kind::string: {
+    const bjsn::string &str = n.get_string();
+    return jsonlogic::managed_string_view(
+        std::string_view(str.data(), str.size()));
+  }
+  case bjsn::kind::int64:
+    return n.get_int64();
+  case bjsn::kind::uint64:
+    return n.get_uint64();
+  case bjsn::kind::double_:
+    return n.get_double();
+  case bjsn::kind::bool_:
+    return n.get_bool();
+  case bjsn::kind::null:
+    return nullptr;
+  default:
+    return std::nullopt;
+  }
+}
+
+/// extracts the values of the rule's variables from \p data
+/// \return nullopt if the rule cannot be evaluated with a value vector
+std::optional<std::vector<jsonlogic::value_variant>>
+variable_values(const jsonlogic::logic_rule &rule, const bjsn::value &data) {
+  if (rule.has_computed_variable_names() || !data.is_object())
+    return std::nullopt;
+
+  std::vector<jsonlogic::value_variant> values;
+
+  for (std::string_view name : rule.variable_names()) {
+    const bjsn::value *val = data.as_object().if_contains(name);
+    if (val == nullptr)
+      return std::nullopt;
+
+    std::optional<jsonlogic::value_variant> var = to_value_variant(*val);
+    if (!var)
+      return std::nullopt;
+
+    values.push_back(std::move(*var));
+  }
+
+  return values;
+}
+
+/// times \p n evaluations of \p eval
+/// \return nanoseconds per evaluation, or nullopt if eval throws
+template <class Fn>
+std::optional<double> time_evals(const std::string &name, Fn eval, size_t n,
+                                 size_t n_runs) {
+  try {
+    eval();
+  } catch (...) {
+    // the corpus contains rules that are expected to fail
+    return std::nullopt;
+  }
+
+  auto lambda = [&] {
+    for (size_t i = 0; i < n; ++i)
+      eval();
+  };
+
+  BenchmarkResult res = Benchmark(name, lambda).run(n_runs);
+
+  return res.mean_time() * 1e6 / double(n);
+}
+
+int main(int argc, const char **argv) try {
+  cxxopts::Options options("benchmark-corpus",
+                           "Conformance corpus as throughput benchmark");
+  options.add_options()("d,dir", "Directory with test files",
+                        cxxopts::value<std::string>()->default_value(
+                            JSONLOGIC_TEST_CORPUS))(
+      "n,evals", "Number of evaluations per file and run",
+      cxxopts::value<size_t>()->default_value("10000"))(
+      "r,runs", "Number of runs", cxxopts::value<size_t>()->default_value("3"))(
+      "o,output", "Output JSON file", cxxopts::value<std::string>())(
+      "h,help", "Print usage");
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  const std::string dir = result["dir"].as<std::string>();
+  const size_t N = result["evals"].as<size_t>();
+  const size_t N_RUNS = result["runs"].as<size_t>();
+
+  std::vector<fs::path> files;
+  for (const fs::directory_entry &entry : fs::directory_iterator(dir))
+    if (entry.path().extension() == ".json")
+      files.push_back(entry.path());
+
+  std::ranges::sort(files);
+
+  bjsn::array results;
+  double accessor_ns = 0, vector_ns = 0;
+  size_t accessor_files = 0, vector_files = 0, skipped = 0;
+
+  for (const fs::path &file : files) {
+    const std::string name = file.filename().string();
+    bjsn::value test = bjsn::parse(read_file(file.string()));
+    const bjsn::object &testobj = test.as_object();
+    bjsn::value data = testobj.contains("data") ? testobj.at("data")
+                                                : bjsn::value(bjsn::object{});
+    bjsn::object res;
+
+    res["file"] = name;
+
+    try {
+      jsonlogic::logic_rule rule = jsonlogic::create_logic(testobj.at("rule"));
+      jsonlogic::evaluation_context ctx;
+      jsonlogic::variable_accessor accessor = jsonlogic::json_accessor(data);
+
+      // keep the log operator quiet
+      ctx.logger([](const jsonlogic::value_variant &) {});
+
+      std::optional<double> ns_acc = time_evals(
+          name + " accessor",
+          [&]() -> jsonlogic::value_variant { return rule.apply(ctx, accessor); },
+          N, N_RUNS);
+
+      if (ns_acc) {
+        res["accessor_ns_per_eval"] = *ns_acc;
+        accessor_ns += *ns_acc;
+        ++accessor_files;
+      }
+
+      if (auto values = variable_values(rule, data)) {
+        std::span<const jsonlogic::value_variant> vars(*values);
+        std::optional<double> ns_vec = time_evals(
+            name + " vector",
+            [&]() -> jsonlogic::value_variant { return rule.apply(ctx, vars); },
+            N, N_RUNS);
+
+        if (ns_vec) {
+          res["vector_ns_per_eval"] = *ns_vec;
+          vector_ns += *ns_vec;
+          ++vector_files;
+        }
+      }
+    } catch (const std::exception &e) {
+      res["error"] = e.what();
+    }
+
+    if (!res.contains("accessor_ns_per_eval") &&
+        !res.contains("vector_ns_per_eval"))
+      ++skipped;
+
+    results.push_back(std::move(res));
+  }
+
+  std::cout << "\n";
+  for (const bjsn::value &val : results) {
+    const bjsn::object &res = val.as_object();
+
+    std::cout << std::string_view(res.at("file").as_string()) << ":";
+    if (const bjsn::value *ns = res.if_contains("accessor_ns_per_eval"))
+      std::cout << std::format(" accessor {:.1f} ns/eval", ns->as_double());
+    if (const bjsn::value *ns = res.if_contains("vector_ns_per_eval"))
+      std::cout << std::format(" vector {:.1f} ns/eval", ns->as_double());
+    if (!res.contains("accessor_ns_per_eval") &&
+        !res.contains("vector_ns_per_eval"))
+      std::cout << " skipped (rule fails)";
+    std::cout << "\n";
+  }
+
+  // a pass evaluates every file once; throughput is evaluations per second
+  auto throughput = [](size_t n_files, double ns) -> double {
+    return ns > 0 ? double(n_files) * 1e9 / ns : 0;
+  };
+
+  std::cout << std::format(
+      "\nfiles: {}, skipped: {}\n"
+      "accessor: {} files, {:.0f} evals/s\n"
+      "vector:   {} files, {:.0f} evals/s\n",
+      files.size(), skipped, accessor_files,
+      throughput(accessor_files, accessor_ns), vector_files,
+      throughput(vector_files, vector_ns));
+
+  if (result.count("output")) {
+    const std::string outfile = result["output"].as<std::string>();
+    bjsn::object report;
+
+    report["benchmark"] = "corpus";
+    report["evals"] = N;
+    report["runs"] = N_RUNS;
+    report["accessor_evals_per_second"] =
+        throughput(accessor_files, accessor_ns);
+    report["vector_evals_per_second"] = throughput(vector_files, vector_ns);
+    report["results"] = std::move(results);
+
+    std::ofstream os(outfile);
+    if (!os)
+      throw std::runtime_error("Failed to open file: " + outfile);
+
+    os << report << std::endl;
+  }
+
+  return 0;
+} catch (const std::exception &e) {
+  std::cerr << "Fatal error: " << e.what() << '\n';
+  return 1;
+} catch (...) {
+  std::cerr << "Fatal unknown error\n";
+  return 2;
+}
@@ -0,0 +1,263 @@
+#include <bench.hpp>
+#include <boost/json.hpp>
+#include <boost/json/src.hpp>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <jsonlogic/logic.hpp>
+#include <rule-generator.hpp>
+#include <string>
+#include <vector>
+
+namespace bjsn = boost::json;
+
+std::string read_file(const std::string &filename) {
+  std::ifstream file(filename);
+  if (!file)
+    throw std::runtime_error("Failed to open file: " + filename);
+  return {std::istreambuf_iterator<char>(file),
+          std::istreambuf_iterator<char>()};
+}
+
+/// loads the rules from \p filename
+/// \details
+///    the file holds either an array of rules, or a single object
+///    in benchmark-generic's format ({"rule": ..., "types": ...}).
+std::vector<bjsn::value> load_rules(const std::string &filename) {
+  bjsn::value j = bjsn::parse(read_file(filename));
+
+  if (j.is_array()) {
+    const bjsn::array &arr = j.as_array();
+    return std::vector<bjsn::value>(arr.begin(), arr.end());
+  }
+
+  if (j.is_object() && j.as_object().contains("rule"))
+    return {j.as_object().at("rule")};
+
+  throw std::runtime_error("Input JSON must be an array of rules or "
+                           "contain a 'rule'");
+}
+
+/// returns {"and": [{"==": [{"var": "tenant"}, tenant]}, rule]}
+bjsn::value tenant_rule(const bjsn::value &rule, size_t tenant) {
+  bjsn::object var, test, res;
+  bjsn::array args, conds;
+
+  var["var"] = "tenant";
+  args.push_back(std::move(var));
+  args.push_back(tenant);
+  test["=="] = std::move(args);
+  conds.push_back(std::move(test));
+  conds.push_back(rule);
+  res["and"] = std::move(conds);
+  return res;
+}
+
+int main(int argc, const char **argv) try {
+  cxxopts::Options options("benchmark-create",
+                           "Throughput of JSONLogic rule parsing and "
+                           "translation (create_logic)");
+  options.add_options()("f,file", "Input JSON file with rules",
+                        cxxopts::value<std::string>())(
+      "c,count", "Number of generated rules (without -f)",
+      cxxopts::value<size_t>()->default_value("10000"))(
+      "depth", "Nesting levels of generated rules",
+      cxxopts::value<size_t>()->default_value("3"))(
+      "fanout", "Operands per and/or in generated rules",
+      cxxopts::value<size_t>()->default_value("3"))(
+      "vars", "Number of variables in generated rules",
+      cxxopts::value<size_t>()->default_value("8"))(
+      "tenants", "Instances of each rule, each with its own tenant test",
+      cxxopts::value<size_t>()->default_value("1"))(
+      "r,runs", "Number of runs", cxxopts::value<size_t>()->default_value("3"))(
+      "s,seed", "Random seed", cxxopts::value<size_t>()->default_value("42"))(
+      "h,help", "Print usage");
+
+  BenchReport report(parse_bench_settings(argc, argv));
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  const size_t N_RUNS = result["runs"].as<size_t>();
+  std::vector<bjsn::value> rules;
+
+  if (result.count("file")) {
+    rules = load_rules(result["file"].as<std::string>());
+  } else {
+    RuleShape shape;
+
+    shape.depth = result["depth"].as<size_t>();
+    shape.fanout = result["fanout"].as<size_t>();
+    shape.variables = result["vars"].as<size_t>();
+
+    RuleGenerator gen(shape, result["seed"].as<size_t>());
+    const size_t count = result["count"].as<size_t>();
+
+    for (size_t i = 0; i < count; ++i)
+      rules.push_back(gen.rule());
+  }
+
+  if (const size_t n_tenants = result["tenants"].as<size_t>(); n_tenants > 1) {
+    std::vector<bjsn::value> instances;
+
+    for (size_t tenant = 0; tenant < n_tenants; ++tenant)
+      for (const bjsn::value &rule : rules)
+        instances.push_back(tenant_rule(rule, tenant));
+
+    rules = std::move(instances);
+  }
+
+  std::vector<std::string> texts;
+  size_t bytes = 0;
+
+  for (const bjsn::value &rule : rules) {
+    texts.push_back(bjsn::serialize(rule));
+    bytes += texts.back().size();
+  }
+
+  std::cout << std::format("{} rules, {} bytes\n", rules.size(), bytes);
+
+  size_t nodes = 0;
+
+  auto parse_lambda = [&] {
+    nodes = 0;
+    for (const std::string &text : texts)
+      nodes += bjsn::parse(text).is_object();
+  };
+
+  auto translate_lambda = [&] {
+    nodes = 0;
+    for (const bjsn::value &rule : rules)
+      nodes += jsonlogic::create_logic(rule).variable_names().size();
+  };
+
+  auto create_lambda = [&] {
+    nodes = 0;
+    for (const std::string &text : texts)
+      nodes += jsonlogic::create_logic(bjsn::parse(text))
+                   .variable_names()
+                   .size();
+  };
+
+  // the rules are translated while their text is parsed
+  auto text_lambda = [&] {
+    nodes = 0;
+    for (const std::string &text : texts)
+      nodes += jsonlogic::create_logic_from_text(text).variable_names().size();
+  };
+
+  // the rules are kept alive, as in a rule cache
+  jsonlogic::rule_store_statistics stats;
+
+  auto store_lambda = [&] {
+    jsonlogic::rule_store store;
+    std::vector<jsonlogic::logic_rule> logics;
+
+    logics.reserve(rules.size());
+    for (const bjsn::value &rule : rules)
+      logics.push_back(store.create_logic(rule));
+
+    stats = store.statistics();
+  };
+
+  // compiled rules are loaded from images, as at the start of a service
+  std::vector<std::vector<std::byte>> images;
+  size_t image_bytes = 0;
+
+  for (const bjsn::value &rule : rules) {
+    images.push_back(jsonlogic::save_image(jsonlogic::create_logic(rule)));
+    image_bytes += images.back().size();
+  }
+
+  auto load_lambda = [&] {
+    nodes = 0;
+    for (const std::vector<std::byte> &image : images)
+      nodes += jsonlogic::load_logic(image).variable_names().size();
+  };
+
+  // repeated rule texts are parsed, but compiled only once; the
+  //   capacity leaves room for shards that hold more than their share
+  jsonlogic::rule_cache cache(2 * rules.size());
+
+  auto cache_lambda = [&] {
+    nodes = 0;
+    for (const std::string &text : texts)
+      nodes += cache.create_logic(std::string_view(text))->variable_names().size();
+  };
+
+  Benchmark parse_bench("create-parse", parse_lambda);
+  Benchmark translate_bench("create-translate", translate_lambda);
+  Benchmark create_bench("create-parse-translate", create_lambda);
+  Benchmark text_bench("create-from-text", text_lambda);
+  Benchmark store_bench("create-store", store_lambda);
+  Benchmark load_bench("create-load-image", load_lambda);
+  Benchmark cache_bench("create-cache", cache_lambda);
+
+  parse_bench.warmup(report.warmup());
+  translate_bench.warmup(report.warmup());
+  create_bench.warmup(report.warmup());
+  text_bench.warmup(report.warmup());
+  store_bench.warmup(report.warmup());
+  load_bench.warmup(report.warmup());
+  cache_bench.warmup(report.warmup());
+
+  BenchmarkResult parse_res = parse_bench.run(N_RUNS);
+  BenchmarkResult translate_res = translate_bench.run(N_RUNS);
+  BenchmarkResult create_res = create_bench.run(N_RUNS);
+  BenchmarkResult text_res = text_bench.run(N_RUNS);
+  BenchmarkResult store_res = store_bench.run(N_RUNS);
+  BenchmarkResult load_res = load_bench.run(N_RUNS);
+  BenchmarkResult cache_res = cache_bench.run(N_RUNS);
+
+  parse_res.summarize();
+  translate_res.summarize();
+  create_res.summarize();
+  text_res.summarize();
+  store_res.summarize();
+  load_res.summarize();
+  cache_res.summarize();
+
+  auto throughput = [&](const BenchmarkResult &res) {
+    const double secs = res.mean_time() / 1e3;
+
+    std::cout << std::format("{}: {:.0f} rules/s, {:.1f} MB/s\n", res.label(),
+                             double(rules.size()) / secs,
+                             double(bytes) / secs / 1e6);
+  };
+
+  std::cout << "\n";
+  throughput(parse_res);
+  throughput(translate_res);
+  throughput(create_res);
+  throughput(text_res);
+  throughput(store_res);
+  throughput(load_res);
+  throughput(cache_res);
+
+  const size_t stored = stats.stored_bytes + stats.index_bytes;
+
+  std::cout << std::format(
+      "\nrule_store: {} of {} nodes stored in {} shared subtrees; "
+      "{} of {} bytes ({} index), {:.1f}% saved\n",
+      stats.stored_nodes, stats.nodes, stats.subtrees, stored, stats.bytes,
+      stats.index_bytes,
+      100.0 * (double(stats.bytes) - double(stored)) / double(stats.bytes));
+  std::cout << std::format("rule images: {} bytes\n", image_bytes);
+
+  report.add(parse_res);
+  report.add(translate_res);
+  report.add(create_res);
+  report.add(text_res);
+  report.add(store_res);
+  report.add(load_res);
+  report.add(cache_res);
+  return report.finish();
+} catch (const std::exception &e) {
+  std::cerr << "Fatal error: " << e.what() << '\n';
+  return 1;
+} catch (...) {
+  std::cerr << "Fatal unknown error\n";
+  return 2;
+}
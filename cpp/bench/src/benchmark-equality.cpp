@@ -3,7 +3,7 @@
 #include <boost/json/src.hpp>
 #include <chrono>
 #include <cstdio>
-#include <dlfcn.h>
+#include <dynamic-lib.hpp>
 #include <faker-cxx/location.h>
 #include <faker-cxx/number.h>
 #include <filesystem>
@@ -13,76 +13,6 @@
 
 namespace experimental {
 
-struct dynamic_lib {
-  explicit dynamic_lib(const char *dllname)
-      : handle(dlopen(dllname, RTLD_LAZY)) {
-    if (handle == nullptr)
-      throw std::runtime_error{std::string{"Unable to load shared object: "} +
-                               dlerror()};
-  }
-
-  ~dynamic_lib() {
-    if (handle != nullptr)
-      dlclose(handle);
-  }
-
-  dynamic_lib(dynamic_lib &&other) noexcept {
-    std::swap(this->handle, other.handle);
-  }
-
-  dynamic_lib &operator=(dynamic_lib &&other) noexcept {
-    std::swap(this->handle, other.handle);
-    return *this;
-  }
-
-  template <class FnType> FnType function(const char *name) const {
-    return (FnType)(dlsym(handle, name));
-  }
-
-  dynamic_lib() = delete;
-  dynamic_lib(const dynamic_lib &) = delete;
-  dynamic_lib &operator=(const dynamic_lib &) = delete;
-
-private:
-  void *handle = nullptr;
-};
-
-dynamic_lib compile_and_load(const std::string &code,
-                             const std::string &libname) {
-  // Step 1: Write code to a temporary file.
-  char template_name[] = "/tmp/temp_XXXXXX.cpp";
-  int fd = mkstemps(template_name, 4);
-  if (fd == -1) {
-    throw std::runtime_error("Failed to create temporary source file");
-  }
-  ssize_t written = write(fd, code.c_str(), code.length());
-  close(fd);
-
-  if (written != static_cast<ssize_t>(code.length())) {
-    std::remove(template_name); // Clean up on failure
-    throw std::runtime_error("Failed to write to temporary source file");
-  }
-
-  // Step 2: Compile the source file into a shared object
-  std::string inclDirs = RUNTIME_INCLUDES; // RUNTIME_INCLUDES is a macro
-
-  std::string compileCommand =
-      "g++ -Wall -Wextra -O3 -march=native -std=c++17 -shared -fPIC " +
-      inclDirs + " -o " + libname + " " + template_name;
-
-  std::cerr << compileCommand << std::endl;
-
-  int compileResult = std::system(compileCommand.c_str());
-  if (compileResult != 0)
-    throw std::runtime_error{"Compilation failed."};
-
-  std::remove(template_name);
-
-  std::filesystem::path currentPath = std::filesystem::current_path();
-  std::string fullPath = currentPath / libname;
-  return dynamic_lib{fullPath.c_str()};
-}
-
 // using basic_type = std::string;
 using basic_type = std::uint64_t;
 
@@ -124,6 +54,7 @@ const unsigned long SEED_ = 42;
 static const size_t N_ = 1'000'000;
 static const int N_RUNS_ = 3;
 int main(int argc, const char **argv) try {
+  BenchReport report(parse_bench_settings(argc, argv));
   std::span<const char *> args(argv, argc);
 
   size_t N = N_;
@@ -198,6 +129,74 @@ int main(int argc, const char **argv) try {
 
   auto jl2_bench = Benchmark("2ints-jl2", jl2_lambda);
 
+  // JL 3
+
+  auto jl3_lambda = [&] {
+    matches = 0;
+    auto rule = jsonlogic::create_logic(jv_xy);
+    jsonlogic::evaluation_context ctx;
+    std::vector<jsonlogic::value_variant> row(2);
+
+    for (size_t i = 0; i < N; ++i) {
+      row[0] = xs[i];
+      row[1] = ys[i];
+
+      auto v_xy = rule.apply(ctx, row);
+      bool val = jsonlogic::truthy(v_xy);
+
+      if (val) {
+        ++matches;
+      }
+    }
+  };
+
+  auto jl3_bench = Benchmark("2ints-jl3", jl3_lambda);
+
+  // JL 3, latency of a single evaluation
+
+  auto jl3_rule = jsonlogic::create_logic(jv_xy);
+  jsonlogic::evaluation_context jl3_ctx;
+  std::vector<jsonlogic::value_variant> jl3_row(2);
+  size_t jl3_pos = 0;
+
+  auto jl3_eval = [&] {
+    jl3_row[0] = xs[jl3_pos];
+    jl3_row[1] = ys[jl3_pos];
+    jl3_pos = (jl3_pos + 1) % N;
+
+    if (jsonlogic::truthy(jl3_rule.apply(jl3_ctx, jl3_row)))
+      ++matches;
+  };
+
+  auto jl3_latency =
+      LatencyBenchmark("2ints-jl3-latency", jl3_eval, report.warmup() * N);
+
+  // JL 4
+
+  std::vector<jsonlogic::value_variant> rows;
+  std::vector<jsonlogic::value_variant> results(N);
+
+  rows.reserve(2 * N);
+  for (size_t i = 0; i < N; ++i) {
+    rows.emplace_back(xs[i]);
+    rows.emplace_back(ys[i]);
+  }
+
+  auto jl4_lambda = [&] {
+    matches = 0;
+    auto rule = jsonlogic::create_logic(jv_xy);
+
+    rule.apply_rows(rows.data(), N, 2, results.data());
+
+    for (const jsonlogic::value_variant &v_xy : results) {
+      if (jsonlogic::truthy(v_xy)) {
+        ++matches;
+      }
+    }
+  };
+
+  auto jl4_bench = Benchmark("2ints-jl4", jl4_lambda);
+
   // C++ 1
 
   auto cpp_lambda = [&] {
@@ -224,7 +223,7 @@ int main(int argc, const char **argv) try {
       experimental::variant_type_name(experimental::basic_type{});
   std::string cxxcode = experimental::gen_code(fake_mangled, benchmarktype);
   experimental::dynamic_lib dll =
-      experimental::compile_and_load(cxxcode, dllname);
+      experimental::compile_and_load(cxxcode, dllname, RUNTIME_INCLUDES);
   auto fn = dll.function<evalfn_type>(fake_mangled.c_str());
   std::chrono::steady_clock::time_point end_addl =
       std::chrono::steady_clock::now();
@@ -245,10 +244,33 @@ int main(int argc, const char **argv) try {
 
   auto cpp2_bench = Benchmark("2ints-cpp2", cpp2_lambda, elapsed_addl);
 
+  jl_bench.warmup(report.warmup());
+  jl2_bench.warmup(report.warmup());
+  jl3_bench.warmup(report.warmup());
+  jl4_bench.warmup(report.warmup());
+  cpp_bench.warmup(report.warmup());
+  cpp2_bench.warmup(report.warmup());
+
+  if (report.perf()) {
+    jl_bench.count_events(N);
+    jl2_bench.count_events(N);
+    jl3_bench.count_events(N);
+    jl4_bench.count_events(N);
+    cpp_bench.count_events(N);
+    cpp2_bench.count_events(N);
+  }
+
   auto jl_results = jl_bench.run(N_RUNS);
   std::cout << "- jl1 matches: " << matches << std::endl;
   auto jl2_results = jl2_bench.run(N_RUNS);
   std::cout << "jl2 matches: " << matches << std::endl;
+  const std::uint64_t jl3_allocs = jsonlogic::allocation_count();
+  auto jl3_results = jl3_bench.run(N_RUNS);
+  std::cout << "jl3 matches: " << matches << ", allocations: "
+            << (jsonlogic::allocation_count() - jl3_allocs) << std::endl;
+  auto jl3_latency_results = jl3_latency.run(N * N_RUNS);
+  auto jl4_results = jl4_bench.run(N_RUNS);
+  std::cout << "jl4 matches: " << matches << std::endl;
   auto cpp_results = cpp_bench.run(N_RUNS);
   std::cout << "cpp1 matches: " << matches << std::endl;
   auto cpp2_results = cpp2_bench.run(N_RUNS);
@@ -256,15 +278,26 @@ int main(int argc, const char **argv) try {
 
   jl_results.summarize();
   jl2_results.summarize();
+  jl3_results.summarize();
+  jl4_results.summarize();
   cpp_results.summarize();
   cpp2_results.summarize();
+  jl3_latency_results.summarize();
   //~ jl_results.compare_to(cpp_results);
   //~ cpp_results.compare_to(jl_results);
 
   jl2_results.compare_to(jl_results);
+  jl3_results.compare_to(jl2_results);
+  jl4_results.compare_to(jl3_results);
   cpp2_results.compare_to(jl2_results);
   cpp2_results.compare_to(cpp_results);
-  return 0;
+
+  for (const BenchmarkResult *res : {&jl_results, &jl2_results, &jl3_results,
+                                     &jl4_results, &cpp_results, &cpp2_results})
+    report.add(*res);
+
+  report.add(jl3_latency_results);
+  return report.finish();
 } catch (const std::exception &e) {
   std::cerr << "Fatal error: " << e.what() << '\n';
   return 1;
@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <bench.hpp>
 #include <boost/json.hpp>
 #include <boost/json/src.hpp>
 #include <cxxopts.hpp>
+#include <dynamic-lib.hpp>
 #include <faker-cxx/location.h>
 #include <faker-cxx/number.h>
 #include <faker-cxx/person.h>
@@ -9,6 +11,7 @@
 #include <fstream>
 #include <iostream>
 #include <jsonlogic/logic.hpp>
+#include <native-rule.hpp>
 #include <random>
 #include <string>
 #include <variant>
@@ -55,7 +58,9 @@ int main(int argc, const char **argv) try {
       cxxopts::value<size_t>()->default_value("10000"))(
       "r,runs", "Number of runs", cxxopts::value<size_t>()->default_value("3"))(
       "s,seed", "Random seed",
-      cxxopts::value<size_t>()->default_value("42"))("h,help", "Print usage");
+      cxxopts::value<size_t>()->default_value("42"))(
+      "no-native", "Skip the generated native C++ baseline")(
+      "h,help", "Print usage");
 
   auto result = options.parse(argc, argv);
   if (result.count("help") || !result.count("file")) {
@@ -135,9 +140,20 @@ int main(int argc, const char **argv) try {
   auto jl2_lambda = [&] {
     matches = 0;
     auto jl2 = jsonlogic::create_logic(rule);
+
+    // the rule expects its values in the order of its variable names
+    std::vector<size_t> columns;
+    for (std::string_view name : jl2.variable_names()) {
+      auto pos = std::find(var_names.begin(), var_names.end(), name);
+      if (pos == var_names.end())
+        throw std::runtime_error("No type for variable: " + std::string(name));
+
+      columns.push_back(pos - var_names.begin());
+    }
+
     for (size_t i = 0; i < N; ++i) {
       std::vector<jsonlogic::value_variant> args;
-      for (size_t v = 0; v < var_names.size(); ++v) {
+      for (size_t v : columns) {
         const auto &val = data[v][i];
         if (std::holds_alternative<int>(val))
           args.push_back(std::get<int>(val));
@@ -172,6 +188,84 @@ int main(int argc, const char **argv) try {
 #if UNSUPPORTED
   jl2_results.compare_to(jl1_results);
 #endif /*UNSUPPORTED*/
+
+  if (result.count("no-native"))
+    return 0;
+
+  // Native: a generated C++ predicate equivalent to the rule
+  std::string cxxcode;
+
+  try {
+    std::vector<char> type_codes;
+    for (VarType type : var_types)
+      type_codes.push_back(static_cast<char>(type));
+
+    NativeRuleGenerator gen(var_names, std::move(type_codes));
+    cxxcode = gen.generate(rule, "jl_native_rule");
+  } catch (const native_unsupported &e) {
+    std::cout << "Native baseline unavailable: " << e.what() << std::endl;
+    return 0;
+  }
+
+  // typed columns, in the layout the generated code expects
+  std::vector<std::vector<std::int64_t>> int_cols;
+  std::vector<std::vector<double>> double_cols;
+  std::vector<std::vector<std::string_view>> string_cols;
+  std::vector<std::vector<unsigned char>> bool_cols;
+  std::vector<const void *> columns;
+
+  for (size_t v = 0; v < var_names.size(); ++v) {
+    const std::vector<VarValue> &col = data[v];
+
+    switch (var_types[v]) {
+    case VarType::Int:
+      columns.push_back(int_cols.emplace_back(col.size()).data());
+      for (size_t i = 0; i < N; ++i)
+        int_cols.back()[i] = std::get<int>(col[i]);
+      break;
+    case VarType::Double:
+      columns.push_back(double_cols.emplace_back(col.size()).data());
+      for (size_t i = 0; i < N; ++i)
+        double_cols.back()[i] = std::get<double>(col[i]);
+      break;
+    case VarType::String:
+      columns.push_back(string_cols.emplace_back(col.size()).data());
+      for (size_t i = 0; i < N; ++i)
+        string_cols.back()[i] = std::get<std::string>(col[i]);
+      break;
+    case VarType::Bool:
+      columns.push_back(bool_cols.emplace_back(col.size()).data());
+      for (size_t i = 0; i < N; ++i)
+        bool_cols.back()[i] = std::get<bool>(col[i]);
+      break;
+    }
+  }
+
+  using nativefn_type = std::size_t (*)(std::size_t, const void *const *);
+
+  std::chrono::steady_clock::time_point start_addl =
+      std::chrono::steady_clock::now();
+  experimental::dynamic_lib dll =
+      experimental::compile_and_load(cxxcode, "generic-native.so");
+  auto fn = dll.function<nativefn_type>("jl_native_rule");
+  ChronoUnit elapsed_addl = std::chrono::steady_clock::now() - start_addl;
+
+  if (fn == nullptr)
+    throw std::runtime_error("Generated function not found");
+
+  std::cout << "Compiling the native baseline took " << elapsed_addl << "\n";
+
+  const size_t jl2_matches = matches;
+  auto native_lambda = [&] { matches = fn(N, columns.data()); };
+  auto native_bench = Benchmark("generic-native", native_lambda);
+  auto native_results = native_bench.run(N_RUNS);
+
+  std::cout << "Native matches: " << matches << std::endl;
+  if (matches != jl2_matches)
+    std::cout << "Warning: the native baseline disagrees with JL2\n";
+
+  native_results.summarize();
+  jl2_results.compare_to(native_results);
   return 0;
 } catch (const std::exception &e) {
   std::cerr << "Fatal error: " << e.what() << '\n';
@@ -0,0 +1,287 @@
+#include <bench.hpp>
+#include <boost/json.hpp>
+#include <boost/json/src.hpp>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <jsonlogic/logic.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bjsn = boost::json;
+
+// Operand type codes:
+//   'i' = int64, 'u' = uint64, 'd' = double, 's' = string, 'b' = bool,
+//   'n' = null
+const std::string ALL_TYPES = "iudsbn";
+
+/// one benchmark: an operator applied to operands of given types
+struct bench_case {
+  std::string op;    // operator under test
+  std::string types; // type codes of the operands (see above)
+  bjsn::value rule;
+  bjsn::object data;
+};
+
+/// returns a sample value of type \p type
+/// \details
+///    strings hold numbers, so that operators that convert
+///    their operands to numbers succeed.
+bjsn::value sample_value(char type) {
+  switch (type) {
+  case 'i':
+    return std::int64_t(7);
+  case 'u':
+    return std::uint64_t(9);
+  case 'd':
+    return 2.5;
+  case 's':
+    return "7";
+  case 'b':
+    return true;
+  case 'n':
+    return nullptr;
+  default:
+    throw std::runtime_error(std::string("Unknown type code: '") + type + "'");
+  }
+}
+
+/// converts a json value to a value_variant
+jsonlogic::value_variant to_value_variant(const bjsn::value &n) {
+  switch (n.kind()) {
+  case bjsn::kind::string: {
+    const bjsn::string &str = n.get_string();
+    return jsonlogic::managed_string_view(
+        std::string_view(str.data(), str.size()));
+  }
+  case bjsn::kind::int64:
+    return n.get_int64();
+  case bjsn::kind::uint64:
+    return n.get_uint64();
+  case bjsn::kind::double_:
+    return n.get_double();
+  case bjsn::kind::bool_:
+    return n.get_bool();
+  case bjsn::kind::null:
+    return nullptr;
+  default:
+    throw std::runtime_error("Unsupported variable value");
+  }
+}
+
+/// data object binding "a", "b", ... to sample values of \p types
+bjsn::object sample_data(const std::string &types) {
+  bjsn::object data;
+  char name[] = "a";
+
+  for (char type : types) {
+    data[name] = sample_value(type);
+    ++name[0];
+  }
+
+  return data;
+}
+
+bjsn::value parse_rule(const std::string &rule) { return bjsn::parse(rule); }
+
+std::vector<bench_case> make_cases() {
+  std::vector<bench_case> cases;
+
+  auto add = [&cases](std::string op, std::string types,
+                      const std::string &rule) {
+    bjsn::object data = sample_data(types);
+
+    cases.push_back({std::move(op), std::move(types), parse_rule(rule),
+                     std::move(data)});
+  };
+
+  // binary operators over all type combinations
+  const std::vector<std::string> binary_ops = {
+      "==", "===", "!=", "!==", "<", ">",   "<=",  ">=",  "+",
+      "-",  "*",   "/",  "%",   "min", "max", "and", "or", "cat"};
+
+  for (const std::string &op : binary_ops)
+    for (char lhs : ALL_TYPES)
+      for (char rhs : ALL_TYPES)
+        add(op, std::string{lhs, rhs},
+            R"({")" + op + R"(":[{"var":"a"},{"var":"b"}]})");
+
+  // unary operators
+  for (const std::string op : {"!", "!!", "var"})
+    for (char arg : ALL_TYPES)
+      add(op, std::string{arg},
+          op == "var" ? R"({"var":"a"})"
+                      : R"({")" + op + R"(":[{"var":"a"}]})");
+
+  for (char arg : ALL_TYPES) {
+    const std::string types{arg};
+
+    add("if", types, R"({"if":[{"var":"a"},1,2]})");
+    add("in", types, R"({"in":[{"var":"a"},[1,2,3,"7",2.5,9]]})");
+    add("merge", types, R"({"merge":[[1,2],{"var":"a"}]})");
+  }
+
+  // membership in a string, substrings
+  for (char arg : std::string{"isd"}) {
+    add("in", std::string{arg, 's'}, R"({"in":[{"var":"a"},{"var":"b"}]})");
+    add("substr", std::string{arg},
+        R"({"substr":["jsonlogic",{"var":"a"}]})");
+    add("substr", std::string{arg, arg},
+        R"({"substr":["jsonlogic",{"var":"a"},{"var":"b"}]})");
+  }
+
+  // array operations over a constant array; "a" is the varying operand
+  const std::string elems = "[1,2,3,4,5,6,7,8]";
+
+  for (char arg : std::string{"ids"}) {
+    const std::string types{arg};
+
+    add("map", types,
+        R"({"map":[)" + elems + R"(,{"*":[{"var":""},{"var":"a"}]}]})");
+    add("filter", types,
+        R"({"filter":[)" + elems + R"(,{">":[{"var":""},{"var":"a"}]}]})");
+    add("reduce", types,
+        R"({"reduce":[)" + elems +
+            R"(,{"+":[{"var":"current"},{"var":"accumulator"}]},{"var":"a"}]})");
+    add("all", types,
+        R"({"all":[)" + elems + R"(,{">":[{"var":""},{"var":"a"}]}]})");
+    add("some", types,
+        R"({"some":[)" + elems + R"(,{">":[{"var":""},{"var":"a"}]}]})");
+    add("none", types,
+        R"({"none":[)" + elems + R"(,{">":[{"var":""},{"var":"a"}]}]})");
+  }
+
+  // variable presence
+  add("missing", "i", R"({"missing":["a","b","c"]})");
+  add("missing_some", "i", R"({"missing_some":[1,["a","b","c"]]})");
+
+  // extensions
+  add("regex", "s", R"({"regex":["^7",{"var":"a"}]})");
+
+  return cases;
+}
+
+std::string to_string(const jsonlogic::value_variant &val) {
+  std::stringstream os;
+
+  os << val;
+  return os.str();
+}
+
+/// benchmarks a single case
+/// \details
+///    rules without computed variable names read their values from
+///    a vector, the others through a json accessor. Cases that cannot
+///    be compiled or evaluated report the error instead of timings.
+bjsn::object run_case(const bench_case &bc, size_t n, size_t n_runs) {
+  bjsn::object res;
+
+  res["operator"] = bc.op;
+  res["types"] = bc.types;
+
+  try {
+    jsonlogic::logic_rule rule = jsonlogic::create_logic(bc.rule);
+    jsonlogic::evaluation_context ctx;
+    jsonlogic::variable_accessor accessor = jsonlogic::json_accessor(bc.data);
+    std::vector<jsonlogic::value_variant> values;
+    const bool computed = rule.has_computed_variable_names();
+
+    for (std::string_view name : rule.variable_names())
+      values.push_back(to_value_variant(bc.data.at(name)));
+
+    auto eval = [&]() -> jsonlogic::value_variant {
+      if (computed)
+        return rule.apply(ctx, accessor);
+
+      return rule.apply(ctx, std::span<const jsonlogic::value_variant>(values));
+    };
+
+    res["result"] = to_string(eval());
+
+    size_t truthy = 0;
+    auto lambda = [&] {
+      truthy = 0;
+      for (size_t i = 0; i < n; ++i)
+        truthy += jsonlogic::truthy(eval());
+    };
+
+    const std::uint64_t allocs = jsonlogic::allocation_count();
+    BenchmarkResult timing =
+        Benchmark(bc.op + " " + bc.types, lambda).run(n_runs);
+    const double evals = double(n);
+
+    res["mean_ns_per_eval"] = timing.mean_time() * 1e6 / evals;
+    res["min_ns_per_eval"] = timing.min_time() * 1e6 / evals;
+    res["allocations_per_eval"] =
+        double(jsonlogic::allocation_count() - allocs) / (evals * n_runs);
+  } catch (const std::exception &e) {
+    res["error"] = e.what();
+  }
+
+  return res;
+}
+
+int main(int argc, const char **argv) try {
+  cxxopts::Options options("benchmark-operators",
+                           "Per-operator JSONLogic microbenchmarks");
+  options.add_options()("n,evals", "Number of evaluations per run",
+                        cxxopts::value<size_t>()->default_value("100000"))(
+      "r,runs", "Number of runs", cxxopts::value<size_t>()->default_value("3"))(
+      "o,output", "Output JSON file",
+      cxxopts::value<std::string>()->default_value(
+          "benchmark-operators.json"))(
+      "p,operator", "Only run benchmarks of this operator",
+      cxxopts::value<std::string>())("h,help", "Print usage");
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  size_t N = result["evals"].as<size_t>();
+  size_t N_RUNS = result["runs"].as<size_t>();
+  std::string outfile = result["output"].as<std::string>();
+  std::string only =
+      result.count("operator") ? result["operator"].as<std::string>() : "";
+
+  bjsn::array results;
+
+  for (const bench_case &bc : make_cases()) {
+    if (!only.empty() && bc.op != only)
+      continue;
+
+    bjsn::object res = run_case(bc, N, N_RUNS);
+
+    if (const bjsn::value *err = res.if_contains("error"))
+      std::cout << bc.op << " " << bc.types << ": " << err->as_string()
+                << "\n";
+    else
+      std::cout << std::format("{} {}: {:.1f} ns/eval\n", bc.op, bc.types,
+                               res["mean_ns_per_eval"].as_double());
+
+    results.push_back(std::move(res));
+  }
+
+  bjsn::object report;
+
+  report["benchmark"] = "operators";
+  report["evals"] = N;
+  report["runs"] = N_RUNS;
+  report["results"] = std::move(results);
+
+  std::ofstream os(outfile);
+  if (!os)
+    throw std::runtime_error("Failed to open file: " + outfile);
+
+  os << report << std::endl;
+  std::cout << "results written to " << outfile << std::endl;
+  return 0;
+} catch (const std::exception &e) {
+  std::cerr << "Fatal error: " << e.what() << '\n';
+  return 1;
+} catch (...) {
+  std::cerr << "Fatal unknown error\n";
+  return 2;
+}
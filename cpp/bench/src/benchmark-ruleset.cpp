@@ -0,0 +1,320 @@
+#include <bench.hpp>
+#include <boost/json.hpp>
+#include <boost/json/src.hpp>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <jsonlogic/logic.hpp>
+#include <rule-generator.hpp>
+#include <string>
+#include <vector>
+
+namespace bjsn = boost::json;
+
+/// converts a json value to a value_variant
+jsonlogic::value_variant to_value_variant(const bjsn::value &n) {
+  switch (n.kind()) {
+  case bjsn::kind::string: {
+    const bjsn::string &str = n.get_string();
+    return jsonlogic::managed_string_view(
+        std::string_view(str.data(), str.size()));
+  }
+  case bjsn::kind::int64:
+    return n.get_int64();
+  case bjsn::kind::uint64:
+    return n.get_uint64();
+  case bjsn::kind::double_:
+    return n.get_double();
+  case bjsn::kind::bool_:
+    return n.get_bool();
+  case bjsn::kind::null:
+    return nullptr;
+  default:
+    throw std::runtime_error("Unsupported variable value");
+  }
+}
+
+/// returns the values of \p names in \p row
+std::vector<jsonlogic::value_variant>
+row_values(const bjsn::object &row,
+           const std::vector<std::string_view> &names) {
+  std::vector<jsonlogic::value_variant> vals;
+
+  for (std::string_view name : names)
+    vals.push_back(to_value_variant(row.at(name)));
+
+  return vals;
+}
+
+/// evaluates \p n_rules rules per event, once rule by rule and once
+///   as a rule_set
+/// \details
+///   with \p n_groups > 0, consecutive rules are split into n_groups
+///   groups; the rules of a group start with the same test of v0.
+bjsn::object run_point(const RuleShape &shape, size_t seed, size_t n_rules,
+                       size_t n_groups, size_t n_events, size_t n_runs,
+                       const jsonlogic::logic_options &opts,
+                       BenchReport &report) {
+  RuleGenerator gen(shape, seed);
+  std::vector<bjsn::value> rules;
+
+  for (size_t i = 0; i < n_rules; ++i) {
+    if (n_groups == 0) {
+      rules.push_back(gen.rule());
+      continue;
+    }
+
+    // v0 is an int; constants are drawn from [0, shape.constants)
+    const size_t group = i * n_groups / n_rules;
+    bjsn::object var, test, rule;
+    bjsn::array args, conds;
+
+    var["var"] = "v0";
+    args.push_back(std::move(var));
+    args.push_back(std::int64_t(group % shape.constants));
+    test["=="] = std::move(args);
+    conds.push_back(std::move(test));
+    conds.push_back(gen.rule());
+    rule["and"] = std::move(conds);
+    rules.push_back(std::move(rule));
+  }
+
+  std::vector<bjsn::object> events;
+
+  for (size_t i = 0; i < n_events; ++i)
+    events.push_back(gen.row());
+
+  // one logic_rule per rule; each rule has its own variable slots
+  std::vector<jsonlogic::logic_rule> logics;
+  std::vector<std::vector<std::vector<jsonlogic::value_variant>>> rule_values;
+
+  for (const bjsn::value &rule : rules) {
+    logics.push_back(jsonlogic::create_logic(rule, opts));
+
+    std::vector<std::vector<jsonlogic::value_variant>> vals;
+
+    for (const bjsn::object &event : events)
+      vals.push_back(row_values(event, logics.back().variable_names()));
+
+    rule_values.push_back(std::move(vals));
+  }
+
+  // the rule set shares the variable slots among all rules
+  jsonlogic::rule_set set = jsonlogic::create_rule_set(rules, opts);
+  std::vector<std::vector<jsonlogic::value_variant>> set_values;
+
+  for (const bjsn::object &event : events)
+    set_values.push_back(row_values(event, set.variable_names()));
+
+  jsonlogic::evaluation_context ctx;
+  size_t rule_matches = 0;
+  size_t set_matches = 0;
+  size_t index_matches = 0;
+  size_t rule_first = 0;
+  size_t set_first = 0;
+
+  auto rule_lambda = [&] {
+    rule_matches = 0;
+    for (size_t ev = 0; ev < n_events; ++ev)
+      for (size_t r = 0; r < n_rules; ++r)
+        rule_matches += jsonlogic::truthy(logics[r].apply(
+            ctx, std::span<const jsonlogic::value_variant>(
+                     rule_values[r][ev])));
+  };
+
+  // apply evaluates all rules
+  auto set_lambda = [&] {
+    set_matches = 0;
+    for (size_t ev = 0; ev < n_events; ++ev)
+      for (const jsonlogic::value_variant &val : set.apply(
+               ctx, std::span<const jsonlogic::value_variant>(set_values[ev])))
+        set_matches += jsonlogic::truthy(val);
+  };
+
+  // matching_rules only evaluates the rules selected by the index
+  auto index_lambda = [&] {
+    index_matches = 0;
+    for (size_t ev = 0; ev < n_events; ++ev)
+      index_matches +=
+          set.matching_rules(ctx, std::span<const jsonlogic::value_variant>(
+                                      set_values[ev]))
+              .size();
+  };
+
+  // the position of the first truthy rule, or n_rules
+  auto rule_first_lambda = [&] {
+    rule_first = 0;
+    for (size_t ev = 0; ev < n_events; ++ev) {
+      size_t r = 0;
+
+      while (r < n_rules &&
+             !jsonlogic::truthy(logics[r].apply(
+                 ctx, std::span<const jsonlogic::value_variant>(
+                          rule_values[r][ev]))))
+        ++r;
+
+      rule_first += r;
+    }
+  };
+
+  auto set_first_lambda = [&] {
+    set_first = 0;
+    for (size_t ev = 0; ev < n_events; ++ev)
+      set_first +=
+          set.first_match(ctx, std::span<const jsonlogic::value_variant>(
+                                   set_values[ev]))
+              .value_or(n_rules);
+  };
+
+  const std::string suffix = std::format("-{}", n_rules);
+  Benchmark rule_bench("rule-by-rule" + suffix, rule_lambda);
+  Benchmark set_bench("rule-set" + suffix, set_lambda);
+  Benchmark index_bench("rule-set-indexed" + suffix, index_lambda);
+  Benchmark rule_first_bench("first-rule-by-rule" + suffix, rule_first_lambda);
+  Benchmark set_first_bench("first-rule-set" + suffix, set_first_lambda);
+
+  rule_bench.warmup(report.warmup());
+  set_bench.warmup(report.warmup());
+  index_bench.warmup(report.warmup());
+  rule_first_bench.warmup(report.warmup());
+  set_first_bench.warmup(report.warmup());
+
+  BenchmarkResult rule_res = rule_bench.run(n_runs);
+  BenchmarkResult set_res = set_bench.run(n_runs);
+  BenchmarkResult index_res = index_bench.run(n_runs);
+  BenchmarkResult rule_first_res = rule_first_bench.run(n_runs);
+  BenchmarkResult set_first_res = set_first_bench.run(n_runs);
+
+  if (rule_matches != set_matches || rule_matches != index_matches)
+    throw std::runtime_error(std::format(
+        "Match counts differ: rule-by-rule {}, rule-set {}, indexed {}",
+        rule_matches, set_matches, index_matches));
+
+  if (rule_first != set_first)
+    throw std::runtime_error(
+        std::format("First matches differ: rule-by-rule {}, rule-set {}",
+                    rule_first, set_first));
+
+  report.add(rule_res);
+  report.add(set_res);
+  report.add(index_res);
+  report.add(rule_first_res);
+  report.add(set_first_res);
+
+  bjsn::object res;
+
+  res["rules"] = n_rules;
+  res["indexed_rules"] = set.indexed_rules();
+  res["variables"] = set.variable_names().size();
+  res["rule_ns"] = rule_res.mean_time() * 1e6 / double(n_events);
+  res["set_ns"] = set_res.mean_time() * 1e6 / double(n_events);
+  res["indexed_ns"] = index_res.mean_time() * 1e6 / double(n_events);
+  res["first_rule_ns"] = rule_first_res.mean_time() * 1e6 / double(n_events);
+  res["first_set_ns"] = set_first_res.mean_time() * 1e6 / double(n_events);
+  res["truthy"] = double(set_matches) / double(n_events * n_rules);
+  return res;
+}
+
+int main(int argc, const char **argv) try {
+  cxxopts::Options options("benchmark-ruleset",
+                           "Per-event cost of evaluating many rules, rule "
+                           "by rule and as a rule_set");
+  options.add_options()("n,events", "Number of events",
+                        cxxopts::value<size_t>()->default_value("100"))(
+      "rules", "Rule counts to measure",
+      cxxopts::value<std::vector<size_t>>()->default_value(
+          "1,10,100,1000,10000"))(
+      "depth", "Nesting levels of generated rules",
+      cxxopts::value<size_t>()->default_value("2"))(
+      "fanout", "Operands per and/or in generated rules",
+      cxxopts::value<size_t>()->default_value("3"))(
+      "vars", "Number of variables in generated rules",
+      cxxopts::value<size_t>()->default_value("16"))(
+      "constants", "Size of the constant set per type",
+      cxxopts::value<size_t>()->default_value("8"))(
+      "mix", "Operator weights, e.g. and:2,or:1,==:3,in:1",
+      cxxopts::value<std::string>())(
+      "groups", "Number of rule groups with a common first condition",
+      cxxopts::value<size_t>()->default_value("0"))(
+      "arena", "Allocate the nodes of each rule and of the rule set in an arena")(
+      "r,runs", "Number of runs", cxxopts::value<size_t>()->default_value("3"))(
+      "s,seed", "Random seed", cxxopts::value<size_t>()->default_value("42"))(
+      "o,output", "Output JSON file", cxxopts::value<std::string>())(
+      "h,help", "Print usage");
+
+  BenchReport report(parse_bench_settings(argc, argv));
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  const size_t N_EVENTS = result["events"].as<size_t>();
+  const size_t N_RUNS = result["runs"].as<size_t>();
+  const size_t SEED = result["seed"].as<size_t>();
+  const size_t N_GROUPS = result["groups"].as<size_t>();
+  jsonlogic::logic_options opts;
+  RuleShape shape;
+
+  opts.arena = result.count("arena") > 0;
+
+  shape.depth = result["depth"].as<size_t>();
+  shape.fanout = result["fanout"].as<size_t>();
+  shape.variables = result["vars"].as<size_t>();
+  shape.constants = result["constants"].as<size_t>();
+
+  if (result.count("mix"))
+    shape.mix = parse_mix(result["mix"].as<std::string>());
+
+  std::cout << std::format(
+      "{:>8} {:>8} {:>10} {:>16} {:>16} {:>16} {:>16} {:>16}\n", "rules",
+      "indexed", "variables", "rule-by-rule", "rule-set", "indexed",
+      "first-by-rule", "first-set");
+
+  bjsn::array results;
+
+  for (size_t n_rules : result["rules"].as<std::vector<size_t>>()) {
+    bjsn::object res =
+        run_point(shape, SEED, n_rules, N_GROUPS, N_EVENTS, N_RUNS, opts,
+                  report);
+
+    std::cout << std::format("{:>8} {:>8} {:>10} {:>13.0f} ns {:>13.0f} ns "
+                             "{:>13.0f} ns {:>13.0f} ns {:>13.0f} ns\n",
+                             n_rules, res["indexed_rules"].as_uint64(),
+                             res["variables"].as_uint64(),
+                             res["rule_ns"].as_double(),
+                             res["set_ns"].as_double(),
+                             res["indexed_ns"].as_double(),
+                             res["first_rule_ns"].as_double(),
+                             res["first_set_ns"].as_double());
+
+    results.push_back(std::move(res));
+  }
+
+  if (result.count("output")) {
+    const std::string outfile = result["output"].as<std::string>();
+    bjsn::object out;
+
+    out["benchmark"] = "ruleset";
+    out["events"] = N_EVENTS;
+    out["runs"] = N_RUNS;
+    out["seed"] = SEED;
+    out["groups"] = N_GROUPS;
+    out["arena"] = opts.arena;
+    out["results"] = std::move(results);
+
+    std::ofstream os(outfile);
+    if (!os)
+      throw std::runtime_error("Failed to open file: " + outfile);
+
+    os << out << std::endl;
+  }
+
+  return report.finish();
+} catch (const std::exception &e) {
+  std::cerr << "Fatal error: " << e.what() << '\n';
+  return 1;
+} catch (...) {
+  std::cerr << "Fatal unknown error\n";
+  return 2;
+}
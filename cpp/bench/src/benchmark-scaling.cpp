@@ -0,0 +1,207 @@
+#include <bench.hpp>
+#include <boost/json.hpp>
+#include <boost/json/src.hpp>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <jsonlogic/logic.hpp>
+#include <rule-generator.hpp>
+#include <string>
+#include <vector>
+
+namespace bjsn = boost::json;
+
+/// converts a json value to a value_variant
+jsonlogic::value_variant to_value_variant(const bjsn::value &n) {
+  switch (n.kind()) {
+  case bjsn::kind::string: {
+    const bjsn::string &str = n.get_string();
+    return jsonlogic::managed_string_view(
+        std::string_view(str.data(), str.size()));
+  }
+  case bjsn::kind::int64:
+    return n.get_int64();
+  case bjsn::kind::uint64:
+    return n.get_uint64();
+  case bjsn::kind::double_:
+    return n.get_double();
+  case bjsn::kind::bool_:
+    return n.get_bool();
+  case bjsn::kind::null:
+    return nullptr;
+  default:
+    throw std::runtime_error("Unsupported variable value");
+  }
+}
+
+/// a dimension of the rule shape and the values it is swept over
+struct sweep {
+  std::string name;
+  size_t RuleShape::*field;
+  std::vector<size_t> values;
+};
+
+const std::vector<sweep> SWEEPS = {
+    {"depth", &RuleShape::depth, {1, 2, 3, 4, 5, 6}},
+    {"fanout", &RuleShape::fanout, {1, 2, 4, 8, 16}},
+    {"vars", &RuleShape::variables, {1, 4, 16, 64, 256}},
+    {"constants", &RuleShape::constants, {2, 16, 128, 1024}},
+    {"array-length", &RuleShape::array_length, {1, 8, 64, 512}}};
+
+/// benchmarks compilation and evaluation of a rule of shape \p shape
+/// \details
+///   the benchmark names end in \p suffix, which identifies the point
+///   of the sweep in the report.
+bjsn::object run_point(const RuleShape &shape, size_t seed, size_t n_rows,
+                       size_t n_compiles, size_t n_runs,
+                       const std::string &suffix, BenchReport &report) {
+  RuleGenerator gen(shape, seed);
+  const bjsn::value rule = gen.rule();
+  bjsn::object res;
+
+  res["operators"] = RuleGenerator::operator_count(rule);
+
+  // compilation
+  auto compile = [&] {
+    for (size_t i = 0; i < n_compiles; ++i)
+      jsonlogic::create_logic(rule);
+  };
+
+  BenchmarkResult ctime = Benchmark("create_logic" + suffix, compile)
+                              .warmup(report.warmup())
+                              .run(n_runs);
+
+  res["create_logic_us"] = ctime.mean_time() * 1e3 / double(n_compiles);
+
+  // evaluation over rows; the rows own the strings the values refer to
+  jsonlogic::logic_rule logic = jsonlogic::create_logic(rule);
+  std::vector<bjsn::object> rows;
+  std::vector<std::vector<jsonlogic::value_variant>> values;
+
+  rows.reserve(n_rows);
+  for (size_t i = 0; i < n_rows; ++i)
+    rows.push_back(gen.row());
+
+  for (const bjsn::object &row : rows) {
+    std::vector<jsonlogic::value_variant> vals;
+
+    for (std::string_view name : logic.variable_names())
+      vals.push_back(to_value_variant(row.at(name)));
+
+    values.push_back(std::move(vals));
+  }
+
+  size_t matches = 0;
+  auto eval = [&] {
+    matches = 0;
+    for (const std::vector<jsonlogic::value_variant> &vals : values)
+      matches += jsonlogic::truthy(
+          logic.apply(std::span<const jsonlogic::value_variant>(vals)));
+  };
+
+  BenchmarkResult etime =
+      Benchmark("apply" + suffix, eval).warmup(report.warmup()).run(n_runs);
+
+  report.add(ctime);
+  report.add(etime);
+
+  res["eval_ns"] = etime.mean_time() * 1e6 / double(n_rows);
+  res["truthy"] = double(matches) / double(n_rows);
+  return res;
+}
+
+int main(int argc, const char **argv) try {
+  cxxopts::Options options(
+      "benchmark-scaling",
+      "Scaling of create_logic and evaluation with the rule shape");
+  options.add_options()("n,nrows", "Number of data rows",
+                        cxxopts::value<size_t>()->default_value("1000"))(
+      "c,compiles", "Number of create_logic calls per run",
+      cxxopts::value<size_t>()->default_value("100"))(
+      "r,runs", "Number of runs", cxxopts::value<size_t>()->default_value("3"))(
+      "d,dimension", "Only sweep this dimension",
+      cxxopts::value<std::string>())(
+      "types", "Variable type codes, assigned round-robin (i, d, s, b)",
+      cxxopts::value<std::string>()->default_value("idsb"))(
+      "mix", "Operator weights, e.g. and:2,or:1,==:3,in:1",
+      cxxopts::value<std::string>())(
+      "s,seed", "Random seed", cxxopts::value<size_t>()->default_value("42"))(
+      "o,output", "Output JSON file", cxxopts::value<std::string>())(
+      "h,help", "Print usage");
+
+  BenchReport report(parse_bench_settings(argc, argv));
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  const size_t N = result["nrows"].as<size_t>();
+  const size_t N_COMPILES = result["compiles"].as<size_t>();
+  const size_t N_RUNS = result["runs"].as<size_t>();
+  const size_t SEED = result["seed"].as<size_t>();
+  const std::string only =
+      result.count("dimension") ? result["dimension"].as<std::string>() : "";
+
+  RuleShape base;
+
+  base.types = result["types"].as<std::string>();
+  if (result.count("mix"))
+    base.mix = parse_mix(result["mix"].as<std::string>());
+
+  bjsn::array results;
+
+  for (const sweep &sw : SWEEPS) {
+    if (!only.empty() && sw.name != only)
+      continue;
+
+    std::cout << "\n"
+              << std::format("{:>12} {:>10} {:>14} {:>12} {:>8}\n", sw.name,
+                             "operators", "create_logic", "eval", "truthy");
+
+    for (size_t value : sw.values) {
+      RuleShape shape = base;
+
+      shape.*sw.field = value;
+
+      bjsn::object res =
+          run_point(shape, SEED, N, N_COMPILES, N_RUNS,
+                    std::format("-{}-{}", sw.name, value), report);
+
+      std::cout << std::format(
+          "{:>12} {:>10} {:>11.2f} us {:>9.1f} ns {:>8.2f}\n", value,
+          res["operators"].as_uint64(), res["create_logic_us"].as_double(),
+          res["eval_ns"].as_double(), res["truthy"].as_double());
+
+      res["dimension"] = sw.name;
+      res["value"] = value;
+      results.push_back(std::move(res));
+    }
+  }
+
+  if (result.count("output")) {
+    const std::string outfile = result["output"].as<std::string>();
+    bjsn::object out;
+
+    out["benchmark"] = "scaling";
+    out["rows"] = N;
+    out["compiles"] = N_COMPILES;
+    out["runs"] = N_RUNS;
+    out["seed"] = SEED;
+    out["results"] = std::move(results);
+
+    std::ofstream os(outfile);
+    if (!os)
+      throw std::runtime_error("Failed to open file: " + outfile);
+
+    os << out << std::endl;
+  }
+
+  return report.finish();
+} catch (const std::exception &e) {
+  std::cerr << "Fatal error: " << e.what() << '\n';
+  return 1;
+} catch (...) {
+  std::cerr << "Fatal unknown error\n";
+  return 2;
+}
@@ -0,0 +1,82 @@
+#include <boost/json.hpp>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <rule-generator.hpp>
+#include <string>
+
+namespace bjsn = boost::json;
+
+int main(int argc, const char **argv) try {
+  cxxopts::Options options(
+      "generate-rule",
+      "Generates a random JSONLogic rule in benchmark-generic's format");
+  options.add_options()("depth", "Nesting levels of logical operators",
+                        cxxopts::value<size_t>()->default_value("3"))(
+      "fanout", "Operands per and/or",
+      cxxopts::value<size_t>()->default_value("3"))(
+      "vars", "Number of variables",
+      cxxopts::value<size_t>()->default_value("4"))(
+      "constants", "Size of the constant set per type",
+      cxxopts::value<size_t>()->default_value("16"))(
+      "array-length", "Length of arrays tested by 'in'",
+      cxxopts::value<size_t>()->default_value("8"))(
+      "types", "Variable type codes, assigned round-robin (i, d, s, b)",
+      cxxopts::value<std::string>()->default_value("idsb"))(
+      "mix", "Operator weights, e.g. and:2,or:1,==:3,in:1",
+      cxxopts::value<std::string>())(
+      "rows", "Number of data rows to include (0 = none)",
+      cxxopts::value<size_t>()->default_value("0"))(
+      "s,seed", "Random seed", cxxopts::value<size_t>()->default_value("42"))(
+      "o,output", "Output JSON file (default: stdout)",
+      cxxopts::value<std::string>())("h,help", "Print usage");
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  RuleShape shape;
+
+  shape.depth = result["depth"].as<size_t>();
+  shape.fanout = result["fanout"].as<size_t>();
+  shape.variables = result["vars"].as<size_t>();
+  shape.constants = result["constants"].as<size_t>();
+  shape.array_length = result["array-length"].as<size_t>();
+  shape.types = result["types"].as<std::string>();
+
+  if (result.count("mix"))
+    shape.mix = parse_mix(result["mix"].as<std::string>());
+
+  RuleGenerator gen(shape, result["seed"].as<size_t>());
+  bjsn::object out = gen.benchmark_input();
+
+  if (const size_t n_rows = result["rows"].as<size_t>()) {
+    bjsn::array rows;
+
+    for (size_t i = 0; i < n_rows; ++i)
+      rows.push_back(gen.row());
+
+    out["data"] = std::move(rows);
+  }
+
+  if (!result.count("output")) {
+    std::cout << out << std::endl;
+    return 0;
+  }
+
+  const std::string outfile = result["output"].as<std::string>();
+  std::ofstream os(outfile);
+  if (!os)
+    throw std::runtime_error("Failed to open file: " + outfile);
+
+  os << out << std::endl;
+  return 0;
+} catch (const std::exception &e) {
+  std::cerr << "Fatal error: " << e.what() << '\n';
+  return 1;
+} catch (...) {
+  std::cerr << "Fatal unknown error\n";
+  return 2;
+}
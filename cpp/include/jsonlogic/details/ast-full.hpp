@@ -1,11 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <map>
 #include <set>
+#include <span>
 #include <vector>
 #include <iosfwd>
 #include <iostream>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "cxx-compat.hpp"
@@ -15,6 +22,79 @@ namespace jsonlogic {
 
 struct visitor;
 
+/// memory for the nodes of a rule
+/// \details
+///   while an arena is active on a thread (see node_arena::scope), the
+///   nodes and operand arrays that the thread creates are allocated from
+///   the arena in creation order. Releasing memory of the active arena
+///   has no effect; the arena frees all its memory when it is destroyed.
+///   Thus, nodes in an arena must be destroyed while the arena is active.
+struct node_arena {
+    /// \param capacity the size of the first block
+    explicit node_arena(std::size_t capacity);
+    ~node_arena();
+
+    /// makes an arena the active arena of the current thread
+    struct scope {
+        explicit scope(node_arena& arena);
+        ~scope();
+
+      private:
+        scope(const scope&)            = delete;
+        scope& operator=(const scope&) = delete;
+
+        node_arena* prev;
+    };
+
+    /// allocates from the active arena, or from the heap
+    static void* allocate(std::size_t sz, std::size_t align);
+
+    /// releases memory returned by allocate
+    static void deallocate(void* p, std::size_t sz) noexcept;
+
+    /// returns the number of allocated bytes
+    std::size_t size() const { return used; }
+
+    /// returns the number of memory blocks
+    std::size_t blocks() const { return chunks.size(); }
+
+  private:
+    node_arena(const node_arena&)            = delete;
+    node_arena& operator=(const node_arena&) = delete;
+
+    struct block {
+      std::unique_ptr<std::byte[]> mem;
+      std::size_t                  size;
+    };
+
+    bool contains(const void* p) const;
+
+    void* bump(std::size_t sz, std::size_t align);
+
+    std::vector<block> chunks;
+    std::size_t        top  = 0;  ///< offset into the last block
+    std::size_t        used = 0;
+};
+
+/// allocator for operand arrays (see node_arena)
+template <class T>
+struct node_allocator {
+  using value_type = T;
+
+  node_allocator() = default;
+
+  template <class U>
+  node_allocator(const node_allocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(node_arena::allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept { node_arena::deallocate(p, n * sizeof(T)); }
+
+  friend bool operator==(node_allocator, node_allocator) { return true; }
+};
+
 // the root class
 struct expr {
   virtual ~expr()               = default;
@@ -25,12 +105,18 @@ struct expr {
   expr &operator=(const expr &) = default;
 
   virtual void accept(visitor &) const = 0;
+
+  /// nodes are allocated in the active node_arena, if any
+  /// \{
+  static void* operator new(std::size_t sz);
+  static void operator delete(void* p, std::size_t sz) noexcept;
+  /// \}
 };
 
 using any_expr = std::unique_ptr<expr>;
 
-struct oper : expr, private std::vector<any_expr> {
-  using container_type = std::vector<any_expr>;
+struct oper : expr, private std::vector<any_expr, node_allocator<any_expr>> {
+  using container_type = std::vector<any_expr, node_allocator<any_expr>>;
 
   using container_type::at;
   using container_type::back;
@@ -145,11 +231,27 @@ struct logical_not_not : oper_n<1> {
 };
 
 // n-ary
-struct logical_and : oper {
+
+/// common base of logical_and and logical_or
+struct junction : oper {
+  enum { no_profile = -1 };
+
+  /// index of the operator's profile for adaptive operand ordering
+  ///   (see logic_data::junction_profiles), or no_profile.
+  /// \{
+  void profile(int id) { prof = id; }
+  int profile() const { return prof; }
+  /// \}
+
+private:
+  int prof = no_profile;
+};
+
+struct logical_and : junction {
   void accept(visitor &) const final;
 };
 
-struct logical_or : oper {
+struct logical_or : junction {
   void accept(visitor &) const final;
 };
 
@@ -240,13 +342,34 @@ struct merge : oper {
 struct var : oper {
   enum { computed = -1 };
 
+  /// scope of a variable that is resolved through the variable accessor
+  enum { global_scope = -1 };
+
+  /// slots in a lambda frame (opened by map, filter, reduce, all, none, some)
+  enum { element_slot = 0, accumulator_slot = 1 };
+
   void accept(visitor &) const final;
 
+  /// the slot number of a variable
+  /// \details
+  ///   for variables in global scope, num is the index into the
+  ///   variable names of the rule (or computed). For variables in a
+  ///   lambda scope, num is the slot in the lambda frame.
+  /// \{
   void num(int val) { idx = val; }
-  std::int16_t num() const { return idx; }
+  std::int32_t num() const { return idx; }
+  /// \}
+
+  /// the nesting level of the lambda frame that binds the variable,
+  ///   or global_scope.
+  /// \{
+  void scope(int lvl) { frame = lvl; }
+  std::int32_t scope() const { return frame; }
+  /// \}
 
 private:
-  std::int16_t idx = computed;
+  std::int32_t idx = computed;
+  std::int32_t frame = global_scope;
 };
 
 /// missing is modeled as operator with arbitrary number of arguments
@@ -290,6 +413,29 @@ struct opt_membership_array : oper_n<1> {
   private:
     std::unordered_set<value_variant> elements;
 };
+
+/// refers to a subexpression that occurs more than once in a rule
+/// \details
+///   the shared subexpression is owned by the rule's table of common
+///   subexpressions (see logic_data::common_subexpressions) and is
+///   evaluated at most once per evaluation.
+struct common_subexpr : expr {
+    common_subexpr(int id, const expr& shared)
+    : num(id), subexpr(&shared)
+    {}
+
+    void accept(visitor &) const final;
+
+    /// index into the table of common subexpressions
+    int id() const { return num; }
+
+    /// the shared subexpression
+    const expr& shared() const { return *subexpr; }
+
+  private:
+    int         num;
+    const expr* subexpr;
+};
 #endif /*ENABLE_OPTIMIZATIONS*/
 
 
@@ -404,6 +550,25 @@ struct error : expr {
   void accept(visitor &) const final;
 };
 
+/// refers to an immutable subtree that several rules share
+/// \details
+///   the subtree is owned jointly by all nodes that refer to it
+///   (see rule_store) and is evaluated in place of the node.
+struct interned_expr : expr {
+    explicit
+    interned_expr(std::shared_ptr<const expr> subtree)
+    : target(std::move(subtree))
+    {}
+
+    void accept(visitor &) const final;
+
+    /// the shared subtree
+    const expr& shared() const { return *target; }
+
+  private:
+    std::shared_ptr<const expr> target;
+};
+
 //
 // jsonlogic extensions
 
@@ -469,6 +634,8 @@ struct visitor {
 
   virtual void visit(const error &) = 0;
 
+  virtual void visit(const interned_expr &) = 0;
+
 #if WITH_JSON_LOGIC_CPP_EXTENSIONS
   // extensions
   virtual void visit(const regex_match &) = 0;
@@ -477,6 +644,7 @@ struct visitor {
 #if ENABLE_OPTIMIZATIONS
   // extensions
   virtual void visit(const opt_membership_array &) = 0;
+  virtual void visit(const common_subexpr &) = 0;
 #endif /* ENABLE_OPTIMIZATIONS */
 };
 
@@ -559,6 +727,8 @@ struct generic_dispatcher : visitor {
 
   void visit(const error &n) final { res = apply(n, &n); }
 
+  void visit(const interned_expr &n) final { res = apply(n, &n); }
+
 #if WITH_JSON_LOGIC_CPP_EXTENSIONS
   // extensions
   void visit(const regex_match &n) final { res = apply(n, &n); }
@@ -566,6 +736,7 @@ struct generic_dispatcher : visitor {
 
 #if ENABLE_OPTIMIZATIONS
   void visit(const opt_membership_array &n) final { res = apply(n, &n); }
+  void visit(const common_subexpr &n) final { res = apply(n, &n); }
 #endif /*ENABLE_OPTIMIZATIONS*/
 
   result_type result() && { return std::move(res); }
@@ -598,12 +769,154 @@ auto generic_visit(ast_functor fn, ast_node *n, arguments... args)
   return std::move(disp).result();
 }
 
-using logic_data_base = std::tuple<any_expr, std::vector<std::string_view>, bool>;
+/// observed behavior of the operands of a junction (and/or)
+struct junction_profile {
+  struct operand_stats {
+    std::uint64_t evaluations = 0;  ///< number of times the operand was evaluated
+    std::uint64_t decisions   = 0;  ///< number of times the operand decided the junction
+    std::uint64_t cost        = 0;  ///< accumulated evaluation time in ns
+  };
+
+  /// statistics per operand, in source order
+  std::vector<operand_stats> operands;
+
+  /// evaluation order (indices into operands)
+  std::vector<int> order;
+
+  /// number of evaluations since the order was last computed
+  std::uint32_t evaluations = 0;
+};
+
+/// statistics of a node in a profiled evaluation
+struct node_profile {
+  const expr*   node        = nullptr;  ///< the profiled node (nullptr for the root entry)
+  std::uint32_t parent      = 0;        ///< index of the entry of the parent node
+  std::uint64_t evaluations = 0;        ///< number of evaluations
+  std::uint64_t truthy      = 0;        ///< number of truthy results
+  std::uint64_t falsy       = 0;        ///< number of falsy results
+  std::uint64_t cycles      = 0;        ///< inclusive time in cycle counter ticks
+  std::uint64_t allocations = 0;        ///< inclusive number of value allocations
+};
+
+/// per-node statistics of profiled evaluations
+/// \details
+///   entries form a calling context tree. A node that is evaluated
+///   under different parents (e.g., the shared expression of a
+///   common_subexpr) has one entry per parent.
+struct evaluation_profile {
+  /// denotes a node without entry
+  static constexpr std::uint32_t npos = std::uint32_t(-1);
+
+  /// entries[0] is the root of the calling context tree
+  std::vector<node_profile> entries = { node_profile{} };
+
+  /// maps (parent entry, node) to an index into entries
+  std::map<std::pair<std::uint32_t, const expr*>, std::uint32_t> index;
+
+  /// the entry of the node that is currently evaluated
+  std::uint32_t current = 0;
+
+  /// returns the entry of \p n under the entry \p parent; creates it if needed
+  std::uint32_t entry(std::uint32_t parent, const expr& n);
+
+  /// returns the entry of \p n under the entry \p parent, or npos if \p n was not evaluated
+  std::uint32_t find(std::uint32_t parent, const expr& n) const;
+};
+
+/// necessary conditions of the rules of a rule set
+/// \details
+///   an indexed rule is associated with one condition on a variable that
+///   holds whenever the rule is truthy (e.g., an operand of the rule's
+///   top-level and). Before the rules are evaluated, the index reads the
+///   variables and selects the rules whose condition may hold.
+///   Conditions are evaluated conservatively: when a value's type requires
+///   a conversion (e.g., comparing a string to a number), the rules are
+///   selected regardless of the value.
+struct predicate_index {
+  /// a range of numbers
+  struct interval {
+    double        lo;
+    double        hi;
+    bool          lo_open;
+    bool          hi_open;
+    std::uint32_t rule;
+  };
+
+  /// conditions on a single variable
+  struct variable_conditions {
+    /// a node that reads the variable
+    const expr* variable = nullptr;
+
+    /// rules that are selected by a value of the same type
+    std::unordered_map<value_variant, std::vector<std::uint32_t>> equal;
+
+    /// rules of loose (==) and strict (===) equality conditions by the
+    ///   type (variant index) of the compared value. They are selected
+    ///   when the variable's value has a different type.
+    std::map<std::size_t, std::vector<std::uint32_t>> typed;
+
+    /// range conditions, sorted by lower bound
+    std::vector<interval> ranges;
+
+    /// maxhi[i] is the largest upper bound in the implicit search tree
+    ///   over ranges that is rooted at i.
+    std::vector<double> maxhi;
+  };
+
+  std::vector<variable_conditions> variables;
+
+  /// rules without condition
+  std::vector<std::uint32_t> unindexed;
+};
+
+/// evaluation plan for the first truthy rule of a rule set
+/// \details
+///   consecutive rules whose top-level and starts with the same
+///   conditions form a group. The group's conditions are evaluated
+///   once; when one is falsy, all rules of the group are skipped.
+struct first_match_plan {
+  struct step {
+    /// conditions that are evaluated in order
+    std::vector<const expr*> conditions;
+
+    /// the next step when a condition is falsy
+    std::uint32_t skip = 0;
+
+    /// the rule that matches when all conditions are truthy;
+    ///   no_rule for the step that opens a group.
+    std::uint32_t rule = no_rule;
+  };
+
+  static constexpr std::uint32_t no_rule = std::uint32_t(-1);
+
+  std::vector<step> steps;
+};
+
+/// number of nodes and their estimated memory
+struct tree_footprint {
+  std::size_t nodes = 0;
+  std::size_t bytes = 0;
+};
+
+/// memory use of a rule that was created by a rule_store
+struct rule_footprint {
+  tree_footprint translated;  ///< the rule as created by create_logic
+  tree_footprint own;         ///< the nodes that are not shared
+};
+
+using logic_data_base = std::tuple< any_expr,
+                                    std::vector<std::string_view>,
+                                    bool,
+                                    std::vector<std::uint32_t>,
+                                    std::vector<any_expr>
+                                  >;
 struct logic_data : logic_data_base
 {
   using base = logic_data_base;
   using base::base;
 
+  ~logic_data();
+
   /// returns the logic expression
   any_expr const &syntax_tree() const { return std::get<0>(*this); }
 
@@ -612,6 +925,97 @@ struct logic_data : logic_data_base
 
   /// returns if the expression contains computed names.
   bool has_computed_variable_names() const { return std::get<2>(*this); }
+
+  /// returns the number of occurrences of each static variable name
+  std::vector<std::uint32_t> const &variable_uses() const { return std::get<3>(*this); }
+
+  /// returns the subexpressions that are shared by common_subexpr nodes
+  std::vector<any_expr> const &common_subexpressions() const { return std::get<4>(*this); }
+
+  /// returns true if a static variable name occurs more than once
+  bool has_repeated_variables() const {
+    return std::any_of( variable_uses().begin(), variable_uses().end(),
+                        [](std::uint32_t cnt) -> bool { return cnt > 1; }
+                      );
+  }
+
+  /// profiles of junctions whose operands can be reordered
+  ///   (see junction::profile)
+  std::vector<junction_profile> junction_profiles;
+
+  /// true if junction operands are reordered based on their profiles
+  bool adaptive_ordering = false;
+
+  /// per-node statistics, if profiling is on
+  std::unique_ptr<evaluation_profile> profile;
+
+  /// the index of a rule set, if any
+  std::unique_ptr<predicate_index> index;
+
+  /// the first match plan of a rule set, if any
+  std::unique_ptr<first_match_plan> plan;
+
+  /// the memory use of a rule created by a rule_store, if any;
+  ///   the store observes the footprint while the rule is alive.
+  std::shared_ptr<const rule_footprint> footprint;
+
+  /// the memory of the nodes, if they are allocated in an arena
+  std::unique_ptr<node_arena> arena;
+};
+
+/// internal state of an evaluation_context
+struct evaluation_context_data
+{
+  /// a lambda frame holds the values of the variables bound
+  ///   by map, filter, reduce, all, none, and some.
+  using lambda_frame = std::array<const value_variant*, 2>;
+  using logger_type  = std::function<void(const value_variant&)>;
+
+  /// called by the log operator
+  logger_type logger;
+
+  /// lambda frames of the current evaluation
+  std::vector<lambda_frame> frames;
+
+  /// variable access state of the current evaluation
+  /// \{
+  const variable_resolver* resolver = nullptr;
+  std::span<const value_variant> slots;
+  /// \}
+
+  /// per-evaluation memoization of non-computed variables
+  /// \details
+  ///   all non-computed variables are memoized when memoize_slots is set,
+  ///   otherwise only those with slot_uses[i] > 1.
+  ///   slot_cache[i] is valid iff slot_epoch[i] == epoch; a mono value
+  ///   marks a variable that the resolver could not provide.
+  /// \{
+  bool memoize_slots = false;
+  std::span<const std::uint32_t> slot_uses;
+  std::uint32_t epoch = 0;
+  std::vector<value_variant> slot_cache;
+  std::vector<std::uint32_t> slot_epoch;
+  /// \}
+
+  /// per-evaluation values of common subexpressions
+  /// \details
+  ///   shared_cache[i] is valid iff shared_epoch[i] == epoch.
+  /// \{
+  std::vector<value_variant> shared_cache;
+  std::vector<std::uint32_t> shared_epoch;
+  /// \}
+
+  /// junction profiles of the current rule, if adaptive ordering is on
+  junction_profile* profiles = nullptr;
+
+  /// per-node statistics of the current rule, if profiling is on
+  evaluation_profile* profile = nullptr;
+
+  /// statistics of evaluations that memoize variables
+  evaluation_statistics stats;
+
+  /// true while an evaluation uses this context
+  bool in_use = false;
 };
 
 
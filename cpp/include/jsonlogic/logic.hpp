@@ -1,6 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
 #include <boost/json.hpp>
 
 #include "managed_string_view.hpp"
@@ -93,6 +99,65 @@ bool operator==(const value_variant& lhs, const value_variant& rhs);
 using variable_accessor =
     std::function<value_variant(value_variant, int)>;
 
+/// Non-owning reference to a variable accessor
+/// \details
+///    a variable_resolver refers to a callable object fn that is invoked
+///    either as fn(key, idx) (see variable_accessor), or as fn(idx).
+///    The latter form only resolves non-computed variable names, but it
+///    is called without constructing the key.
+///    Unlike variable_accessor, a variable_resolver does not allocate and
+///    does not copy fn. fn must outlive the variable_resolver; temporaries
+///    passed to logic_rule::apply live long enough.
+struct variable_resolver {
+    template <class Fn>
+    requires ( !std::is_same_v<std::remove_cvref_t<Fn>, variable_resolver>
+               && ( std::is_invocable_r_v<value_variant, Fn&, const value_variant&, int>
+                    || std::is_invocable_r_v<value_variant, Fn&, int>
+                  )
+             )
+    variable_resolver(Fn&& fn)
+    : obj(std::addressof(fn)),
+      fun(&invoke<std::remove_reference_t<Fn>>),
+      slots(std::is_invocable_r_v<value_variant, Fn&, int>)
+    {}
+
+    /// resolves a variable by key \p key and precomputed index \p idx
+    value_variant operator()(const value_variant& key, int idx) const {
+      return fun(obj, &key, idx);
+    }
+
+    /// resolves the non-computed variable with index \p idx
+    /// \pre resolves_slots()
+    value_variant operator()(int idx) const {
+      return fun(obj, nullptr, idx);
+    }
+
+    /// returns true if non-computed variables can be resolved without a key
+    bool resolves_slots() const { return slots; }
+
+  private:
+    using fun_type = value_variant (*)(const void*, const value_variant*, int);
+
+    template <class Fn>
+    static value_variant invoke(const void* obj, const value_variant* key, int idx) {
+      Fn& fn = *static_cast<Fn*>(const_cast<void*>(obj));
+
+      if constexpr (std::is_invocable_r_v<value_variant, Fn&, int>) {
+        if (idx >= 0) return fn(idx);
+      }
+
+      if constexpr (std::is_invocable_r_v<value_variant, Fn&, const value_variant&, int>) {
+        if (key) return fn(*key, idx);
+      }
+
+      throw std::logic_error{"unable to access (computed) variable"};
+    }
+
+    const void* obj;
+    fun_type    fun;
+    bool        slots;
+};
+
 
 #if DEPRECATED_FIX_STRINGS
 
@@ -159,10 +224,75 @@ bool falsy(const value_variant &el);
 /// \pre n must be a value
 std::ostream &operator<<(std::ostream &os, const value_variant &n);
 
+/// returns an estimate of the heap allocations that jsonlogic performed
+///   on behalf of the calling thread.
+/// \details
+///    counts values created by evaluations (arrays, copies of arrays,
+///    and strings), compiled regular expressions, and the variable
+///    accessors created by json_accessor and variant_accessor.
+///    The count is kept at the sites that create these objects; it is
+///    not an allocator hook, so other allocations (e.g., inside the
+///    standard library, or the amortized growth of evaluation_context
+///    storage) are not seen, and the count of a site may differ from
+///    the number of allocations it performs.
+///    The difference of two calls estimates the number of allocations
+///    in between. To prove that a rule does not allocate, count the
+///    calls of the global allocation functions instead (as testeval does).
+std::uint64_t allocation_count();
+
 /// result type of create_logic
 //~ using logic_rule_base = std::tuple<any_expr, std::vector<std::string_view>, bool>;
 
 struct logic_data;
+struct evaluation_context_data;
+struct rule_store_data;
+struct rule_cache_data;
+
+/// counts variable requests of evaluations with memoized variables
+struct evaluation_statistics {
+    /// number of evaluations
+    std::size_t evaluations    = 0;
+
+    /// sum of the number of non-computed variables over all evaluations
+    std::size_t slots          = 0;
+
+    /// number of non-computed variables that were requested from a resolver
+    std::size_t slots_demanded = 0;
+};
+
+/// reusable state for evaluating logic rules
+/// \details
+///    an evaluation_context owns the scratch storage, the logger, and the
+///    variable access state that an evaluation needs. Reusing a context
+///    across calls to logic_rule::apply avoids per-call setup allocations.
+///    A context can only be used by one evaluation at a time; create one
+///    context per thread.
+struct evaluation_context {
+    evaluation_context();
+    evaluation_context(evaluation_context&&);
+    evaluation_context& operator=(evaluation_context&&);
+    ~evaluation_context();
+
+    /// sets the function that is called by the log operator.
+    /// \details
+    ///    by default, values are printed to std::cerr.
+    void logger(std::function<void(const value_variant&)> fn);
+
+    /// returns statistics collected by evaluations that memoize variables
+    /// \{
+    const evaluation_statistics& statistics() const;
+    void reset_statistics();
+    /// \}
+
+    /// returns the data held internally for internal use.
+    evaluation_context_data& internal_data();
+
+  private:
+    evaluation_context(const evaluation_context&)            = delete;
+    evaluation_context& operator=(const evaluation_context&) = delete;
+
+    std::unique_ptr<evaluation_context_data> data;
+};
 
 /// convenience class providing named accessors to logic_rule_base
 struct logic_rule {
@@ -185,10 +315,10 @@ struct logic_rule {
     /// \throws variable_resolution_error when evaluation accesses a variable
     value_variant apply() ;
 
-    /// evaluates the logic_rule and uses \p var_accessor to query variables.
-    /// \param var_accessor a variable accessor to retrieve variables from the context
+    /// evaluates the logic_rule and uses \p vars to query variables.
+    /// \param vars a variable accessor to retrieve variables from the context
     /// \return a jsonlogic value
-    value_variant apply(const variable_accessor &var_accessor) ;
+    value_variant apply(variable_resolver vars) ;
 
     /// evaluates the logic_rule and uses \p vars to obtain values for non-computed variable names.
     /// \param  vars a variable array with values for non-computed variable names.
@@ -196,8 +326,107 @@ struct logic_rule {
     /// \throws variable_resolution_error when evaluation accesses a computed variable name
     value_variant apply(std::vector<value_variant> vars) ;
 
+    /// evaluates the logic_rule and uses \p vars to obtain values for non-computed variable names.
+    /// \param  vars values for non-computed variable names; vars is accessed in place.
+    /// \return a jsonlogic value
+    /// \throws std::logic_error when evaluation accesses a computed variable name
+    value_variant apply(std::span<const value_variant> vars) ;
+
+    /// evaluates the logic_rule using the scratch storage in \p ctx.
+    /// \param ctx          an evaluation context that is not used by another evaluation
+    /// \param vars a variable accessor to retrieve variables from the context
+    /// \return a jsonlogic value
+    /// \throws std::logic_error when \p ctx is already in use
+    value_variant apply(evaluation_context& ctx, variable_resolver vars) ;
+
+    /// evaluates the logic_rule and requests values of non-computed variables
+    ///   from \p provider on first use.
+    /// \details
+    ///   a value is requested at most once per evaluation and memoized
+    ///   for the remainder of the evaluation. Variables that are not read
+    ///   (e.g., due to short-circuit evaluation) are never requested.
+    ///   The number of requested variables is recorded in the
+    ///   statistics of the evaluation context.
+    /// \param provider a slot provider fn(idx) or a variable accessor fn(key, idx)
+    /// \return a jsonlogic value
+    /// \{
+    value_variant apply_lazy(variable_resolver provider) ;
+    value_variant apply_lazy(evaluation_context& ctx, variable_resolver provider) ;
+    /// \}
+
+    /// evaluates the logic_rule using the scratch storage in \p ctx.
+    /// \param ctx  an evaluation context that is not used by another evaluation
+    /// \param vars values for non-computed variable names; vars is accessed in place.
+    /// \return a jsonlogic value
+    /// \throws std::logic_error when \p ctx is already in use
+    ///         or when evaluation accesses a computed variable name
+    value_variant apply(evaluation_context& ctx, std::span<const value_variant> vars) ;
+
+    /// evaluates the logic_rule for each row in a row-major block of values.
+    /// \param matrix n_rows * stride values; row i starts at matrix + i * stride
+    ///        and holds the values for the non-computed variable names.
+    /// \param n_rows number of rows
+    /// \param stride distance between two rows; stride >= variable_names().size()
+    /// \param out    receives the result of row i in out[i]
+    /// \throws std::logic_error when stride is too small
+    ///         or when evaluation accesses a computed variable name
+    /// \{
+    void apply_rows( const value_variant* matrix, std::size_t n_rows, std::size_t stride,
+                     value_variant* out
+                   ) ;
+
+    void apply_rows( evaluation_context& ctx,
+                     const value_variant* matrix, std::size_t n_rows, std::size_t stride,
+                     value_variant* out
+                   ) ;
+    /// \}
+
+    /// turns adaptive ordering of and/or operands on or off.
+    /// \details
+    ///    when on, the evaluator records how often each operand of an
+    ///    and/or decides the result and how long it takes to evaluate.
+    ///    Periodically, side-effect free operands are reordered so that
+    ///    cheap and selective operands are evaluated first.
+    ///    The result is the same as with source order evaluation:
+    ///    the first falsy (and) or truthy (or) operand in source order,
+    ///    or the last operand. When an operand evaluated out of order
+    ///    throws, the operator is re-evaluated in source order.
+    ///    A rule with adaptive ordering must not be applied concurrently.
+    ///    Requires ENABLE_OPTIMIZATIONS; otherwise, the call has no effect.
+    void adaptive_ordering(bool enable);
+
+    /// turns per-node profiling on or off.
+    /// \details
+    ///    when on, evaluations record for each node of the rule the
+    ///    number of evaluations, truthy and falsy results, the inclusive
+    ///    time in cycle counter ticks, and the inclusive number of
+    ///    heap allocated values. Turning profiling on discards previously
+    ///    collected statistics. Profiling slows down evaluation; a rule
+    ///    with profiling must not be applied concurrently.
+    void profiling(bool enable);
+
+    /// returns the collected statistics as json object that mirrors the rule.
+    /// \details
+    ///    each node is reported as
+    ///    { "op": name, "evaluations": n, "truthy": t, "falsy": f,
+    ///      "cycles": c, "allocations": a, "operands": [...] }.
+    ///    "counter" names the unit of cycles (tsc or steady_clock).
+    /// \throws std::logic_error when profiling is off
+    boost::json::value profile_report() const;
+
+    /// writes the collected statistics in folded stack format.
+    /// \details
+    ///    each line holds a stack of ';' separated operator names
+    ///    followed by the cycles spent exclusively in the innermost node,
+    ///    as read by flame graph tools.
+    /// \throws std::logic_error when profiling is off
+    void write_folded_profile(std::ostream& os) const;
+
     /// returns the data held internally for internal use.
+    /// \{
     logic_data& internal_data();
+    const logic_data& internal_data() const;
+    /// \}
 
   private:
     logic_rule()                             = delete;
@@ -207,14 +436,355 @@ struct logic_rule {
     std::unique_ptr<logic_data> data;
 };
 
+/// a collection of rules that are evaluated together against the same data
+/// \details
+///    the rules of a rule_set share a single table of non-computed
+///    variable names (i.e., the slots of all rules), and subexpressions
+///    that occur in several rules are computed at most once per
+///    evaluation. Evaluating a rule_set is equivalent to evaluating each
+///    rule separately; the cost of an evaluation, however, depends on
+///    the number of distinct subexpressions rather than on the number
+///    of rules.
+///    If a rule throws, the evaluation of the rule_set is aborted and the
+///    exception is propagated.
+struct rule_set {
+    explicit rule_set(std::unique_ptr<logic_data>&& rules_data);
+    rule_set(rule_set&&);
+    rule_set& operator=(rule_set&&);
+    ~rule_set();
+
+    /// returns the number of rules
+    std::size_t size() const;
+
+    /// returns static variable names (i.e., variable names that are not computed)
+    ///   of all rules.
+    std::vector<std::string_view> const &variable_names() const;
+
+    /// returns if any rule contains computed names.
+    bool has_computed_variable_names() const;
+
+    /// evaluates all rules and uses \p vars to query variables.
+    /// \details
+    ///    a variable that occurs more than once in the rule set is requested
+    ///    at most once per evaluation.
+    /// \return the result of the i-th rule at position i
+    /// \{
+    std::vector<value_variant> apply(variable_resolver vars) ;
+    std::vector<value_variant> apply(evaluation_context& ctx, variable_resolver vars) ;
+    /// \}
+
+    /// evaluates all rules and uses \p vars to obtain values for non-computed variable names.
+    /// \param vars values for the names in variable_names(); vars is accessed in place.
+    /// \return the result of the i-th rule at position i
+    /// \throws std::logic_error when evaluation accesses a computed variable name
+    /// \{
+    std::vector<value_variant> apply(std::span<const value_variant> vars) ;
+    std::vector<value_variant> apply(evaluation_context& ctx, std::span<const value_variant> vars) ;
+    /// \}
+
+    /// evaluates the rules and returns which of them are truthy.
+    /// \details
+    ///    the predicate index first reads the variables of the indexed
+    ///    conditions and selects the rules whose condition may hold;
+    ///    only those and the rules without indexed condition are evaluated.
+    ///    Thus, errors and log output of excluded rules do not occur.
+    /// \return true at position i, iff the i-th rule is truthy
+    /// \{
+    std::vector<bool> truthy_rules(variable_resolver vars) ;
+    std::vector<bool> truthy_rules(evaluation_context& ctx, variable_resolver vars) ;
+    std::vector<bool> truthy_rules(std::span<const value_variant> vars) ;
+    std::vector<bool> truthy_rules(evaluation_context& ctx, std::span<const value_variant> vars) ;
+    /// \}
+
+    /// evaluates the rules like truthy_rules.
+    /// \return the positions of the truthy rules in ascending order
+    /// \{
+    std::vector<std::size_t> matching_rules(variable_resolver vars) ;
+    std::vector<std::size_t> matching_rules(evaluation_context& ctx, variable_resolver vars) ;
+    std::vector<std::size_t> matching_rules(std::span<const value_variant> vars) ;
+    std::vector<std::size_t> matching_rules(evaluation_context& ctx, std::span<const value_variant> vars) ;
+    /// \}
+
+    /// evaluates the rules in order until a rule is truthy.
+    /// \details
+    ///    consecutive rules whose top-level and starts with the same
+    ///    conditions are grouped. The shared conditions are evaluated
+    ///    once, and when one of them is falsy, the entire group is skipped.
+    ///    Results of the rules are not retained.
+    /// \return the position of the first truthy rule, or std::nullopt
+    ///         if no rule is truthy
+    /// \{
+    std::optional<std::size_t> first_match(variable_resolver vars) ;
+    std::optional<std::size_t> first_match(evaluation_context& ctx, variable_resolver vars) ;
+    std::optional<std::size_t> first_match(std::span<const value_variant> vars) ;
+    std::optional<std::size_t> first_match(evaluation_context& ctx, std::span<const value_variant> vars) ;
+    /// \}
+
+    /// returns the number of rules with an indexed condition.
+    /// \details
+    ///    a rule is indexed by an operand of its top-level and (or the
+    ///    rule itself) that compares a variable with a literal:
+    ///    equality (==, ===), membership in a literal array (in), or
+    ///    comparisons with a number (<, <=, >, >=).
+    ///    Requires ENABLE_OPTIMIZATIONS; otherwise, no rule is indexed.
+    std::size_t indexed_rules() const;
+
+    /// turns adaptive ordering of and/or operands on or off.
+    /// \details
+    ///    see logic_rule::adaptive_ordering.
+    void adaptive_ordering(bool enable);
+
+    /// returns the data held internally for internal use.
+    /// \{
+    logic_data& internal_data();
+    const logic_data& internal_data() const;
+    /// \}
+
+  private:
+    rule_set()                           = delete;
+    rule_set(const rule_set&)            = delete;
+    rule_set& operator=(const rule_set&) = delete;
+
+    std::unique_ptr<logic_data> data;
+};
+
+/// memory use of the live rules of a rule_store
+/// \details
+///    sizes are estimates of the heap memory of the nodes of the syntax
+///    trees; the storage of string literals is not included.
+struct rule_store_statistics {
+    /// number of live rules
+    std::size_t rules        = 0;
+
+    /// number of nodes, and their size, if the rules had been created by create_logic
+    /// \{
+    std::size_t nodes        = 0;
+    std::size_t bytes        = 0;
+    /// \}
+
+    /// number of nodes, and their size, held by the rules and the subtrees they share
+    /// \{
+    std::size_t stored_nodes = 0;
+    std::size_t stored_bytes = 0;
+    /// \}
+
+    /// number of live shared subtrees
+    std::size_t subtrees     = 0;
+
+    /// size of the tables the store uses to find equal subtrees and literals
+    std::size_t index_bytes  = 0;
+};
+
+/// creates rules that share structurally equal subtrees
+/// \details
+///    a rule_store interns the subtrees of the rules it creates: a subtree
+///    that is equal to a subtree of a rule created earlier (i.e., same
+///    operators, literals, and variable slots) is not stored again, but
+///    shared. Since variable slots are numbered in order of appearance,
+///    subtrees of rules that are instances of the same template are
+///    shared, while the same variables in a different order are not.
+///    Shared subtrees are immutable and reference counted; they are
+///    released with the last rule that refers to them. Rules may outlive
+///    the store. Equal string literals of all rules share their storage.
+///    Rules created by a rule_store evaluate like rules created by
+///    create_logic, but common subexpressions are not eliminated and
+///    adaptive ordering has no effect.
+///    A rule_store must not be used concurrently.
+struct rule_store {
+    rule_store();
+    rule_store(rule_store&&);
+    rule_store& operator=(rule_store&&);
+    ~rule_store();
+
+    /// interprets the json object \p n as a jsonlogic expression
+    ///   (see jsonlogic::create_logic).
+    logic_rule create_logic(const boost::json::value& n);
+
+    /// returns the memory use of the live rules created by this store
+    rule_store_statistics statistics() const;
+
+  private:
+    rule_store(const rule_store&)            = delete;
+    rule_store& operator=(const rule_store&) = delete;
+
+    std::unique_ptr<rule_store_data> data;
+};
+
 //
 // API to create an expression
 
+/// options of create_logic and create_rule_set
+struct logic_options {
+    /// allocates the nodes of the syntax tree in one block of memory
+    /// \details
+    ///    nodes are laid out in creation order, which places most
+    ///    operators right before their operands, and are released with
+    ///    a single deallocation. The block is sized from the json input;
+    ///    further blocks are added if it is exceeded.
+    bool arena = false;
+};
 
 /// interprets the json object \ref n as a jsonlogic expression and
 ///   returns a jsonlogic representation together with some information
 ///   on variables inside the jsonlogic expression.
+/// \{
 logic_rule create_logic(const boost::json::value& n);
+logic_rule create_logic(const boost::json::value& n, const logic_options& opts);
+/// \}
+
+/// interprets the json text \p text as a jsonlogic expression
+/// \details
+///    the rule is translated while \p text is parsed, without creating
+///    json values. The result is the same as that of
+///    create_logic(boost::json::parse(text)), but rules may be nested
+///    up to 1024 levels deep, and an operator whose key is repeated
+///    (e.g., {"var":"a","var":"b"}) is rejected; boost::json::parse keeps
+///    the last value of a repeated key.
+/// \throws boost::system::system_error when \p text is not valid json,
+///         and the exceptions of create_logic
+/// \{
+logic_rule create_logic_from_text(std::string_view text);
+logic_rule create_logic_from_text(std::string_view text, const logic_options& opts);
+/// \}
+
+/// interprets each element of \p rules as a jsonlogic expression and
+///   returns a rule_set that evaluates all of them.
+/// \details
+///    rule i of the rule_set corresponds to rules[i].
+/// \{
+rule_set create_rule_set(std::span<const boost::json::value> rules);
+rule_set create_rule_set(std::span<const boost::json::value> rules, const logic_options& opts);
+/// \}
+
+//
+// API to store and load compiled rules
+
+/// returns a binary image of the rule \p rule, or of the rules in \p rules
+/// \details
+///    an image holds the optimized syntax tree, including the common
+///    subexpressions and the element sets of membership tests, and the
+///    variable names. It contains no pointers; it can be written to a file
+///    and loaded from any address, e.g., from a memory mapped file.
+///    Images use the byte order of the platform.
+/// \throws std::logic_error when a rule contains nodes that cannot be stored
+/// \throws std::length_error when a rule is too large or too deeply nested
+///         for an image
+/// \{
+std::vector<std::byte> save_image(const logic_rule& rule);
+std::vector<std::byte> save_image(const rule_set& rules);
+/// \}
+
+/// creates a rule from an image created by save_image
+/// \details
+///    loading creates the nodes from the image without json parsing,
+///    translation, and common subexpression elimination. The image is
+///    not referenced after loading. Regular expressions are compiled
+///    when they are evaluated, as for rules created by create_logic.
+///    The structure of an image is checked, but images should come from
+///    trusted sources.
+/// \throws std::runtime_error when the image is malformed, or was written by
+///         an incompatible version or with another byte order
+/// \throws std::logic_error when the image holds a rule_set
+/// \{
+logic_rule load_logic(std::span<const std::byte> image);
+logic_rule load_logic(std::span<const std::byte> image, const logic_options& opts);
+/// \}
+
+/// creates a rule_set from an image created by save_image
+/// \details
+///    see load_logic; the predicate index and the first match groups
+///    are rebuilt.
+/// \throws std::runtime_error when the image is malformed, or was written by
+///         an incompatible version or with another byte order
+/// \throws std::logic_error when the image holds a single rule
+/// \{
+rule_set load_rule_set(std::span<const std::byte> image);
+rule_set load_rule_set(std::span<const std::byte> image, const logic_options& opts);
+/// \}
+
+//
+// rule cache
+
+/// options of a rule_cache
+struct rule_cache_options {
+    /// number of independently locked parts of the cache
+    std::size_t   shards      = 16;
+
+    /// treats rules that differ only in the order of the two operands
+    ///   of ==, !=, ===, !==, +, or * as the same rule.
+    /// \details
+    ///    the results are the same, but when both operands fail to
+    ///    evaluate, the reported error may differ. Operands that
+    ///    contain log are never swapped, so the log output keeps
+    ///    its order.
+    bool          commutative = false;
+
+    /// options of create_logic
+    logic_options logic       = {};
+};
+
+/// numbers of lookups and of cached rules of a rule_cache
+struct rule_cache_statistics {
+    /// lookups that found the rule, including those that waited for
+    ///   a concurrent lookup to compile it (waits).
+    std::size_t hits      = 0;
+    std::size_t misses    = 0;
+    std::size_t waits     = 0;
+
+    /// rules removed to stay within the capacity
+    std::size_t evictions = 0;
+
+    /// number of cached rules
+    std::size_t rules     = 0;
+};
+
+/// a bounded cache of compiled rules that can be used concurrently
+/// \details
+///    rules are identified by their content: the order of object keys
+///    and whitespace in rule texts are insignificant (see also
+///    rule_cache_options::commutative). The cache is split into shards
+///    with their own lock and least recently used order, so that
+///    lookups of different rules rarely contend. When several threads
+///    request a rule that is not cached, the rule is compiled once and
+///    the other threads wait for the result.
+///    The cached rules are shared; they can be applied concurrently
+///    (with different evaluation contexts), but adaptive ordering and
+///    profiling must remain off. An evicted rule remains valid as
+///    long as it is referenced.
+struct rule_cache {
+    /// creates a cache for at most about \p capacity rules
+    /// \{
+    explicit rule_cache(std::size_t capacity);
+    rule_cache(std::size_t capacity, const rule_cache_options& opts);
+    /// \}
+
+    rule_cache(rule_cache&&);
+    rule_cache& operator=(rule_cache&&);
+    ~rule_cache();
+
+    /// returns the compiled rule for the json object \p n, or for the
+    ///   json text \p text.
+    /// \details
+    ///    the rule is created by jsonlogic::create_logic, unless it is cached.
+    /// \throws the exceptions of create_logic and of json parsing;
+    ///    failures are not cached.
+    /// \{
+    std::shared_ptr<logic_rule> create_logic(const boost::json::value& n);
+    std::shared_ptr<logic_rule> create_logic(std::string_view text);
+    /// \}
+
+    /// returns the lookup statistics and the number of cached rules
+    rule_cache_statistics statistics() const;
+
+    /// removes all rules from the cache
+    void clear();
+
+  private:
+    rule_cache(const rule_cache&)            = delete;
+    rule_cache& operator=(const rule_cache&) = delete;
+
+    std::unique_ptr<rule_cache_data> data;
+};
 
 } // namespace jsonlogic
 
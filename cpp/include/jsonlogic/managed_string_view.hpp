@@ -55,6 +55,9 @@ namespace jsonlogic
       }
 
       std::string_view view() const { return *this; }
+
+      /// returns the number of managed_string_views that share the storage
+      long use_count() const { return holder::use_count(); }
   };
 
   // \todo replace with space ship operator
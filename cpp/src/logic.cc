@@ -4,22 +4,40 @@
 
 // standard headers
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cstdint>
+#include <cstring>
+#include <deque>
 #include <exception>
+#include <future>
 #include <iostream>
 #include <limits>
+#include <list>
+#include <mutex>
 #include <numeric>
+#include <optional>
 #include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
 #include <charconv>
+#include <chrono>
 #include <span>
 #include <ranges>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 #if WITH_JSON_LOGIC_CPP_EXTENSIONS
 #include <regex>
 #endif /* WITH_JSON_LOGIC_CPP_EXTENSIONS */
 
 // 3rd party headers
 #include <boost/json.hpp>
+#include <boost/json/basic_parser_impl.hpp>
 
 // jsonlogic complete headers
 #include "jsonlogic/details/ast-full.hpp"
@@ -92,9 +110,9 @@ const T &up_cast(const T &n) {
 
 template <class T>
 struct down_caster_internal {
-  T *operator()(const expr &) const { return nullptr; }
+  const T *operator()(const expr &) const { return nullptr; }
 
-  T *operator()(const T &o) const { return &o; }
+  const T *operator()(const T &o) const { return &o; }
 };
 
 template <class T>
@@ -104,12 +122,12 @@ const T *may_down_cast(const expr &e) {
 
 template <class T>
 T *may_down_cast(expr &e) {
-  return dynamic_cast<T *>(&e);  // \todo replace dynamic_cast
+  return const_cast<T *>(may_down_cast<T>(std::as_const(e)));
 }
 
 template <class T>
 const T &down_cast(const expr &e) {
-  if (T *casted = may_down_cast<T>(e)) {
+  if (const T *casted = may_down_cast<T>(e)) {
     CXX_LIKELY;
     return *casted;
   }
@@ -464,6 +482,15 @@ namespace
   
   array_value& mk_array_value(std::vector<any_value> elems = {});
 
+  /// number of heap allocations by jsonlogic on behalf of this thread
+  /// \details
+  ///   counts allocations of values (arrays and strings), compiled
+  ///   regular expressions, and variable accessors.
+  ///   See allocation_count.
+  thread_local std::uint64_t value_allocations = 0;
+
+  void count_allocations(std::uint64_t n = 1) { value_allocations += n; }
+
   void delete_array(value_variant_base& val)
   {
     if (val.index() == sequ_variant)
@@ -566,6 +593,7 @@ array_value::value() const
 const array_value*
 array_value::copy() const
 {
+  count_allocations();
   return new array_value(*this);
 }
 
@@ -641,15 +669,101 @@ void array_value::accept(visitor &v) const { v.visit(*this); }
 
 void error::accept(visitor &v) const { v.visit(*this); }
 
+void interned_expr::accept(visitor &v) const { v.visit(*this); }
+
 #if WITH_JSON_LOGIC_CPP_EXTENSIONS
 void regex_match::accept(visitor &v) const { v.visit(*this); }
 #endif /* WITH_JSON_LOGIC_CPP_EXTENSIONS */
 
 #if ENABLE_OPTIMIZATIONS
 void opt_membership_array::accept(visitor &v) const { v.visit(*this); }
+void common_subexpr::accept(visitor &v) const { v.visit(*this); }
 #endif /*ENABLE_OPTIMIZATIONS*/
 
 
+//
+// node arena
+
+namespace {
+  thread_local node_arena* active_arena = nullptr;
+}
+
+node_arena::node_arena(std::size_t capacity)
+{
+  chunks.push_back(block{std::make_unique_for_overwrite<std::byte[]>(capacity), capacity});
+}
+
+node_arena::~node_arena() = default;
+
+node_arena::scope::scope(node_arena& arena)
+: prev(active_arena)
+{
+  active_arena = &arena;
+}
+
+node_arena::scope::~scope() { active_arena = prev; }
+
+bool node_arena::contains(const void* p) const {
+  const std::byte* ptr = static_cast<const std::byte*>(p);
+
+  return std::any_of( chunks.begin(), chunks.end(),
+                      [ptr](const block& b) -> bool {
+                        // compares addresses of unrelated objects
+                        return std::less_equal<const std::byte*>{}(b.mem.get(), ptr)
+                               && std::less<const std::byte*>{}(ptr, b.mem.get() + b.size);
+                      }
+                    );
+}
+
+void* node_arena::bump(std::size_t sz, std::size_t align) {
+  std::size_t ofs = (top + align - 1) & ~(align - 1);
+
+  if (ofs + sz > chunks.back().size) {
+    // a new block, at least as large as the previous one
+    const std::size_t cap = std::max(sz + align, chunks.back().size);
+
+    chunks.push_back(block{std::make_unique_for_overwrite<std::byte[]>(cap), cap});
+    ofs = 0;
+  }
+
+  top   = ofs + sz;
+  used += sz;
+  return chunks.back().mem.get() + ofs;
+}
+
+void* node_arena::allocate(std::size_t sz, std::size_t align) {
+  if (active_arena)
+    return active_arena->bump(sz, align);
+
+  return ::operator new(sz);
+}
+
+void node_arena::deallocate(void* p, std::size_t sz) noexcept {
+  if (active_arena && active_arena->contains(p))
+    return;
+
+  ::operator delete(p, sz);
+}
+
+void* expr::operator new(std::size_t sz) {
+  return node_arena::allocate(sz, alignof(std::max_align_t));
+}
+
+void expr::operator delete(void* p, std::size_t sz) noexcept {
+  node_arena::deallocate(p, sz);
+}
+
+logic_data::~logic_data() {
+  if (!arena) return;
+
+  // the nodes are destroyed before the arena releases their memory
+  node_arena::scope active(*arena);
+
+  std::get<0>(*this).reset();
+  std::get<4>(*this).clear();
+}
+
+
 // to_variant conversion
 template <class T>
 value_variant value_generic<T>::to_variant() const {
@@ -722,6 +836,8 @@ struct forwarding_visitor : visitor {
 
   void visit(const error &n) override { visit(up_cast<expr>(n)); }
 
+  void visit(const interned_expr &n) override { visit(up_cast<expr>(n)); }
+
 #if WITH_JSON_LOGIC_CPP_EXTENSIONS
   // extensions
   void visit(const regex_match &n) override { visit(up_cast<oper>(n)); }
@@ -730,29 +846,111 @@ struct forwarding_visitor : visitor {
 #if ENABLE_OPTIMIZATIONS
   // optimizations
   void visit(const opt_membership_array &n) override { visit(up_cast<oper>(n)); }
+  void visit(const common_subexpr &n) override { visit(up_cast<expr>(n)); }
 #endif /* ENABLE_OPTIMIZATIONS */
 };
 
 namespace {
 
 struct variable_map {
+  /// lambda scopes
+  enum scope_kind { sequence_scope, reduction_scope };
+
+  /// storage of string literals by their content
+  using literal_pool = std::unordered_map<std::string_view, managed_string_view>;
+
   void insert(var &el);
   std::vector<std::string_view> to_vector() const;
 
+  /// returns the number of occurrences of each static variable
+  std::vector<std::uint32_t> const &use_counts() const { return uses; }
+
   /// accessors for withComputedNames
   /// \{
   bool hasComputedVariables() const { return withComputedNames; }
   void set_computed_variables(bool b) { withComputedNames = b; }
   /// \}
 
+  /// opens and closes lambda scopes
+  /// \{
+  void open_scope(scope_kind k) { scopes.push_back(k); }
+  void close_scope() { scopes.pop_back(); }
+  /// \}
+
+  /// returns a string for the literal \p s
+  /// \details
+  ///    equal literals of a rule share their storage.
+  managed_string_view string_literal(std::string_view s);
+
+  /// takes string literals from \p pool, so that equal literals
+  ///   of several rules share their storage.
+  void share_literals(literal_pool& pool) { shared_literals = &pool; }
+
  private:
   using container_type = std::map<std::string_view, int>;
 
+  /// binds \p name to a slot in the innermost lambda scope that defines it.
+  /// \return true, iff the name could be bound
+  bool bind_lambda_variable(var &el, std::string_view name) const;
+
   container_type mapping = {};
+  std::vector<std::uint32_t> uses = {};
+  std::vector<scope_kind> scopes = {};
+  literal_pool literals = {};
+  literal_pool* shared_literals = nullptr;
   bool withComputedNames = false;
 };
 
+managed_string_view variable_map::string_literal(std::string_view s) {
+  literal_pool& pool = shared_literals ? *shared_literals : literals;
+  auto          pos  = pool.find(s);
+
+  if (pos == pool.end()) {
+    managed_string_view str(s);
+
+    // the key refers to the shared storage, which outlives the map
+    pos = pool.emplace(str.view(), str).first;
+  }
+
+  return pos->second;
+}
+
+bool variable_map::bind_lambda_variable(var &el, std::string_view name) const {
+  if (scopes.empty())
+    return false;
+
+  // "" refers to the element of the innermost lambda
+  if (name == "") {
+    el.scope(scopes.size() - 1);
+    el.num(var::element_slot);
+    return true;
+  }
+
+  const bool current = (name == "current");
+
+  if (!current && (name != "accumulator"))
+    return false;
+
+  for (int lvl = scopes.size() - 1; lvl >= 0; --lvl) {
+    if (scopes[lvl] == reduction_scope) {
+      el.scope(lvl);
+      el.num(current ? var::element_slot : var::accumulator_slot);
+      return true;
+    }
+  }
+
+  return false;
+}
+
 void variable_map::insert(var &var) {
+  const string_value* name = var.size() ? may_down_cast<string_value>(var.operand(0))
+                                        : nullptr;
+
+  if (name) {
+    if (bind_lambda_variable(var, name->value()))
+      return;
+  }
+
   try {
     any_expr &arg = var.back();
     string_value &str = down_cast<string_value>(*arg);
@@ -764,6 +962,9 @@ void variable_map::insert(var &var) {
     } else if (str.value() != "") {
       auto [pos, success] = mapping.emplace(str.value(), mapping.size());
 
+      if (success) uses.push_back(0);
+
+      ++uses.at(pos->second);
       var.num(pos->second);
     }
     else
@@ -786,6 +987,9 @@ std::vector<std::string_view> variable_map::to_vector() const {
   return res;
 }
 
+/// translates a json value into a jsonlogic expression
+any_expr translate_internal(const json::value& n, variable_map &varmap);
+
 /// translates all children
 /// \{
 oper::container_type translate_children(const json::array &children, variable_map &);
@@ -797,6 +1001,8 @@ array& mk_array()     { return deref(new array); }
 
 array_value& mk_array_value(std::vector<any_value> elems)
 {
+  // the value, its shared container, and the container's storage
+  count_allocations(2 + (elems.capacity() != 0));
   return deref(new array_value{std::move(elems)});
 }
 
@@ -816,7 +1022,13 @@ ExprT &mk_operator_(oper::container_type args) {
 template <class ExprT>
 ExprT &mk_operator_(const json::object &n, variable_map &m) {
   assert(n.size() == 1);
-  return mk_operator_<ExprT>(translate_children(n.begin()->value(), m));
+
+  // the operator is created before its operands, so that it precedes
+  //   them in a node_arena.
+  std::unique_ptr<ExprT> res(new ExprT);
+
+  res->set_operands(translate_children(n.begin()->value(), m));
+  return *res.release();
 }
 
 template <class ExprT>
@@ -827,10 +1039,8 @@ expr &mk_operator(const json::object &n, variable_map &m) {
 /// creates and optimized membership tests for static arrays
 ///   and returns a "normal" membership test if the optimization
 ///   is not possible or disabled.
-expr &mk_membership_opt(const json::object &n, variable_map &m)
+expr &mk_membership(oper::container_type args)
 {
-  oper::container_type args = translate_children(n.begin()->value(), m);
-  
 #if ENABLE_OPTIMIZATIONS      
   if (std::unordered_set<value_variant> elems = try_static_set(args.back()); elems.size() != 0)
   {
@@ -845,6 +1055,12 @@ expr &mk_membership_opt(const json::object &n, variable_map &m)
   return mk_operator_<membership>(std::move(args));
 }
 
+/// translates the operands of \p n and creates a membership test
+expr &mk_membership_opt(const json::object &n, variable_map &m)
+{
+  return mk_membership(translate_children(n.begin()->value(), m));
+}
+
 template <class ExprT>
 expr &mk_missing(const json::object &n, variable_map &m) {
   // \todo * extract variables from array and only set_computed_variables when
@@ -854,6 +1070,39 @@ expr &mk_missing(const json::object &n, variable_map &m) {
   return mk_operator_<ExprT>(n, m);
 }
 
+/// creates operators that evaluate a lambda expression (the second operand)
+///   for each array element. The lambda is translated in a new scope.
+template <class ExprT, variable_map::scope_kind scope>
+expr &mk_lambda(const json::object &n, variable_map &m) {
+  assert(n.size() == 1);
+
+  const json::value& args = n.begin()->value();
+  const json::array* arr  = args.if_array();
+
+  if (arr == nullptr) {
+    CXX_UNLIKELY;
+    return mk_operator_<ExprT>(n, m);
+  }
+
+  std::unique_ptr<ExprT> res(new ExprT);
+  oper::container_type   children;
+
+  children.reserve(arr->size());
+
+  for (std::size_t i = 0; i < arr->size(); ++i) {
+    const bool lambda = (i == 1);
+
+    if (lambda) m.open_scope(scope);
+
+    children.emplace_back(translate_internal((*arr)[i], m));
+
+    if (lambda) m.close_scope();
+  }
+
+  res->set_operands(std::move(children));
+  return *res.release();
+}
+
 expr &mk_variable(const json::object &n, variable_map &m) {
   var &v = mk_operator_<var>(n, m);
 
@@ -875,70 +1124,152 @@ value_t &mk_value(typename value_t::value_type n) {
 
 null_value &mk_null_value() { return deref(new null_value); }
 
-using dispatch_table =
-    std::map<std::string_view, expr &(*)(const json::object &, variable_map &)>;
+/// creates the node of an operator
+using operator_factory = expr &(*)(const json::object &, variable_map &);
 
-dispatch_table::const_iterator lookup(const dispatch_table &m,
-                                      const json::object &op) {
-  if (op.size() != 1) return m.end();
+/// creates the node of an operator before its operands are known
+using node_factory = oper *(*)();
 
-  const json::string& key = op.begin()->key();
-  std::string_view    keyvw(&*key.begin(), key.size());
+template <class ExprT>
+oper *mk_node() { return new ExprT; }
+
+/// tells the translation of json text how to complete an operator
+enum class operator_kind {
+  plain,
+  sequence_lambda,  ///< operand 1 is translated in a sequence_scope
+  reduction_lambda, ///< operand 1 is translated in a reduction_scope
+  variable,
+  membership,       ///< created after its operands (see mk_membership)
+  missing
+};
 
-  return m.find(keyvw);
-}
+struct operator_entry {
+  std::string_view name;
+  operator_factory factory;
+  node_factory     node = nullptr;
+  operator_kind    kind = operator_kind::plain;
+};
 
-any_expr translate_internal(const json::value& n, variable_map &varmap) {
-  static const dispatch_table dt = {
-      {"==", &mk_operator<equal>},
-      {"===", &mk_operator<strict_equal>},
-      {"!=", &mk_operator<not_equal>},
-      {"!==", &mk_operator<strict_not_equal>},
-      {"if", &mk_operator<if_expr>},
-      {"!", &mk_operator<logical_not>},
-      {"!!", &mk_operator<logical_not_not>},
-      {"or", &mk_operator<logical_or>},
-      {"and", &mk_operator<logical_and>},
-      {">", &mk_operator<greater>},
-      {">=", &mk_operator<greater_or_equal>},
-      {"<", &mk_operator<less>},
-      {"<=", &mk_operator<less_or_equal>},
-      {"max", &mk_operator<max>},
-      {"min", &mk_operator<min>},
-      {"+", &mk_operator<add>},
-      {"-", &mk_operator<subtract>},
-      {"*", &mk_operator<multiply>},
-      {"/", &mk_operator<divide>},
-      {"%", &mk_operator<modulo>},
-      {"map", &mk_operator<map>},
-      {"reduce", &mk_operator<reduce>},
-      {"filter", &mk_operator<filter>},
-      {"all", &mk_operator<all>},
-      {"none", &mk_operator<none>},
-      {"some", &mk_operator<some>},
-      {"merge", &mk_operator<merge>},
-      {"in", &mk_membership_opt},      
-      {"cat", &mk_operator<cat>},
-      {"log", &mk_operator<log>},
-      {"var", &mk_variable},
-      {"missing", &mk_missing<missing>},
-      {"missing_some", &mk_missing<missing_some>},
+constexpr operator_entry operator_entries[] = {
+    {"==", &mk_operator<equal>, &mk_node<equal>},
+    {"===", &mk_operator<strict_equal>, &mk_node<strict_equal>},
+    {"!=", &mk_operator<not_equal>, &mk_node<not_equal>},
+    {"!==", &mk_operator<strict_not_equal>, &mk_node<strict_not_equal>},
+    {"if", &mk_operator<if_expr>, &mk_node<if_expr>},
+    {"!", &mk_operator<logical_not>, &mk_node<logical_not>},
+    {"!!", &mk_operator<logical_not_not>, &mk_node<logical_not_not>},
+    {"or", &mk_operator<logical_or>, &mk_node<logical_or>},
+    {"and", &mk_operator<logical_and>, &mk_node<logical_and>},
+    {">", &mk_operator<greater>, &mk_node<greater>},
+    {">=", &mk_operator<greater_or_equal>, &mk_node<greater_or_equal>},
+    {"<", &mk_operator<less>, &mk_node<less>},
+    {"<=", &mk_operator<less_or_equal>, &mk_node<less_or_equal>},
+    {"max", &mk_operator<max>, &mk_node<max>},
+    {"min", &mk_operator<min>, &mk_node<min>},
+    {"+", &mk_operator<add>, &mk_node<add>},
+    {"-", &mk_operator<subtract>, &mk_node<subtract>},
+    {"*", &mk_operator<multiply>, &mk_node<multiply>},
+    {"/", &mk_operator<divide>, &mk_node<divide>},
+    {"%", &mk_operator<modulo>, &mk_node<modulo>},
+    {"map", &mk_lambda<map, variable_map::sequence_scope>, &mk_node<map>,
+     operator_kind::sequence_lambda},
+    {"reduce", &mk_lambda<reduce, variable_map::reduction_scope>, &mk_node<reduce>,
+     operator_kind::reduction_lambda},
+    {"filter", &mk_lambda<filter, variable_map::sequence_scope>, &mk_node<filter>,
+     operator_kind::sequence_lambda},
+    {"all", &mk_lambda<all, variable_map::sequence_scope>, &mk_node<all>,
+     operator_kind::sequence_lambda},
+    {"none", &mk_lambda<none, variable_map::sequence_scope>, &mk_node<none>,
+     operator_kind::sequence_lambda},
+    {"some", &mk_lambda<some, variable_map::sequence_scope>, &mk_node<some>,
+     operator_kind::sequence_lambda},
+    {"merge", &mk_operator<merge>, &mk_node<merge>},
+    {"in", &mk_membership_opt, nullptr, operator_kind::membership},
+    {"cat", &mk_operator<cat>, &mk_node<cat>},
+    {"log", &mk_operator<log>, &mk_node<log>},
+    {"var", &mk_variable, &mk_node<var>, operator_kind::variable},
+    {"missing", &mk_missing<missing>, &mk_node<missing>,
+     operator_kind::missing},
+    {"missing_some", &mk_missing<missing_some>, &mk_node<missing_some>,
+     operator_kind::missing},
 #if WITH_JSON_LOGIC_CPP_EXTENSIONS
-      /// extensions
-      {"regex", &mk_operator<regex_match>},
+    /// extensions
+    {"regex", &mk_operator<regex_match>, &mk_node<regex_match>},
 #endif /* WITH_JSON_LOGIC_CPP_EXTENSIONS */
-  };
+};
+
+constexpr std::size_t operator_table_size = 128;
+
+/// hash function for operator names
+/// \details
+///    the coefficients are chosen such that the hash is perfect for
+///    the operators in operator_entries (checked at compile time).
+constexpr std::size_t operator_hash(std::string_view name) {
+  if (name.empty()) return 0;
+
+  const std::size_t first  = static_cast<unsigned char>(name.front());
+  const std::size_t second = name.size() > 1 ? static_cast<unsigned char>(name[1]) : 0;
+  const std::size_t last   = static_cast<unsigned char>(name.back());
+
+  return (name.size() + 2 * first + 2 * second + 10 * last) % operator_table_size;
+}
+
+using operator_table = std::array<operator_entry, operator_table_size>;
+
+constexpr operator_table make_operator_table() {
+  operator_table res = {};
+
+  for (const operator_entry &entry : operator_entries)
+    res[operator_hash(entry.name)] = entry;
+
+  return res;
+}
+
+constexpr bool operator_hash_is_perfect() {
+  operator_table res = make_operator_table();
+  std::size_t    num = 0;
+
+  for (const operator_entry &entry : res)
+    num += !entry.name.empty();
+
+  return num == std::size(operator_entries);
+}
+
+static_assert( operator_hash_is_perfect(),
+               "operator names collide; adjust the coefficients of operator_hash"
+             );
 
+constexpr operator_table operators = make_operator_table();
+
+/// returns the operator named \p name, or nullptr if there is none.
+const operator_entry *lookup(std::string_view name) {
+  const operator_entry& entry = operators[operator_hash(name)];
+
+  return entry.name == name && entry.factory != nullptr ? &entry : nullptr;
+}
+
+/// returns the factory of the operator \p op, or nullptr if \p op
+///   is not an operator.
+operator_factory lookup(const json::object &op) {
+  if (op.size() != 1) return nullptr;
+
+  const json::string&   key   = op.begin()->key();
+  const operator_entry* entry = lookup(std::string_view(key.data(), key.size()));
+
+  return entry ? entry->factory : nullptr;
+}
+
+any_expr translate_internal(const json::value& n, variable_map &varmap) {
   expr *res = nullptr;
 
   switch (n.kind()) {
     case json::kind::object: {
       const json::object &obj = n.get_object();
-      dispatch_table::const_iterator pos = lookup(dt, obj);
+      operator_factory factory = lookup(obj);
 
-      if (pos != dt.end()) {
+      if (factory != nullptr) {
         CXX_LIKELY;
-        res = &pos->second(obj, varmap);
+        res = &factory(obj, varmap);
       } else {
         // does jsonlogic support value objects?
         unsupported();
@@ -955,7 +1286,7 @@ any_expr translate_internal(const json::value& n, variable_map &varmap) {
 
     case json::kind::string: {
       const json::string& str = n.get_string();
-      res = &mk_value<string_value>(managed_string_view(str.begin(), str.size()));
+      res = &mk_value<string_value>(varmap.string_literal(std::string_view(str.data(), str.size())));
       break;
     }
 
@@ -1014,131 +1345,2784 @@ oper::container_type translate_children(const json::value &n, variable_map &varm
   res.emplace_back(translate_internal(n, varmap));
   return res;
 }
-} // namespace
 
+/// translates the json text of a rule while it is parsed
+/// \details
+///    the handler of a json::basic_parser. Operators and arrays are created
+///    as soon as the parser reports their name or start, so that they
+///    precede their operands in a node_arena, as with translate_internal.
+///    The operators and arrays whose operands are being translated are
+///    kept on an explicit stack instead of the native stack.
+struct rule_text_translator {
+    constexpr static std::size_t max_object_size = std::numeric_limits<std::size_t>::max();
+    constexpr static std::size_t max_array_size  = std::numeric_limits<std::size_t>::max();
+    constexpr static std::size_t max_key_size    = std::numeric_limits<std::size_t>::max();
+    constexpr static std::size_t max_string_size = std::numeric_limits<std::size_t>::max();
+
+    explicit rule_text_translator(variable_map& m) : varmap(m) {}
+
+    bool on_document_begin(json::error_code&) { return true; }
+    bool on_document_end(json::error_code&)   { return true; }
+
+    bool on_object_begin(json::error_code&);
+    bool on_object_end(std::size_t, json::error_code&);
+    bool on_array_begin(json::error_code&);
+    bool on_array_end(std::size_t, json::error_code&);
+
+    bool on_key_part(json::string_view s, std::size_t, json::error_code&)    { return append(s); }
+    bool on_key(json::string_view s, std::size_t, json::error_code&);
+    bool on_string_part(json::string_view s, std::size_t, json::error_code&) { return append(s); }
+    bool on_string(json::string_view s, std::size_t, json::error_code&);
+
+    bool on_number_part(json::string_view, json::error_code&)              { return true; }
+    bool on_int64(std::int64_t n, json::string_view, json::error_code&)    { return add(mk_value<int_value>(n)); }
+    bool on_uint64(std::uint64_t n, json::string_view, json::error_code&)  { return add(mk_value<unsigned_int_value>(n)); }
+    bool on_double(double n, json::string_view, json::error_code&)         { return add(mk_value<real_value>(n)); }
+    bool on_bool(bool n, json::error_code&)                                { return add(mk_value<bool_value>(n)); }
+    bool on_null(json::error_code&)                                        { return add(mk_null_value()); }
+
+    bool on_comment_part(json::string_view, json::error_code&)             { return true; }
+    bool on_comment(json::string_view, json::error_code&)                  { return true; }
+
+    /// returns the translated rule
+    any_expr result() { return std::move(root); }
+
+  private:
+    enum frame_state { array_elements, operator_name, operator_value, operator_operands, operator_complete };
+
+    /// an array or an operator whose operands are being translated
+    struct frame {
+      frame_state            state;
+      std::unique_ptr<oper>  node     = nullptr; ///< null until the name is read, and for in
+      const operator_entry*  op       = nullptr;
+      oper::container_type   operands = {};
+      bool                   scope    = false;   ///< a lambda scope is open
+    };
+
+    bool append(json::string_view s) { text.append(s.data(), s.size()); return true; }
+
+    /// adds a translated value to the innermost array or operator
+    bool add(expr& e);
+
+    /// returns the operator of \p f with its operands
+    expr& complete(frame& f);
+
+    variable_map&      varmap;
+    std::vector<frame> frames = {};
+    std::string        text   = {};      ///< the parts of a key or string
+    any_expr           root   = nullptr;
+};
 
-logic_rule create_logic(const json::value& n) {
-  variable_map varmap;
-  any_expr node = translate_internal(n, varmap);
-  bool const hasComputedVariables = varmap.hasComputedVariables();
-
-  return logic_rule(std::make_unique<logic_data>(std::move(node), varmap.to_vector(), hasComputedVariables));
+bool rule_text_translator::on_object_begin(json::error_code&) {
+  frames.push_back(frame{operator_name});
+  return true;
 }
 
+bool rule_text_translator::on_key(json::string_view s, std::size_t, json::error_code&) {
+  frame& top = frames.back();
 
+  // objects that are not operators are not supported, as in translate_internal.
+  //   A repeated key is rejected too: json::parse would keep the last value,
+  //   but the first one has already been translated.
+  if (top.state != operator_name)
+    unsupported();
 
-//
-// to value_base conversion
+  append(s);
+  top.op = lookup(std::string_view(text));
+  text.clear();
 
-any_value to_value(std::nullptr_t) { return nullptr; }
-any_value to_value(bool val) { return val; }
-any_value to_value(std::int64_t val) { return val; }
-any_value to_value(std::uint64_t val) { return val; }
-any_value to_value(double val) { return val; }
-any_value to_value(managed_string_view val) { return val; }
+  if (top.op == nullptr)
+    unsupported();
 
-any_value to_value(const json::value &n); // \todo remove after moving to logic.hpp
+  if (top.op->node) top.node.reset(top.op->node());
 
+  if (top.op->kind == operator_kind::missing)
+    varmap.set_computed_variables(true);
 
-any_value to_value(const json::value &n) {
-  any_value res;
+  top.state = operator_value;
+  return true;
+}
 
-  switch (n.kind()) {
-    case json::kind::string: {
-      const json::string& str = n.get_string(); // \todo this may be unsafe..
-      res = to_value(managed_string_view(&*str.begin(), str.size()));
-      break;
-    }
+bool rule_text_translator::on_object_end(std::size_t, json::error_code&) {
+  if (frames.back().state != operator_complete)
+    unsupported();
 
-    case json::kind::int64: {
-      res = to_value(n.get_int64());
-      break;
-    }
+  expr& res = complete(frames.back());
 
-    case json::kind::uint64: {
-      res = to_value(n.get_uint64());
-      break;
-    }
+  frames.pop_back();
+  return add(res);
+}
 
-    case json::kind::double_: {
-      res = to_value(n.get_double());
-      break;
-    }
+bool rule_text_translator::on_array_begin(json::error_code&) {
+  if (!frames.empty() && frames.back().state == operator_value) {
+    // the array holds the operands of an operator
+    frames.back().state = operator_operands;
+    return true;
+  }
 
-    case json::kind::bool_: {
-      res = to_value(n.get_bool());
-      break;
-    }
+  frames.push_back(frame{array_elements, std::unique_ptr<oper>(&mk_array())});
+  return true;
+}
 
-    case json::kind::null: {
-      res = to_value(nullptr);
-      break;
-    }
+bool rule_text_translator::on_array_end(std::size_t, json::error_code&) {
+  frame& top = frames.back();
 
-    case json::kind::array: {
-      std::vector<value_variant> values;
-      const json::array&         arr = n.get_array();
+  if (top.state == operator_operands) {
+    if (top.scope) varmap.close_scope();
 
-      for (const json::value& val : arr)
-        values.emplace_back(to_value(val));
+    top.scope = false;
+    top.state = operator_complete;
+    return true;
+  }
 
-      res = &mk_array_value(std::move(values));
-      break;
-    }
+  assert(top.state == array_elements);
+  top.node->set_operands(std::move(top.operands));
 
-    default:
-      unsupported();
-  }
+  expr& res = *top.node.release();
 
-  return res;
+  frames.pop_back();
+  return add(res);
 }
 
+bool rule_text_translator::on_string(json::string_view s, std::size_t, json::error_code&) {
+  append(s);
 
-any_value to_value(const any_expr& n)
-{
-  return down_cast<value_base>(*n).to_variant();
+  expr& res = mk_value<string_value>(varmap.string_literal(text));
+
+  text.clear();
+  return add(res);
 }
 
-namespace {
+bool rule_text_translator::add(expr& e) {
+  any_expr val(&e);
 
-//
-// coercion functions
+  if (frames.empty()) {
+    root = std::move(val);
+    return true;
+  }
 
-struct internal_coercion_error {};
-struct not_int64_error : internal_coercion_error {};
-struct not_uint64_error : internal_coercion_error {};
-struct unpacked_array_req : internal_coercion_error {};
+  frame& top = frames.back();
 
+  top.operands.emplace_back(std::move(val));
 
-template <class T>
-T from_string(std::string_view str, T el) {
-  auto [ptr, err] = std::from_chars(str.data(), str.data() + str.size(), el);
+  if (top.state == operator_value) {
+    top.state = operator_complete;
+    return true;
+  }
 
-  if (err != std::errc{}) {
-    CXX_UNLIKELY;
-    throw std::runtime_error{"logic.cc: in to_concrete(string_view, int64_t)"};
+  if (top.state != operator_operands)
+    return true;
+
+  // the second operand of a lambda operator is translated in a new scope
+  const operator_kind kind = top.op->kind;
+
+  if (kind != operator_kind::sequence_lambda && kind != operator_kind::reduction_lambda)
+    return true;
+
+  if (top.operands.size() == 1) {
+    varmap.open_scope( kind == operator_kind::sequence_lambda ? variable_map::sequence_scope
+                                                              : variable_map::reduction_scope
+                     );
+    top.scope = true;
+  } else if (top.scope) {
+    varmap.close_scope();
+    top.scope = false;
   }
 
-  return el;
+  return true;
 }
 
-/// conversion to int64
-/// \{
-CXX_MAYBE_UNUSED inline std::int64_t to_concrete(std::int64_t v,
-                                                 const std::int64_t &) {
-  return v;
-}
-inline std::int64_t to_concrete(const managed_string_view& str, const std::int64_t &el) {
-  return from_string(str, el);
+expr& rule_text_translator::complete(frame& f) {
+  if (f.op->kind == operator_kind::membership)
+    return mk_membership(std::move(f.operands));
+
+  f.node->set_operands(std::move(f.operands));
+
+  if (f.op->kind == operator_kind::variable)
+    varmap.insert(down_cast<var>(*f.node));
+
+  return *f.node.release();
 }
-inline std::int64_t to_concrete(double v, const std::int64_t &) {
-  return static_cast<std::int64_t>(v);
+
+/// the nesting limit of rules translated from json text
+/// \details
+///    the translation does not recurse, but later passes (e.g., common
+///    subexpression elimination, evaluation) do.
+constexpr std::size_t max_rule_text_depth = 1024;
+
+/// translates the json text \p text into a jsonlogic expression
+any_expr translate_text(std::string_view text, variable_map &varmap) {
+  json::parse_options opts;
+
+  opts.max_depth = max_rule_text_depth;
+
+  json::basic_parser<rule_text_translator> parser(opts, varmap);
+  json::error_code                         ec;
+  const std::size_t                        len = parser.write_some(false, text.data(), text.size(), ec);
+
+  if (!ec && len != text.size())
+    ec = json::error::extra_data;
+
+  if (ec)
+    throw json::system_error(ec);
+
+  return parser.handler().result();
 }
-inline std::int64_t to_concrete(bool v, const std::int64_t &) {
-  return static_cast<std::int64_t>(v);
+
+std::size_t combine(std::size_t seed, std::size_t val) {
+  return seed ^ (val + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
 }
-inline std::int64_t to_concrete(std::nullptr_t, const std::int64_t &) {
-  return 0;
+
+/// tests whether \p lhs and \p rhs are the same literal
+/// \details
+///    doubles are compared by their representation, since equal values
+///    can behave differently (e.g., 1/0.0 is inf, 1/-0.0 is -inf).
+bool same_literal(const value_variant &lhs, const value_variant &rhs) {
+  if (lhs.index() != rhs.index())
+    return false;
+
+  if (lhs.index() == real_variant)
+    return std::bit_cast<std::uint64_t>(std::get<double>(lhs)) == std::bit_cast<std::uint64_t>(std::get<double>(rhs));
+
+  return lhs == rhs;
+}
+
+/// returns a hash of \p val that is consistent with same_literal
+std::size_t literal_hash(const value_variant &val) {
+  if (val.index() == real_variant)
+    return std::hash<std::uint64_t>{}(std::bit_cast<std::uint64_t>(std::get<double>(val)));
+
+  return std::hash<value_variant>{}(val);
+}
+
+/// compares the node-local attributes of \p lhs and \p rhs.
+/// \pre lhs and rhs have the same dynamic type
+bool same_attributes(const expr &lhs, const expr &rhs) {
+  if (const value_base* lval = may_down_cast<value_base>(lhs))
+    return same_literal(lval->to_variant(), down_cast<value_base>(rhs).to_variant());
+
+  if (const var* lvar = may_down_cast<var>(lhs)) {
+    const var& rvar = down_cast<var>(rhs);
+
+    return (lvar->num() == rvar.num()) && (lvar->scope() == rvar.scope());
+  }
+
+#if ENABLE_OPTIMIZATIONS
+  if (const opt_membership_array* lset = may_down_cast<opt_membership_array>(lhs))
+    return lset->elems() == down_cast<opt_membership_array>(rhs).elems();
+#endif /* ENABLE_OPTIMIZATIONS */
+
+  return true;
+}
+
+#if ENABLE_OPTIMIZATIONS
+
+/// common subexpression elimination
+/// \details
+///   structurally equal subtrees are grouped into classes. Subtrees that
+///   occur more than once, have no side effects (log), and do not read
+///   lambda frames that are opened outside the subtree are moved into a
+///   table. Each occurrence is replaced by a common_subexpr node, which
+///   the evaluator computes at most once per evaluation.
+///   Variables and values are not shared; repeated variables are
+///   memoized by the evaluator.
+struct subexpr_eliminator {
+  explicit subexpr_eliminator(std::vector<std::uint32_t> &varuses)
+  : uses(varuses)
+  {}
+
+  /// runs the pass on \p root and returns the table of shared subtrees
+  std::vector<any_expr> run(any_expr &root) {
+    assert(root.get());
+
+    analyze(*root, 0);
+    select(*root);
+
+    table.resize(numshared);
+    replace(root);
+
+    return std::move(table);
+  }
+
+ private:
+  /// no lambda frame is accessed
+  static constexpr int no_frame = std::numeric_limits<int>::max();
+
+  struct node_info {
+    int  cls;       ///< class of structurally equal nodes
+    int  minframe;  ///< outermost lambda frame accessed by the subtree
+    bool pure;      ///< subtree is free of side effects
+    bool eligible;  ///< node can be shared
+  };
+
+  struct class_info {
+    const expr* repr;          ///< representative node
+    std::size_t count  = 0;    ///< remaining eligible occurrences
+    int         shared = -1;   ///< index into the table, or -1
+  };
+
+  /// the properties of a node that the pass depends on
+  /// \details
+  ///   computed with a single visit, instead of a down cast per property.
+  struct node_kind : forwarding_visitor {
+    const oper*       op       = nullptr;
+    const value_base* value    = nullptr;
+    const var*        variable = nullptr;
+    bool              opaque   = false;  ///< never considered equal
+    bool              lambda   = false;  ///< opens a lambda frame for operand 1
+    bool              frames   = false;  ///< reads the frames of all open lambdas
+    bool              impure   = false;  ///< has side effects
+
+    void visit(const expr &) final {}
+    void visit(const oper &n) final { op = &n; }
+    void visit(const if_expr &n) final { op = &n; }
+
+    void visit(const map &n) final    { lambda = true; op = &n; }
+    void visit(const reduce &n) final { lambda = true; op = &n; }
+    void visit(const filter &n) final { lambda = true; op = &n; }
+    void visit(const all &n) final    { lambda = true; op = &n; }
+    void visit(const none &n) final   { lambda = true; op = &n; }
+    void visit(const some &n) final   { lambda = true; op = &n; }
+
+    void visit(const var &n) final          { variable = &n; op = &n; }
+    void visit(const missing &n) final      { frames = true; op = &n; }
+    void visit(const missing_some &n) final { frames = true; op = &n; }
+    void visit(const log &n) final          { impure = true; op = &n; }
+
+    void visit(const value_base &n) final { value = &n; }
+
+    void visit(const object_value &) final  { opaque = true; }
+    void visit(const error &) final         { opaque = true; }
+    void visit(const interned_expr &) final { opaque = true; }
+  };
+
+  /// returns the class id of node \p e with kind \p kind and
+  ///   children classes \p children
+  int classify(const expr &e, const node_kind &kind, std::span<const int> children) {
+    // type_info objects are unique, so their addresses identify the type
+    std::size_t h = std::hash<const void*>{}(&typeid(e));
+
+    for (int cls : children)
+      h = combine(h, cls);
+
+    if (kind.value)
+      h = combine(h, literal_hash(kind.value->to_variant()));
+    else if (kind.variable)
+      h = combine(combine(h, kind.variable->num()), kind.variable->scope());
+
+    auto [beg, lim] = buckets.equal_range(h);
+
+    for (; beg != lim; ++beg) {
+      const expr& repr = *classes[beg->second].repr;
+
+      if (typeid(repr) != typeid(e))
+        continue;
+
+      if (!same_attributes(repr, e))
+        continue;
+
+      const oper* op = may_down_cast<oper>(repr);
+      const std::size_t numops = op ? op->size() : 0;
+
+      if (numops != children.size())
+        continue;
+
+      bool same = true;
+
+      for (std::size_t i = 0; same && (i < numops); ++i)
+        same = (nodes.at(op->operands()[i].get()).cls == children[i]);
+
+      if (same) return beg->second;
+    }
+
+    const int cls = classes.size();
+
+    classes.push_back(class_info{&e});
+    buckets.emplace(h, cls);
+    return cls;
+  }
+
+  /// computes node information bottom-up
+  /// \param depth number of lambda frames that are open at \p e
+  const node_info& analyze(const expr &e, int depth) {
+    node_info info{-1, no_frame, true, false};
+    node_kind kind;
+
+    e.accept(kind);
+
+    if (kind.opaque) {
+      // opaque nodes are never considered equal
+      info.cls  = classes.size();
+      info.pure = false;
+      classes.push_back(class_info{&e});
+
+      return nodes[&e] = info;
+    }
+
+    // the children's classes are kept on a stack shared by all nodes
+    const std::size_t first = children.size();
+
+    if (kind.op) {
+      int pos = 0;
+
+      for (const any_expr& child : kind.op->operands()) {
+        const node_info& sub = analyze(*child, (kind.lambda && pos == 1) ? depth + 1 : depth);
+
+        children.push_back(sub.cls);
+        info.minframe = std::min(info.minframe, sub.minframe);
+        info.pure     = info.pure && sub.pure;
+        ++pos;
+      }
+    }
+
+    if (const var* v = kind.variable) {
+      if (v->scope() != var::global_scope)
+        info.minframe = std::min<int>(info.minframe, v->scope());
+      else if (v->num() == var::computed)
+        info.minframe = 0; // computed names may read "", current, or accumulator
+    }
+    else if (kind.frames) {
+      info.minframe = 0;
+    }
+    else if (kind.impure) {
+      info.pure = false;
+    }
+
+    info.cls      = classify(e, kind, std::span<const int>(children).subspan(first));
+    info.eligible = (  info.pure
+                    && (info.minframe >= depth)
+                    && kind.op
+                    && !kind.variable
+                    );
+
+    children.resize(first);
+
+    if (info.eligible)
+      ++classes[info.cls].count;
+
+    return nodes[&e] = info;
+  }
+
+  /// calls \p fn for all strict descendants of \p e
+  template <class Fn>
+  void descendants(const expr &e, Fn fn) {
+    if (const oper* op = may_down_cast<oper>(e)) {
+      for (const any_expr& child : op->operands()) {
+        fn(*child);
+        descendants(*child, fn);
+      }
+    }
+  }
+
+  /// selects the classes that are shared (top-down)
+  void select(const expr &e) {
+    const node_info& info = nodes.at(&e);
+    class_info&      cls  = classes[info.cls];
+
+    if (info.eligible && (cls.count > 1)) {
+      // a later occurrence will be replaced entirely
+      if (cls.shared >= 0)
+        return;
+
+      cls.shared = numshared++;
+
+      // the subtrees of the other occurrences are removed
+      const std::size_t removed = cls.count - 1;
+
+      descendants( e,
+                   [this, removed](const expr &sub) -> void {
+                     const node_info& subinfo = nodes.at(&sub);
+
+                     if (subinfo.eligible)
+                       classes[subinfo.cls].count -= removed;
+                   }
+                 );
+    }
+
+    if (const oper* op = may_down_cast<oper>(e))
+      for (const any_expr& child : op->operands())
+        select(*child);
+  }
+
+  /// replaces shared subtrees with common_subexpr nodes (top-down)
+  void replace(any_expr &slot) {
+    const node_info& info   = nodes.at(slot.get());
+    const int        shared = classes[info.cls].shared;
+
+    if (info.eligible && (shared >= 0)) {
+      any_expr& entry = table[shared];
+
+      if (!entry) {
+        entry = std::move(slot);
+        replace_children(*entry);
+      } else {
+        release(*slot);
+      }
+
+      slot.reset(new common_subexpr(shared, *entry));
+      return;
+    }
+
+    replace_children(*slot);
+  }
+
+  void replace_children(expr &e) {
+    if (oper* op = may_down_cast<oper>(e))
+      for (any_expr& child : op->operands())
+        replace(child);
+  }
+
+  /// removes the variable uses of a subtree that is discarded
+  void release(const expr &e) {
+    auto unuse = [this](const expr &sub) -> void {
+                   const var* v = may_down_cast<var>(sub);
+
+                   if (v && (v->scope() == var::global_scope) && (v->num() >= 0))
+                     --uses.at(v->num());
+                 };
+
+    unuse(e);
+    descendants(e, unuse);
+  }
+
+  std::vector<std::uint32_t>&                  uses;
+  std::unordered_map<const expr*, node_info>   nodes     = {};
+  std::unordered_multimap<std::size_t, int>    buckets   = {};
+  std::vector<class_info>                      classes   = {};
+  std::vector<int>                             children  = {};
+  std::vector<any_expr>                        table     = {};
+  int                                          numshared = 0;
+};
+
+
+/// returns true if the evaluation of \p e has side effects
+bool has_side_effects(const expr &e) {
+  if (may_down_cast<log>(e))
+    return true;
+
+  if (const common_subexpr* cse = may_down_cast<common_subexpr>(e))
+    return has_side_effects(cse->shared());
+
+  if (const oper* op = may_down_cast<oper>(e))
+    return std::any_of( op->operands().begin(), op->operands().end(),
+                        [](const any_expr& sub) -> bool { return has_side_effects(*sub); }
+                      );
+
+  return false;
+}
+
+/// assigns profiles to junctions whose operands can be reordered
+/// \details
+///   a junction is eligible if it has between 2 and 64 operands
+///   and none of its operands has side effects.
+///   Side effects are determined in the same bottom-up pass.
+/// \return true if the evaluation of \p e has side effects
+bool assign_junction_profiles(expr &e, std::vector<junction_profile> &profiles) {
+  if (const common_subexpr* cse = may_down_cast<common_subexpr>(e))
+    return has_side_effects(cse->shared());
+
+  oper* op = may_down_cast<oper>(e);
+
+  if (op == nullptr)
+    return false;
+
+  bool effects = (may_down_cast<log>(e) != nullptr);
+
+  for (any_expr& sub : op->operands())
+    effects = assign_junction_profiles(*sub, profiles) || effects;
+
+  junction* jct = may_down_cast<junction>(e);
+
+  if ((jct == nullptr) || effects)
+    return effects;
+
+  const int num = jct->num_evaluated_operands();
+
+  if ((num < 2) || (num > 64))
+    return false;
+
+  junction_profile& prof = profiles.emplace_back();
+
+  prof.operands.resize(num);
+  prof.order.resize(num);
+  std::iota(prof.order.begin(), prof.order.end(), 0);
+  jct->profile(profiles.size() - 1);
+  return false;
+}
+
+#endif /* ENABLE_OPTIMIZATIONS */
+
+/// returns \p val as double, if val is a number that a double represents exactly
+std::optional<double> exact_number(const value_variant& val) {
+  // integers with a magnitude of at most 2^53 are exactly representable
+  constexpr std::int64_t limit = std::int64_t(1) << std::numeric_limits<double>::digits;
+
+  switch (val.index()) {
+    case sint_variant: {
+      const std::int64_t num = std::get<std::int64_t>(val);
+
+      if ((num < -limit) || (num > limit))
+        return std::nullopt;
+
+      return double(num);
+    }
+
+    case uint_variant: {
+      const std::uint64_t num = std::get<std::uint64_t>(val);
+
+      if (num > std::uint64_t(limit))
+        return std::nullopt;
+
+      return double(num);
+    }
+
+    case real_variant: {
+      const double num = std::get<double>(val);
+
+      if (num != num) // NaN
+        return std::nullopt;
+
+      return num;
+    }
+
+    default: ;
+  }
+
+  return std::nullopt;
+}
+
+#if ENABLE_OPTIMIZATIONS
+
+/// builds the predicate index of a rule set
+/// \details
+///   the conditions of a rule are the operands of its top-level and
+///   (recursively), or the rule itself. Indexed conditions are
+///   - equality (==, ===) of a variable and a literal,
+///   - membership of a variable in a literal array, and
+///   - comparisons (<, <=, >, >=) of a variable and a number.
+///   A rule is indexed by an equality or membership condition, preferring
+///   equality with a non-boolean value. Otherwise, the comparisons of a variable are combined into an
+///   interval, preferring variables with a lower and an upper bound.
+struct predicate_index_builder {
+  std::unique_ptr<predicate_index> run(const array &rules) {
+    auto res = std::make_unique<predicate_index>();
+
+    index = res.get();
+
+    std::uint32_t id = 0;
+
+    for (const any_expr& rule : rules)
+      add(*rule, id++);
+
+    for (predicate_index::variable_conditions& conds : index->variables) {
+      std::sort( conds.ranges.begin(), conds.ranges.end(),
+                 [](const predicate_index::interval& lhs, const predicate_index::interval& rhs) -> bool {
+                   return lhs.lo < rhs.lo;
+                 }
+               );
+
+      conds.maxhi.resize(conds.ranges.size());
+      build_maxhi(conds, 0, conds.ranges.size());
+    }
+
+    return res;
+  }
+
+ private:
+  /// an equality or membership condition of a rule
+  struct equality_condition {
+    const var*                  variable;
+    const value_base*           literal;  ///< the compared value of an equality
+    const opt_membership_array* set;      ///< the set of a membership test
+    int                         rank;     ///< higher ranks are expected to be more selective
+  };
+
+  /// bounds of a variable collected from the conditions of a rule
+  struct bounds {
+    const var* variable;
+    double     lo      = -std::numeric_limits<double>::infinity();
+    double     hi      = std::numeric_limits<double>::infinity();
+    bool       lo_open = false;
+    bool       hi_open = false;
+
+    bool bounded() const { return (lo != -std::numeric_limits<double>::infinity())
+                                  && (hi != std::numeric_limits<double>::infinity()); }
+  };
+
+  /// returns the expression that \p e refers to, if e is a common_subexpr
+  static const expr& unshared(const expr& e) {
+    if (const common_subexpr* cse = may_down_cast<common_subexpr>(e))
+      return cse->shared();
+
+    return e;
+  }
+
+  /// returns \p e if it is a non-computed variable in global scope
+  static const var* global_variable(const expr& e) {
+    const var* v = may_down_cast<var>(e);
+
+    if (v && (v->scope() == var::global_scope) && (v->num() >= 0))
+      return v;
+
+    return nullptr;
+  }
+
+  void add(const expr& rule, std::uint32_t id) {
+    equalities.clear();
+    ranges.clear();
+
+    conditions(unshared(rule));
+
+    const equality_condition* eq = nullptr;
+
+    for (const equality_condition& cand : equalities)
+      if ((eq == nullptr) || (cand.rank > eq->rank))
+        eq = &cand;
+
+    if (eq != nullptr) {
+      predicate_index::variable_conditions& conds = conditions_of(*eq->variable);
+
+      if (eq->set) {
+        // the same hash and equality as the evaluation of the set
+        for (const value_variant& elem : eq->set->elems())
+          conds.equal[elem].push_back(id);
+
+        return;
+      }
+
+      const value_variant val = eq->literal->to_variant();
+
+      conds.equal[val].push_back(id);
+      conds.typed[val.index()].push_back(id);
+      return;
+    }
+
+    const bounds* best = nullptr;
+
+    for (const bounds& cand : ranges)
+      if ((best == nullptr) || (cand.bounded() && !best->bounded()))
+        best = &cand;
+
+    if (best == nullptr) {
+      index->unindexed.push_back(id);
+      return;
+    }
+
+    conditions_of(*best->variable).ranges.push_back(
+        predicate_index::interval{best->lo, best->hi, best->lo_open, best->hi_open, id} );
+  }
+
+  /// collects the conditions in \p e
+  void conditions(const expr& e) {
+    if (const logical_and* conj = may_down_cast<logical_and>(e)) {
+      for (const any_expr& sub : *conj)
+        conditions(unshared(*sub));
+
+      return;
+    }
+
+    if (!equality(e))
+      comparison(e);
+  }
+
+  /// collects equality and membership conditions
+  /// \return true, if \p e is an equality or membership condition
+  bool equality(const expr& e) {
+    if (const opt_membership_array* set = may_down_cast<opt_membership_array>(e)) {
+      const var* v = global_variable(set->operand(0));
+
+      if (v == nullptr)
+        return false;
+
+      equalities.push_back(equality_condition{v, nullptr, set, 2});
+      return true;
+    }
+
+    if (!may_down_cast<equal>(e) && !may_down_cast<strict_equal>(e))
+      return false;
+
+    const oper& op = down_cast<oper>(e);
+
+    if (op.num_evaluated_operands() != 2)
+      return false;
+
+    const var*        v   = global_variable(op.operand(0));
+    const value_base* lit = may_down_cast<value_base>(op.operand(1));
+
+    if (v == nullptr) {
+      v   = global_variable(op.operand(1));
+      lit = may_down_cast<value_base>(op.operand(0));
+    }
+
+    if ((v == nullptr) || (lit == nullptr))
+      return false;
+
+    switch (lit->to_variant().index()) {
+      case bool_variant:
+        equalities.push_back(equality_condition{v, lit, nullptr, 1});
+        return true;
+
+      case sint_variant:
+      case uint_variant:
+      case real_variant:
+      case strv_variant:
+        equalities.push_back(equality_condition{v, lit, nullptr, 3});
+        return true;
+
+      default: ;
+    }
+
+    return false;
+  }
+
+  /// collects the bounds of comparison chains (e.g., 1 < x < 5)
+  void comparison(const expr& e) {
+    const bool ascending = may_down_cast<less>(e) || may_down_cast<less_or_equal>(e);
+    const bool open      = may_down_cast<less>(e) || may_down_cast<greater>(e);
+
+    if (!ascending && !may_down_cast<greater>(e) && !may_down_cast<greater_or_equal>(e))
+      return;
+
+    const oper& op  = down_cast<oper>(e);
+    const int   num = op.num_evaluated_operands();
+
+    for (int i = 0; i + 1 < num; ++i) {
+      // lhs < rhs bounds a variable rhs from below, and a variable lhs from above
+      const expr& lhs = op.operand(i);
+      const expr& rhs = op.operand(i + 1);
+
+      if (const var* v = global_variable(lhs))
+        bound(*v, rhs, !ascending, open);
+      else if (const var* v = global_variable(rhs))
+        bound(*v, lhs, ascending, open);
+    }
+  }
+
+  /// adds a bound \p lim to the variable \p v
+  void bound(const var& v, const expr& lim, bool lower, bool open) {
+    const value_base* lit = may_down_cast<value_base>(lim);
+
+    if (lit == nullptr)
+      return;
+
+    const std::optional<double> num = exact_number(lit->to_variant());
+
+    if (!num)
+      return;
+
+    auto pos = std::find_if( ranges.begin(), ranges.end(),
+                             [&v](const bounds& b) -> bool { return b.variable->num() == v.num(); }
+                           );
+
+    if (pos == ranges.end())
+      pos = ranges.insert(pos, bounds{&v});
+
+    if (lower && ((*num > pos->lo) || ((*num == pos->lo) && open))) {
+      pos->lo      = *num;
+      pos->lo_open = open;
+    }
+
+    if (!lower && ((*num < pos->hi) || ((*num == pos->hi) && open))) {
+      pos->hi      = *num;
+      pos->hi_open = open;
+    }
+  }
+
+  predicate_index::variable_conditions& conditions_of(const var& v) {
+    auto [pos, added] = slots.emplace(v.num(), index->variables.size());
+
+    if (added)
+      index->variables.emplace_back().variable = &v;
+
+    return index->variables[pos->second];
+  }
+
+  static
+  double build_maxhi(predicate_index::variable_conditions& conds, std::size_t beg, std::size_t lim) {
+    if (beg >= lim)
+      return -std::numeric_limits<double>::infinity();
+
+    const std::size_t mid = beg + (lim - beg) / 2;
+    const double      lhs = build_maxhi(conds, beg, mid);
+    const double      rhs = build_maxhi(conds, mid + 1, lim);
+
+    return conds.maxhi[mid] = std::max({conds.ranges[mid].hi, lhs, rhs});
+  }
+
+  predicate_index*                     index      = nullptr;
+  std::unordered_map<int, std::size_t> slots      = {};
+  std::vector<equality_condition>      equalities = {};
+  std::vector<bounds>                  ranges     = {};
+};
+
+/// groups consecutive rules with common leading conditions
+/// \details
+///   the conditions of a rule are the operands of its top-level and
+///   (recursively), or the rule itself. Two conditions are the same
+///   if they refer to the same common subexpression or read the same
+///   variable. Conditions with side effects are not shared.
+struct first_match_planner {
+  std::unique_ptr<first_match_plan> run(const array &rules) {
+    auto res = std::make_unique<first_match_plan>();
+
+    plan = res.get();
+    conditions.reserve(rules.size());
+
+    for (const any_expr& rule : rules)
+      flatten(*rule, conditions.emplace_back());
+
+    emit(0, conditions.size(), 0);
+    return res;
+  }
+
+ private:
+  static void flatten(const expr& e, std::vector<const expr*>& conds) {
+    const logical_and* conj = may_down_cast<logical_and>(e);
+
+    if ((conj == nullptr) || (conj->size() == 0)) {
+      conds.push_back(&e);
+      return;
+    }
+
+    for (const any_expr& sub : *conj)
+      flatten(*sub, conds);
+  }
+
+  static bool same(const expr& lhs, const expr& rhs) {
+    if (const common_subexpr* lcse = may_down_cast<common_subexpr>(lhs)) {
+      const common_subexpr* rcse = may_down_cast<common_subexpr>(rhs);
+
+      return rcse && (lcse->id() == rcse->id()) && !has_side_effects(lcse->shared());
+    }
+
+    const var* lvar = may_down_cast<var>(lhs);
+    const var* rvar = may_down_cast<var>(rhs);
+
+    return lvar && rvar
+           && (lvar->scope() == var::global_scope) && (lvar->num() >= 0)
+           && (lvar->scope() == rvar->scope()) && (lvar->num() == rvar->num())
+           && (lvar->size() == 1) && (rvar->size() == 1);
+  }
+
+  /// returns true if the rules in [beg, lim) share the condition at position \p pos
+  bool shared(std::size_t beg, std::size_t lim, std::size_t pos) const {
+    const std::vector<const expr*>& first = conditions[beg];
+
+    if (first.size() <= pos)
+      return false;
+
+    for (std::size_t i = beg + 1; i < lim; ++i)
+      if ((conditions[i].size() <= pos) || !same(*first[pos], *conditions[i][pos]))
+        return false;
+
+    return true;
+  }
+
+  /// emits the steps for the rules in [beg, lim), whose first \p pos conditions are shared
+  void emit(std::size_t beg, std::size_t lim, std::size_t pos) {
+    std::size_t i = beg;
+
+    while (i < lim) {
+      const std::vector<const expr*>& conds = conditions[i];
+      std::size_t                      j     = i + 1;
+
+      if (conds.size() > pos) {
+        while (  (j < lim)
+              && (conditions[j].size() > pos)
+              && same(*conds[pos], *conditions[j][pos])
+              )
+          ++j;
+      }
+
+      if (j - i < 2) {
+        first_match_plan::step& st = plan->steps.emplace_back();
+
+        st.conditions.assign(conds.begin() + std::min(pos, conds.size()), conds.end());
+        st.rule = i;
+        st.skip = plan->steps.size();
+        ++i;
+        continue;
+      }
+
+      std::size_t end = pos + 1;
+
+      while (shared(i, j, end))
+        ++end;
+
+      const std::size_t grp = plan->steps.size();
+
+      plan->steps.emplace_back().conditions.assign(conds.begin() + pos, conds.begin() + end);
+      emit(i, j, end);
+      plan->steps[grp].skip = plan->steps.size();
+      i = j;
+    }
+  }
+
+  first_match_plan*                     plan       = nullptr;
+  std::vector<std::vector<const expr*>> conditions = {};
+};
+
+#endif /* ENABLE_OPTIMIZATIONS */
+
+/// assigns the profiles of the junctions in the syntax tree of \p data
+///   and in its common subexpressions
+void assign_junction_profiles(CXX_MAYBE_UNUSED logic_data& data) {
+#if ENABLE_OPTIMIZATIONS
+  std::vector<junction_profile>& profiles = data.junction_profiles;
+
+  assign_junction_profiles(*std::get<0>(data), profiles);
+
+  for (const any_expr& sub : data.common_subexpressions())
+    assign_junction_profiles(*sub, profiles);
+#endif /* ENABLE_OPTIMIZATIONS */
+}
+
+/// creates the rule data for the translated expression \p node
+/// \details
+///    runs the optimization passes that span the entire expression.
+std::unique_ptr<logic_data> make_logic_data(any_expr node, const variable_map& varmap) {
+  bool const hasComputedVariables = varmap.hasComputedVariables();
+  std::vector<std::uint32_t> uses = varmap.use_counts();
+  std::vector<any_expr> shared;
+
+#if ENABLE_OPTIMIZATIONS
+  shared = subexpr_eliminator{uses}.run(node);
+#endif /* ENABLE_OPTIMIZATIONS */
+
+  auto data = std::make_unique<logic_data>( std::move(node),
+                                            varmap.to_vector(),
+                                            hasComputedVariables,
+                                            std::move(uses),
+                                            std::move(shared)
+                                          );
+
+  assign_junction_profiles(*data);
+  return data;
+}
+
+/// returns the number of json values in \p n
+std::size_t count_values(const json::value& n) {
+  std::size_t res = 1;
+
+  if (const json::object* obj = n.if_object())
+    for (const json::key_value_pair& el : *obj)
+      res += count_values(el.value());
+  else if (const json::array* arr = n.if_array())
+    for (const json::value& el : *arr)
+      res += count_values(el);
+
+  return res;
+}
+
+/// returns an arena for the translation of \p rules, if \p opts asks for one
+std::unique_ptr<node_arena>
+make_arena(std::span<const json::value> rules, const logic_options& opts) {
+  // a json value becomes a node and an entry in its parent's operand
+  //   array; generated rules need 30 to 37 bytes per value.
+  constexpr std::size_t bytes_per_value = 40;
+
+  if (!opts.arena)
+    return nullptr;
+
+  std::size_t values = 0;
+
+  for (const json::value& rule : rules)
+    values += count_values(rule);
+
+  return std::make_unique<node_arena>(values * bytes_per_value);
+}
+
+/// returns an arena for the translation of the json text \p text, if
+///   \p opts asks for one
+std::unique_ptr<node_arena>
+make_arena(std::string_view text, const logic_options& opts) {
+  // generated rules need 5.5 to 9 bytes of nodes per character
+  constexpr std::size_t bytes_per_char = 9;
+
+  if (!opts.arena)
+    return nullptr;
+
+  return std::make_unique<node_arena>(text.size() * bytes_per_char);
+}
+
+} // namespace
+
+
+logic_rule create_logic(const json::value& n) {
+  return create_logic(n, logic_options{});
+}
+
+logic_rule create_logic(const json::value& n, const logic_options& opts) {
+  std::unique_ptr<node_arena> arena = make_arena(std::span<const json::value>(&n, 1), opts);
+  std::optional<node_arena::scope> active;
+
+  if (arena) active.emplace(*arena);
+
+  variable_map varmap;
+  any_expr node = translate_internal(n, varmap);
+  std::unique_ptr<logic_data> data = make_logic_data(std::move(node), varmap);
+
+  data->arena = std::move(arena);
+  return logic_rule(std::move(data));
+}
+
+logic_rule create_logic_from_text(std::string_view text) {
+  return create_logic_from_text(text, logic_options{});
+}
+
+logic_rule create_logic_from_text(std::string_view text, const logic_options& opts) {
+  std::unique_ptr<node_arena> arena = make_arena(text, opts);
+  std::optional<node_arena::scope> active;
+
+  if (arena) active.emplace(*arena);
+
+  variable_map varmap;
+  any_expr node = translate_text(text, varmap);
+  std::unique_ptr<logic_data> data = make_logic_data(std::move(node), varmap);
+
+  data->arena = std::move(arena);
+  return logic_rule(std::move(data));
+}
+
+rule_set create_rule_set(std::span<const json::value> rules) {
+  return create_rule_set(rules, logic_options{});
+}
+
+rule_set create_rule_set(std::span<const json::value> rules, const logic_options& opts) {
+  std::unique_ptr<node_arena> arena = make_arena(rules, opts);
+  std::optional<node_arena::scope> active;
+
+  if (arena) active.emplace(*arena);
+
+  variable_map         varmap;
+  oper::container_type elems;
+
+  // all rules share the variable map, thus the variable slots
+  elems.reserve(rules.size());
+
+  for (const json::value& rule : rules)
+    elems.emplace_back(translate_internal(rule, varmap));
+
+  // the rules become the elements of an array, so that the optimization
+  //   passes (e.g., common subexpression elimination) span all rules.
+  array& root = mk_array();
+
+  root.set_operands(std::move(elems));
+
+  std::unique_ptr<logic_data> data = make_logic_data(any_expr(&root), varmap);
+
+#if ENABLE_OPTIMIZATIONS
+  data->index = predicate_index_builder{}.run(root);
+  data->plan  = first_match_planner{}.run(root);
+#endif /* ENABLE_OPTIMIZATIONS */
+
+  data->arena = std::move(arena);
+  return rule_set(std::move(data));
+}
+
+//
+// rule_store
+
+/// internal state of a rule_store
+struct rule_store_data {
+  /// a tree of nodes that rules share
+  struct tree_record {
+    std::weak_ptr<const expr> root;
+    tree_footprint            size;
+  };
+
+  /// nodes of shared trees by structural hash
+  std::unordered_multimap<std::size_t, std::weak_ptr<const expr>> subtrees;
+
+  /// string literals of all rules
+  variable_map::literal_pool literals;
+
+  std::vector<tree_record> trees;
+  std::vector<std::weak_ptr<const rule_footprint>> rules;
+
+  /// number of records after the last purge
+  std::size_t purged = 0;
+
+  /// removes the records of released rules, trees, and literals
+  void purge();
+};
+
+void rule_store_data::purge() {
+  std::erase_if(rules, [](const std::weak_ptr<const rule_footprint>& rule) -> bool {
+                         return rule.expired();
+                       });
+  std::erase_if(trees, [](const tree_record& tree) -> bool { return tree.root.expired(); });
+  std::erase_if(subtrees, [](const auto& entry) -> bool { return entry.second.expired(); });
+
+  // the pool holds the last reference to literals that no node uses
+  std::erase_if(literals, [](const auto& entry) -> bool { return entry.second.use_count() == 1; });
+
+  purged = rules.size() + trees.size();
+}
+
+namespace {
+
+/// returns the subtree that \p e refers to, if e is an interned_expr
+const expr& interned_target(const expr& e) {
+  if (const interned_expr* ref = may_down_cast<interned_expr>(e))
+    return ref->shared();
+
+  return e;
+}
+
+/// returns true for nodes that are never considered equal
+bool opaque(const expr& e) {
+  return may_down_cast<object_value>(e) || may_down_cast<error>(e);
+}
+
+/// tests whether \p lhs and \p rhs are structurally equal
+bool same_subtree(const expr& lhs, const expr& rhs) {
+  const expr& l = interned_target(lhs);
+  const expr& r = interned_target(rhs);
+
+  if (&l == &r)
+    return true;
+
+  if ((typeid(l) != typeid(r)) || opaque(l) || !same_attributes(l, r))
+    return false;
+
+  const oper* lop = may_down_cast<oper>(l);
+
+  if (lop == nullptr)
+    return true;
+
+  const oper& rop = down_cast<oper>(r);
+
+  if (lop->size() != rop.size())
+    return false;
+
+  for (std::size_t i = 0; i < lop->size(); ++i)
+    if (!same_subtree(*lop->operands()[i], *rop.operands()[i]))
+      return false;
+
+  return true;
+}
+
+/// returns the size of the dynamic type of a node
+struct node_size {
+  template <class ast_node>
+  std::size_t operator()(const ast_node&) const { return sizeof(ast_node); }
+};
+
+/// returns the estimated memory of \p e without its operands
+std::size_t node_bytes(const expr& e) {
+  std::size_t res = generic_visit(node_size{}, &e);
+
+  if (const oper* op = may_down_cast<oper>(e))
+    res += op->operands().capacity() * sizeof(any_expr);
+
+#if ENABLE_OPTIMIZATIONS
+  // a hash set entry holds the element and a link; a bucket a pointer
+  if (const opt_membership_array* set = may_down_cast<opt_membership_array>(e))
+    res += (  set->elems().size() * (sizeof(value_variant) + sizeof(void*))
+           + set->elems().bucket_count() * sizeof(void*)
+           );
+#endif /* ENABLE_OPTIMIZATIONS */
+
+  return res;
+}
+
+/// adds the nodes of \p e to \p res; shared subtrees are not included.
+void add_footprint(const expr& e, tree_footprint& res) {
+  ++res.nodes;
+  res.bytes += node_bytes(e);
+
+  if (const oper* op = may_down_cast<oper>(e))
+    for (const any_expr& child : op->operands())
+      add_footprint(*child, res);
+}
+
+/// shares the subtrees of a rule with the rules of a store
+/// \details
+///   top-down, each subtree is looked up in the store; a subtree that
+///   is found is replaced by an interned_expr that refers to the store's
+///   copy. The remaining subtrees are moved into the store as new shared
+///   trees, whose nodes can be found by later rules.
+///   Values and variables are shared only as part of a larger subtree.
+struct subtree_interner {
+  explicit subtree_interner(rule_store_data& storedata)
+  : store(storedata)
+  {}
+
+  void run(any_expr& root) {
+    assert(root.get());
+
+    analyze(*root);
+    intern(root);
+  }
+
+ private:
+  struct node_info {
+    std::size_t hash;      ///< structural hash
+    bool        sharable;  ///< the subtree contains no opaque node
+  };
+
+  /// computes node information bottom-up
+  const node_info& analyze(const expr& e) {
+    // type_info objects are unique, so their addresses identify the type
+    node_info info{std::hash<const void*>{}(&typeid(e)), !opaque(e)};
+
+    if (const value_base* val = may_down_cast<value_base>(e))
+      info.hash = combine(info.hash, literal_hash(val->to_variant()));
+    else if (const var* v = may_down_cast<var>(e))
+      info.hash = combine(combine(info.hash, v->num()), v->scope());
+
+#if ENABLE_OPTIMIZATIONS
+    // the elements of a set are unordered
+    if (const opt_membership_array* set = may_down_cast<opt_membership_array>(e))
+      for (const value_variant& el : set->elems())
+        info.hash += std::hash<value_variant>{}(el);
+#endif /* ENABLE_OPTIMIZATIONS */
+
+    if (const oper* op = may_down_cast<oper>(e)) {
+      for (const any_expr& child : op->operands()) {
+        const node_info& sub = analyze(*child);
+
+        info.hash     = combine(info.hash, sub.hash);
+        info.sharable = info.sharable && sub.sharable;
+      }
+    }
+
+    return nodes[&e] = info;
+  }
+
+  /// true for nodes that are looked up in the store
+  bool candidate(const expr& e) const {
+    return nodes.at(&e).sharable && may_down_cast<oper>(e) && !may_down_cast<var>(e);
+  }
+
+  /// shares \p slot, or the subtrees of non-sharable nodes
+  void intern(any_expr& slot) {
+    if (!candidate(*slot)) {
+      if (oper* op = may_down_cast<oper>(*slot))
+        for (any_expr& child : op->operands())
+          intern(child);
+
+      return;
+    }
+
+    if (share(slot))
+      return;
+
+    // the rest of the subtree becomes a new shared tree
+    std::shared_ptr<const expr>  tree(slot.release());
+    rule_store_data::tree_record rec{tree, {}};
+
+    add_footprint(*tree, rec.size);
+    store.trees.push_back(rec);
+    publish(*tree, tree);
+
+    slot.reset(new interned_expr(std::move(tree)));
+  }
+
+  /// replaces \p slot, or its largest subtrees, by equal subtrees
+  ///   of the store
+  /// \return true, iff slot was replaced
+  bool share(any_expr& slot) {
+    if (candidate(*slot)) {
+      auto [beg, lim] = store.subtrees.equal_range(nodes.at(slot.get()).hash);
+
+      for (; beg != lim; ++beg) {
+        std::shared_ptr<const expr> found = beg->second.lock();
+
+        if (found && same_subtree(*found, *slot)) {
+          slot.reset(new interned_expr(std::move(found)));
+          return true;
+        }
+      }
+    }
+
+    if (oper* op = may_down_cast<oper>(*slot))
+      for (any_expr& child : op->operands())
+        share(child);
+
+    return false;
+  }
+
+  /// makes the nodes of \p e that \p tree owns findable by later rules
+  void publish(const expr& e, const std::shared_ptr<const expr>& tree) {
+    // nodes of other trees are already in the store
+    if (may_down_cast<interned_expr>(e))
+      return;
+
+    // the entry refers to e, but keeps the entire tree alive
+    if (candidate(e))
+      store.subtrees.emplace(nodes.at(&e).hash, std::shared_ptr<const expr>(tree, &e));
+
+    if (const oper* op = may_down_cast<oper>(e))
+      for (const any_expr& child : op->operands())
+        publish(*child, tree);
+  }
+
+  rule_store_data&                            store;
+  std::unordered_map<const expr*, node_info> nodes = {};
+};
+
+} // namespace
+
+rule_store::rule_store()
+: data(std::make_unique<rule_store_data>())
+{}
+
+rule_store::rule_store(rule_store&&)            = default;
+rule_store& rule_store::operator=(rule_store&&) = default;
+rule_store::~rule_store()                       = default;
+
+logic_rule rule_store::create_logic(const json::value& n) {
+  variable_map varmap;
+
+  varmap.share_literals(data->literals);
+
+  any_expr node = translate_internal(n, varmap);
+  auto     size = std::make_shared<rule_footprint>();
+
+  add_footprint(*node, size->translated);
+  subtree_interner{*data}.run(node);
+  add_footprint(*node, size->own);
+
+  // the passes of make_logic_data would modify shared nodes
+  auto rule = std::make_unique<logic_data>( std::move(node),
+                                            varmap.to_vector(),
+                                            varmap.hasComputedVariables(),
+                                            varmap.use_counts(),
+                                            std::vector<any_expr>{}
+                                          );
+
+  rule->footprint = size;
+  data->rules.push_back(size);
+
+  // purging amortizes over the records created since the last purge
+  if (data->rules.size() + data->trees.size() > 2 * data->purged + 1024)
+    data->purge();
+
+  return logic_rule(std::move(rule));
+}
+
+rule_store_statistics rule_store::statistics() const {
+  rule_store_statistics res;
+
+  for (const std::weak_ptr<const rule_footprint>& rule : data->rules) {
+    if (std::shared_ptr<const rule_footprint> size = rule.lock()) {
+      ++res.rules;
+      res.nodes        += size->translated.nodes;
+      res.bytes        += size->translated.bytes;
+      res.stored_nodes += size->own.nodes;
+      res.stored_bytes += size->own.bytes;
+    }
+  }
+
+  for (const rule_store_data::tree_record& tree : data->trees) {
+    if (!tree.root.expired()) {
+      ++res.subtrees;
+      res.stored_nodes += tree.size.nodes;
+      res.stored_bytes += tree.size.bytes;
+    }
+  }
+
+  // a hash table entry holds the element and a link; a bucket a pointer
+  res.index_bytes = (  data->subtrees.size() * (sizeof(*data->subtrees.begin()) + sizeof(void*))
+                    + data->subtrees.bucket_count() * sizeof(void*)
+                    + data->literals.size() * (sizeof(*data->literals.begin()) + sizeof(void*))
+                    + data->literals.bucket_count() * sizeof(void*)
+                    + data->trees.capacity() * sizeof(rule_store_data::tree_record)
+                    + data->rules.capacity() * sizeof(std::weak_ptr<const rule_footprint>)
+                    );
+
+  return res;
+}
+
+//
+// rule images
+
+namespace {
+
+/// node types in a rule image
+/// \details
+///   the numbers are part of the image format; new node types are appended.
+enum class image_kind : std::uint16_t {
+  equal, strict_equal, not_equal, strict_not_equal,
+  less, greater, less_or_equal, greater_or_equal,
+  logical_and, logical_or, logical_not, logical_not_not,
+  add, subtract, multiply, divide, modulo, min, max,
+  map, reduce, filter, all, none, some,
+  array, merge, cat, substr, membership,
+  var, missing, missing_some, log, if_expr,
+  null_value, bool_value, int_value, unsigned_int_value, real_value,
+  string_value, array_value,
+  regex_match, opt_membership_array, common_subexpr,
+  unsupported
+};
+
+constexpr std::array<char, 8> image_magic      = {'J', 'L', 'I', 'M', 'A', 'G', 'E', '\0'};
+constexpr std::uint32_t        image_version    = 1;
+
+/// written in native byte order; identifies images of another byte order
+constexpr std::uint32_t        image_byte_order = 0x01020304;
+
+/// the nesting limit of nodes and array values in a rule image
+/// \details
+///    the loader recurses; common subexpressions nest at their first
+///    reference. The limit admits any rule translated from json text.
+constexpr std::size_t          max_image_depth  = 4 * max_rule_text_depth;
+
+/// image flags
+enum : std::uint32_t { image_computed_names = 1, image_rule_set = 2 };
+
+/// a range of records; the offset is relative to the start of the image
+struct image_section {
+  std::uint64_t offset = 0;
+  std::uint64_t count  = 0;
+};
+
+struct image_header {
+  std::array<char, 8> magic      = image_magic;
+  std::uint32_t       version    = image_version;
+  std::uint32_t       byte_order = image_byte_order;
+  std::uint32_t       flags      = 0;
+  std::uint32_t       reserved   = 0;
+  image_section       nodes;    ///< image_node records in pre-order
+  image_section       values;   ///< image_value records
+  image_section       strings;  ///< characters of all strings
+  image_section       names;    ///< image_value records of the variable names
+  image_section       uses;     ///< occurrences of each variable name (std::uint32_t)
+  image_section       shared;   ///< node index of each common subexpression (std::uint32_t)
+};
+
+/// a node of the syntax tree; its operands follow in pre-order
+struct image_node {
+  std::uint16_t kind     = 0;
+  std::uint16_t reserved = 0;
+  std::uint32_t operands = 0;
+  std::int32_t  a        = 0;  ///< slot (var), value index (values), first element
+                               ///<   (opt_membership_array), or id (common_subexpr)
+  std::int32_t  b        = 0;  ///< scope (var), or number of elements (opt_membership_array)
+};
+
+/// a value; the type is the index of the alternative in value_variant
+struct image_value {
+  std::uint32_t type = null_variant;
+  std::uint32_t size = 0;  ///< length of a string, or number of array elements
+  std::uint64_t bits = 0;  ///< bool and numbers; offset of a string or index of
+                           ///<   the first array element
+};
+
+static_assert(std::is_trivially_copyable_v<image_header>);
+static_assert(sizeof(image_node) == 16);
+static_assert(sizeof(image_value) == 16);
+
+CXX_NORETURN
+void invalid_image() {
+  throw std::runtime_error("invalid rule image");
+}
+
+/// the image_kind of a node
+struct image_kind_of : forwarding_visitor {
+  image_kind kind = image_kind::unsupported;
+
+  void visit(const expr &) final {}
+  void visit(const equal &) final { kind = image_kind::equal; }
+  void visit(const strict_equal &) final { kind = image_kind::strict_equal; }
+  void visit(const not_equal &) final { kind = image_kind::not_equal; }
+  void visit(const strict_not_equal &) final { kind = image_kind::strict_not_equal; }
+  void visit(const less &) final { kind = image_kind::less; }
+  void visit(const greater &) final { kind = image_kind::greater; }
+  void visit(const less_or_equal &) final { kind = image_kind::less_or_equal; }
+  void visit(const greater_or_equal &) final { kind = image_kind::greater_or_equal; }
+  void visit(const logical_and &) final { kind = image_kind::logical_and; }
+  void visit(const logical_or &) final { kind = image_kind::logical_or; }
+  void visit(const logical_not &) final { kind = image_kind::logical_not; }
+  void visit(const logical_not_not &) final { kind = image_kind::logical_not_not; }
+  void visit(const add &) final { kind = image_kind::add; }
+  void visit(const subtract &) final { kind = image_kind::subtract; }
+  void visit(const multiply &) final { kind = image_kind::multiply; }
+  void visit(const divide &) final { kind = image_kind::divide; }
+  void visit(const modulo &) final { kind = image_kind::modulo; }
+  void visit(const min &) final { kind = image_kind::min; }
+  void visit(const max &) final { kind = image_kind::max; }
+  void visit(const map &) final { kind = image_kind::map; }
+  void visit(const reduce &) final { kind = image_kind::reduce; }
+  void visit(const filter &) final { kind = image_kind::filter; }
+  void visit(const all &) final { kind = image_kind::all; }
+  void visit(const none &) final { kind = image_kind::none; }
+  void visit(const some &) final { kind = image_kind::some; }
+  void visit(const array &) final { kind = image_kind::array; }
+  void visit(const merge &) final { kind = image_kind::merge; }
+  void visit(const cat &) final { kind = image_kind::cat; }
+  void visit(const substr &) final { kind = image_kind::substr; }
+  void visit(const membership &) final { kind = image_kind::membership; }
+  void visit(const var &) final { kind = image_kind::var; }
+  void visit(const missing &) final { kind = image_kind::missing; }
+  void visit(const missing_some &) final { kind = image_kind::missing_some; }
+  void visit(const log &) final { kind = image_kind::log; }
+  void visit(const if_expr &) final { kind = image_kind::if_expr; }
+  void visit(const null_value &) final { kind = image_kind::null_value; }
+  void visit(const bool_value &) final { kind = image_kind::bool_value; }
+  void visit(const int_value &) final { kind = image_kind::int_value; }
+  void visit(const unsigned_int_value &) final { kind = image_kind::unsigned_int_value; }
+  void visit(const real_value &) final { kind = image_kind::real_value; }
+  void visit(const string_value &) final { kind = image_kind::string_value; }
+  void visit(const array_value &) final { kind = image_kind::array_value; }
+
+#if WITH_JSON_LOGIC_CPP_EXTENSIONS
+  void visit(const regex_match &) final { kind = image_kind::regex_match; }
+#endif /* WITH_JSON_LOGIC_CPP_EXTENSIONS */
+
+#if ENABLE_OPTIMIZATIONS
+  void visit(const opt_membership_array &) final { kind = image_kind::opt_membership_array; }
+  void visit(const common_subexpr &) final { kind = image_kind::common_subexpr; }
+#endif /* ENABLE_OPTIMIZATIONS */
+};
+
+/// returns the value_variant alternative of a value node of kind \p kind
+int image_value_type(image_kind kind) {
+  switch (kind) {
+    case image_kind::null_value:         return null_variant;
+    case image_kind::bool_value:         return bool_variant;
+    case image_kind::int_value:          return sint_variant;
+    case image_kind::unsigned_int_value: return uint_variant;
+    case image_kind::real_value:         return real_variant;
+    case image_kind::string_value:       return strv_variant;
+    case image_kind::array_value:        return sequ_variant;
+    default:                             return mono_variant;
+  }
+}
+
+/// writes the syntax tree, the common subexpressions, and the variables
+///   of a rule into an image
+struct image_writer {
+  std::vector<std::byte> run(const logic_data& data, std::uint32_t flags) {
+    std::vector<std::uint32_t> shared;
+    std::vector<image_value>   names;
+
+    heights.assign(data.common_subexpressions().size(), 0);
+
+    bool deep = (height(*data.syntax_tree()) > max_image_depth);
+
+    for (const any_expr& sub : data.common_subexpressions())
+      deep = deep || (height(*sub) > max_image_depth);
+
+    if (deep)
+      throw std::length_error("rule too deep for a rule image");
+
+    write(*data.syntax_tree());
+
+    for (const any_expr& sub : data.common_subexpressions()) {
+      shared.push_back(nodes.size());
+      write(*sub);
+    }
+
+    for (std::string_view name : data.variable_names())
+      names.push_back(string_ref(name));
+
+    // records refer to nodes and values by std::int32_t
+    if (  (nodes.size()  > std::size_t(std::numeric_limits<std::int32_t>::max()))
+       || (values.size() > std::size_t(std::numeric_limits<std::int32_t>::max()))
+       )
+      throw std::length_error("rule too large for a rule image");
+
+    std::vector<std::byte> res(sizeof(image_header));
+    image_header           hdr;
+
+    hdr.flags   = flags;
+    hdr.nodes   = append(res, std::span<const image_node>(nodes));
+    hdr.values  = append(res, std::span<const image_value>(values));
+    hdr.strings = append(res, std::span<const char>(strings));
+    hdr.names   = append(res, std::span<const image_value>(names));
+    hdr.uses    = append(res, std::span<const std::uint32_t>(data.variable_uses()));
+    hdr.shared  = append(res, std::span<const std::uint32_t>(shared));
+
+    std::memcpy(res.data(), &hdr, sizeof(hdr));
+    return res;
+  }
+
+ private:
+  /// appends \p recs to \p image at an offset aligned for any record
+  template <class T>
+  static image_section append(std::vector<std::byte>& image, std::span<const T> recs) {
+    const std::size_t offset = (image.size() + 7) & ~std::size_t(7);
+
+    image.resize(offset + recs.size_bytes());
+
+    if (!recs.empty())
+      std::memcpy(image.data() + offset, recs.data(), recs.size_bytes());
+
+    return {offset, recs.size()};
+  }
+
+  /// writes \p e and its operands in pre-order
+  void write(const expr& e) {
+    // rules of a rule_store are written with copies of their shared subtrees
+    const expr&   n = interned_target(e);
+    image_kind_of kind;
+
+    n.accept(kind);
+
+    if (kind.kind == image_kind::unsupported)
+      unsupported();
+
+    image_node rec;
+
+    rec.kind = std::uint16_t(kind.kind);
+
+    if (const var* v = may_down_cast<var>(n)) {
+      rec.a = v->num();
+      rec.b = v->scope();
+    } else if (const array_value* arr = may_down_cast<array_value>(n)) {
+      rec.a = write_value(array_ref(arr->value()));
+    } else if (const value_base* val = may_down_cast<value_base>(n)) {
+      rec.a = write_value(value_record(val->to_variant()));
+    }
+
+#if ENABLE_OPTIMIZATIONS
+    if (const opt_membership_array* set = may_down_cast<opt_membership_array>(n)) {
+      const image_value elems = array_ref(set->elems());
+
+      rec.a = elems.bits;
+      rec.b = elems.size;
+    } else if (const common_subexpr* cse = may_down_cast<common_subexpr>(n)) {
+      rec.a = cse->id();
+    }
+#endif /* ENABLE_OPTIMIZATIONS */
+
+    const oper* op = may_down_cast<oper>(n);
+
+    if (op) rec.operands = op->size();
+
+    nodes.push_back(rec);
+
+    if (op)
+      for (const any_expr& child : op->operands())
+        write(*child);
+  }
+
+  /// returns the nesting depth below \p e as the image_loader counts it
+  /// \details
+  ///    common subexpressions are counted at every reference, which
+  ///    bounds the depth at their first reference.
+  std::size_t height(const expr& e) {
+    const expr& n = interned_target(e);
+
+    if (const array_value* arr = may_down_cast<array_value>(n))
+      return height(arr->value());
+
+#if ENABLE_OPTIMIZATIONS
+    if (const opt_membership_array* set = may_down_cast<opt_membership_array>(n))
+      return height(set->elems());
+
+    if (const common_subexpr* cse = may_down_cast<common_subexpr>(n)) {
+      std::size_t& res = heights[cse->id()];
+
+      if (res == 0)
+        res = height(cse->shared());
+
+      return res + 1;
+    }
+#endif /* ENABLE_OPTIMIZATIONS */
+
+    std::size_t res = 0;
+
+    if (const oper* op = may_down_cast<oper>(n))
+      for (const any_expr& child : op->operands())
+        res = std::max(res, height(*child) + 1);
+
+    return res;
+  }
+
+  /// returns the nesting depth of the elements \p elems
+  template <class Range>
+  static std::size_t height(const Range& elems) {
+    std::size_t res = 0;
+
+    for (const value_variant& el : elems)
+      if (el.index() == sequ_variant)
+        res = std::max(res, height(std::get<array_value const*>(el)->value()));
+
+    return res + 1;
+  }
+
+  std::int32_t write_value(const image_value& rec) {
+    values.push_back(rec);
+    return values.size() - 1;
+  }
+
+  image_value value_record(const value_variant& val) {
+    image_value res;
+
+    res.type = val.index();
+
+    switch (val.index()) {
+      case bool_variant:
+        res.bits = std::get<bool>(val);
+        break;
+
+      case sint_variant:
+        res.bits = std::bit_cast<std::uint64_t>(std::get<std::int64_t>(val));
+        break;
+
+      case uint_variant:
+        res.bits = std::get<std::uint64_t>(val);
+        break;
+
+      case real_variant:
+        res.bits = std::bit_cast<std::uint64_t>(std::get<double>(val));
+        break;
+
+      case strv_variant:
+        return string_ref(std::get<managed_string_view>(val).view());
+
+      case sequ_variant:
+        return array_ref(std::get<array_value const*>(val)->value());
+    }
+
+    return res;
+  }
+
+  /// stores \p s once per image
+  image_value string_ref(std::string_view s) {
+    auto [pos, fresh] = offsets.emplace(s, strings.size());
+
+    if (fresh) strings.append(s);
+
+    image_value res;
+
+    res.type = strv_variant;
+    res.size = s.size();
+    res.bits = pos->second;
+    return res;
+  }
+
+  /// stores the elements of an array in consecutive records
+  template <class Range>
+  image_value array_ref(const Range& elems) {
+    image_value res;
+    std::size_t pos = values.size();
+
+    res.type = sequ_variant;
+    res.size = std::ranges::size(elems);
+    res.bits = pos;
+
+    // nested arrays are stored after their parent
+    values.resize(pos + res.size);
+
+    for (const value_variant& el : elems) {
+      const image_value rec = value_record(el);
+
+      values[pos++] = rec;
+    }
+
+    return res;
+  }
+
+  std::vector<image_node>                      nodes   = {};
+  std::vector<image_value>                     values  = {};
+  std::vector<std::size_t>                     heights = {};  ///< of the common subexpressions
+  std::string                                  strings = {};
+  std::unordered_map<std::string_view, std::uint64_t> offsets = {};
+};
+
+/// checks the header of an image and reads its records
+struct image_reader {
+  explicit image_reader(std::span<const std::byte> img)
+  : image(img)
+  {
+    if (image.size() < sizeof(image_header))
+      invalid_image();
+
+    std::memcpy(&hdr, image.data(), sizeof(hdr));
+
+    if (hdr.magic != image_magic)
+      invalid_image();
+
+    if ((hdr.version != image_version) || (hdr.byte_order != image_byte_order))
+      throw std::runtime_error("rule image of an incompatible version or byte order");
+
+    check(hdr.nodes, sizeof(image_node));
+    check(hdr.values, sizeof(image_value));
+    check(hdr.strings, sizeof(char));
+    check(hdr.names, sizeof(image_value));
+    check(hdr.uses, sizeof(std::uint32_t));
+    check(hdr.shared, sizeof(std::uint32_t));
+
+    if (hdr.uses.count != hdr.names.count)
+      invalid_image();
+  }
+
+  const image_header& header() const { return hdr; }
+
+  /// returns the record \p idx of section \p sec
+  /// \details
+  ///    records are copied, as an image need not be aligned.
+  template <class T>
+  T record(const image_section& sec, std::uint64_t idx) const {
+    if (idx >= sec.count)
+      invalid_image();
+
+    T res;
+
+    std::memcpy(&res, image.data() + sec.offset + idx * sizeof(T), sizeof(T));
+    return res;
+  }
+
+  /// returns the characters of the string \p rec
+  std::string_view string(const image_value& rec) const {
+    if ((rec.type != strv_variant) || (rec.bits > hdr.strings.count) || (rec.size > hdr.strings.count - rec.bits))
+      invalid_image();
+
+    return std::string_view(reinterpret_cast<const char*>(image.data() + hdr.strings.offset) + rec.bits, rec.size);
+  }
+
+ private:
+  void check(const image_section& sec, std::size_t recsize) const {
+    if ((sec.offset > image.size()) || (sec.count > (image.size() - sec.offset) / recsize))
+      invalid_image();
+  }
+
+  std::span<const std::byte> image;
+  image_header               hdr;
+};
+
+/// creates the nodes of an image
+/// \details
+///   the nodes are created in the active node_arena, if any.
+struct image_loader {
+  explicit image_loader(const image_reader& rd)
+  : image(rd), table(rd.header().shared.count), loading(rd.header().shared.count, false)
+  {}
+
+  std::unique_ptr<logic_data> run() {
+    const image_header& hdr = image.header();
+    std::uint64_t       pos = 0;
+    any_expr            root = load(pos, 0);
+
+    // the records of the root precede those of the common subexpressions
+    if (pos != limit(0))
+      invalid_image();
+
+    // common subexpressions are loaded when they are first referenced
+    for (std::size_t id = 0; id < table.size(); ++id)
+      shared(id, 0);
+
+    std::vector<std::string_view> names;
+    std::vector<std::uint32_t>    uses;
+
+    for (std::uint64_t i = 0; i < hdr.names.count; ++i) {
+      managed_string_view name = literals.string_literal(image.string(image.record<image_value>(hdr.names, i)));
+
+      // the names refer to the strings of var nodes; besides them,
+      //   the pool and name hold a reference.
+      if (name.use_count() <= 2)
+        invalid_image();
+
+      names.push_back(name.view());
+      uses.push_back(image.record<std::uint32_t>(hdr.uses, i));
+    }
+
+    auto data = std::make_unique<logic_data>( std::move(root),
+                                              std::move(names),
+                                              (hdr.flags & image_computed_names) != 0,
+                                              std::move(uses),
+                                              std::move(table)
+                                            );
+
+    assign_junction_profiles(*data);
+    return data;
+  }
+
+ private:
+  /// creates the node at \p pos and its operands
+  /// \param depth the nesting of the node, including the references
+  ///        to common subexpressions that are being loaded
+  /// \post pos refers to the node after the subtree
+  any_expr load(std::uint64_t& pos, std::size_t depth) {
+    if (depth > max_image_depth)
+      invalid_image();
+
+    const image_node rec  = image.record<image_node>(image.header().nodes, pos++);
+    const image_kind kind = image_kind(rec.kind);
+    any_expr         res  = node(kind, rec, depth);
+    oper*            op   = may_down_cast<oper>(*res);
+
+    // each operand takes at least one record
+    if (  (rec.operands > image.header().nodes.count - pos)
+       || ((op == nullptr) && (rec.operands != 0))
+       || ((kind == image_kind::var) && (rec.operands == 0))
+       )
+      invalid_image();
+
+    if (op == nullptr)
+      return res;
+
+    const bool lambda = (  (kind == image_kind::map) || (kind == image_kind::reduce)
+                        || (kind == image_kind::filter) || (kind == image_kind::all)
+                        || (kind == image_kind::none) || (kind == image_kind::some)
+                        );
+    oper::container_type children;
+
+    children.reserve(rec.operands);
+
+    for (std::uint32_t i = 0; i < rec.operands; ++i) {
+      const bool body = lambda && (i == 1);
+
+      if (body)
+        scopes.push_back(kind == image_kind::reduce ? variable_map::reduction_scope
+                                                    : variable_map::sequence_scope);
+
+      children.emplace_back(load(pos, depth + 1));
+
+      if (body) scopes.pop_back();
+    }
+
+    op->set_operands(std::move(children));
+    return res;
+  }
+
+  /// creates a node of kind \p kind without operands
+  any_expr node(image_kind kind, const image_node& rec, std::size_t depth) {
+    switch (kind) {
+      case image_kind::equal:            return any_expr(new equal);
+      case image_kind::strict_equal:     return any_expr(new strict_equal);
+      case image_kind::not_equal:        return any_expr(new not_equal);
+      case image_kind::strict_not_equal: return any_expr(new strict_not_equal);
+      case image_kind::less:             return any_expr(new less);
+      case image_kind::greater:          return any_expr(new greater);
+      case image_kind::less_or_equal:    return any_expr(new less_or_equal);
+      case image_kind::greater_or_equal: return any_expr(new greater_or_equal);
+      case image_kind::logical_and:      return any_expr(new logical_and);
+      case image_kind::logical_or:       return any_expr(new logical_or);
+      case image_kind::logical_not:      return any_expr(new logical_not);
+      case image_kind::logical_not_not:  return any_expr(new logical_not_not);
+      case image_kind::add:              return any_expr(new add);
+      case image_kind::subtract:         return any_expr(new subtract);
+      case image_kind::multiply:         return any_expr(new multiply);
+      case image_kind::divide:           return any_expr(new divide);
+      case image_kind::modulo:           return any_expr(new modulo);
+      case image_kind::min:              return any_expr(new min);
+      case image_kind::max:              return any_expr(new max);
+      case image_kind::map:              return any_expr(new map);
+      case image_kind::reduce:           return any_expr(new reduce);
+      case image_kind::filter:           return any_expr(new filter);
+      case image_kind::all:              return any_expr(new all);
+      case image_kind::none:             return any_expr(new none);
+      case image_kind::some:             return any_expr(new some);
+      case image_kind::array:            return any_expr(new array);
+      case image_kind::merge:            return any_expr(new merge);
+      case image_kind::cat:              return any_expr(new cat);
+      case image_kind::substr:           return any_expr(new substr);
+      case image_kind::membership:       return any_expr(new membership);
+      case image_kind::var:              return variable(rec);
+      case image_kind::missing:          return any_expr(new missing);
+      case image_kind::missing_some:     return any_expr(new missing_some);
+      case image_kind::log:              return any_expr(new log);
+      case image_kind::if_expr:          return any_expr(new if_expr);
+
+      case image_kind::null_value:
+      case image_kind::bool_value:
+      case image_kind::int_value:
+      case image_kind::unsigned_int_value:
+      case image_kind::real_value:
+      case image_kind::string_value:
+      case image_kind::array_value:
+        return value_node(kind, rec.a, depth);
+
+#if WITH_JSON_LOGIC_CPP_EXTENSIONS
+      case image_kind::regex_match:      return any_expr(new regex_match);
+#endif /* WITH_JSON_LOGIC_CPP_EXTENSIONS */
+
+#if ENABLE_OPTIMIZATIONS
+      case image_kind::opt_membership_array:
+        return membership_set(rec, depth);
+
+      case image_kind::common_subexpr:
+        return any_expr(new common_subexpr(rec.a, shared(rec.a, depth + 1)));
+#endif /* ENABLE_OPTIMIZATIONS */
+
+      default:
+        // includes nodes of optimizations and extensions that are
+        //   disabled in this build
+        invalid_image();
+    }
+  }
+
+  any_expr variable(const image_node& rec) {
+    const bool global = (rec.b == var::global_scope);
+
+    // global variables refer to a name or are computed; lambda variables
+    //   refer to a slot of an enclosing lambda
+    if (global) {
+      if ((rec.a != var::computed) && ((rec.a < 0) || (std::uint64_t(rec.a) >= image.header().names.count)))
+        invalid_image();
+    } else if (  (rec.b < 0) || (std::size_t(rec.b) >= scopes.size())
+              || (  (rec.a != var::element_slot)
+                 && ((rec.a != var::accumulator_slot) || (scopes[rec.b] != variable_map::reduction_scope))
+                 )
+              ) {
+      invalid_image();
+    }
+
+    std::unique_ptr<var> res(new var);
+
+    res->num(rec.a);
+    res->scope(rec.b);
+    return any_expr(res.release());
+  }
+
+  any_expr value_node(image_kind kind, std::int32_t idx, std::size_t depth) {
+    if (idx < 0)
+      invalid_image();
+
+    const image_value rec = image.record<image_value>(image.header().values, idx);
+
+    if (int(rec.type) != image_value_type(kind))
+      invalid_image();
+
+    switch (kind) {
+      case image_kind::null_value:         return any_expr(new null_value);
+      case image_kind::bool_value:         return any_expr(new bool_value(rec.bits != 0));
+      case image_kind::int_value:          return any_expr(new int_value(std::bit_cast<std::int64_t>(rec.bits)));
+      case image_kind::unsigned_int_value: return any_expr(new unsigned_int_value(rec.bits));
+      case image_kind::real_value:         return any_expr(new real_value(std::bit_cast<double>(rec.bits)));
+      case image_kind::string_value:       return any_expr(new string_value(literals.string_literal(image.string(rec))));
+      default:                             return any_expr(new array_value(elements(idx, rec, depth + 1)));
+    }
+  }
+
+  /// returns the value of record \p idx
+  value_variant value(std::uint64_t idx, std::size_t depth) {
+    const image_value rec = image.record<image_value>(image.header().values, idx);
+
+    switch (rec.type) {
+      case null_variant: return nullptr;
+      case bool_variant: return rec.bits != 0;
+      case sint_variant: return std::bit_cast<std::int64_t>(rec.bits);
+      case uint_variant: return rec.bits;
+      case real_variant: return std::bit_cast<double>(rec.bits);
+      case strv_variant: return literals.string_literal(image.string(rec));
+      case sequ_variant: return &mk_array_value(elements(idx, rec, depth + 1));
+      default:           invalid_image();
+    }
+  }
+
+  /// returns the elements of the array \p rec, stored at \p idx
+  array_value::container_type elements(std::uint64_t idx, const image_value& rec, std::size_t depth) {
+    const std::uint64_t count = image.header().values.count;
+
+    if (depth > max_image_depth)
+      invalid_image();
+
+    // elements follow their array, which rules out cycles
+    if ((rec.bits <= idx) || (rec.bits > count) || (rec.size > count - rec.bits))
+      invalid_image();
+
+    array_value::container_type res;
+
+    res.reserve(rec.size);
+
+    for (std::uint64_t i = 0; i < rec.size; ++i)
+      res.push_back(value(rec.bits + i, depth));
+
+    return res;
+  }
+
+#if ENABLE_OPTIMIZATIONS
+  any_expr membership_set(const image_node& rec, std::size_t depth) {
+    const std::uint64_t count = image.header().values.count;
+
+    if ((rec.a < 0) || (rec.b < 0) || (std::uint64_t(rec.a) > count) || (std::uint64_t(rec.b) > count - rec.a))
+      invalid_image();
+
+    std::unordered_set<value_variant> elems;
+
+    elems.reserve(rec.b);
+
+    for (std::int32_t i = 0; i < rec.b; ++i)
+      elems.insert(value(rec.a + i, depth + 1));
+
+    std::unique_ptr<opt_membership_array> res(new opt_membership_array);
+
+    res->set_elems(std::move(elems));
+    return any_expr(res.release());
+  }
+#endif /* ENABLE_OPTIMIZATIONS */
+
+  /// returns the first node record after the subtree that precedes
+  ///   common subexpression \p id
+  std::uint64_t limit(std::uint64_t id) const {
+    if (id < table.size())
+      return image.record<std::uint32_t>(image.header().shared, id);
+
+    return image.header().nodes.count;
+  }
+
+  /// returns the common subexpression \p id
+  const expr& shared(std::int64_t id, std::size_t depth) {
+    if ((id < 0) || (std::uint64_t(id) >= table.size()))
+      invalid_image();
+
+    if (!table[id]) {
+      // a subexpression cannot contain itself
+      if (loading[id])
+        invalid_image();
+
+      std::uint64_t pos = image.record<std::uint32_t>(image.header().shared, id);
+
+      loading[id] = true;
+      table[id]   = load(pos, depth);
+
+      // the subexpressions are stored in order of their ids
+      if (pos != limit(id + 1))
+        invalid_image();
+    }
+
+    return *table[id];
+  }
+
+  const image_reader&                     image;
+  variable_map                            literals;  ///< pools the strings of the image
+  std::vector<any_expr>                   table;
+  std::vector<bool>                       loading;
+  std::vector<variable_map::scope_kind>   scopes = {};
+};
+
+std::uint32_t image_flags(const logic_data& data) {
+  return data.has_computed_variable_names() ? std::uint32_t(image_computed_names) : 0;
+}
+
+/// returns an arena for the nodes of \p image, if \p opts asks for one
+std::unique_ptr<node_arena>
+make_arena(const image_reader& image, const logic_options& opts) {
+  // a node and its entry in its parent's operand array; generated
+  //   rules need 40 to 50 bytes per node.
+  constexpr std::size_t bytes_per_node = 52;
+
+  if (!opts.arena)
+    return nullptr;
+
+  return std::make_unique<node_arena>(image.header().nodes.count * bytes_per_node);
+}
+
+} // namespace
+
+std::vector<std::byte> save_image(const logic_rule& rule) {
+  const logic_data& data = rule.internal_data();
+
+  return image_writer{}.run(data, image_flags(data));
+}
+
+std::vector<std::byte> save_image(const rule_set& rules) {
+  const logic_data& data = rules.internal_data();
+
+  return image_writer{}.run(data, image_flags(data) | image_rule_set);
+}
+
+logic_rule load_logic(std::span<const std::byte> image) {
+  return load_logic(image, logic_options{});
+}
+
+logic_rule load_logic(std::span<const std::byte> image, const logic_options& opts) {
+  image_reader reader(image);
+
+  if (reader.header().flags & image_rule_set)
+    throw std::logic_error("the rule image holds a rule_set");
+
+  std::unique_ptr<node_arena>      arena = make_arena(reader, opts);
+  std::optional<node_arena::scope> active;
+
+  if (arena) active.emplace(*arena);
+
+  std::unique_ptr<logic_data> data = image_loader{reader}.run();
+
+  data->arena = std::move(arena);
+  return logic_rule(std::move(data));
+}
+
+rule_set load_rule_set(std::span<const std::byte> image) {
+  return load_rule_set(image, logic_options{});
+}
+
+rule_set load_rule_set(std::span<const std::byte> image, const logic_options& opts) {
+  image_reader reader(image);
+
+  if ((reader.header().flags & image_rule_set) == 0)
+    throw std::logic_error("the rule image holds a single rule");
+
+  std::unique_ptr<node_arena>      arena = make_arena(reader, opts);
+  std::optional<node_arena::scope> active;
+
+  if (arena) active.emplace(*arena);
+
+  std::unique_ptr<logic_data> data = image_loader{reader}.run();
+  const array*                root = may_down_cast<array>(*data->syntax_tree());
+
+  if (root == nullptr)
+    invalid_image();
+
+#if ENABLE_OPTIMIZATIONS
+  data->index = predicate_index_builder{}.run(*root);
+  data->plan  = first_match_planner{}.run(*root);
+#endif /* ENABLE_OPTIMIZATIONS */
+
+  data->arena = std::move(arena);
+  return rule_set(std::move(data));
+}
+
+//
+// rule_cache
+
+namespace {
+
+/// returns true for operators whose two operands can be swapped
+///   without changing the result
+bool commutative_operator(std::string_view op) {
+  return (  (op == "==") || (op == "!=") || (op == "===") || (op == "!==")
+         || (op == "+") || (op == "*")
+         );
+}
+
+/// returns true if \p n contains a log operation
+bool contains_log(const json::value& n) {
+  if (const json::array* arr = n.if_array())
+    return std::ranges::any_of(*arr, contains_log);
+
+  if (const json::object* obj = n.if_object())
+    return std::ranges::any_of(
+               *obj,
+               [](const json::key_value_pair& el) -> bool {
+                 return (el.key() == "log") || contains_log(el.value());
+               }
+             );
+
+  return false;
+}
+
+/// returns the operands of \p obj, if it is a commutative operation
+///   with two operands and \p commutative is set
+/// \details
+///    operands that log are not swapped, since that would change
+///    the order of the log output.
+const json::array* commutative_operands(const json::object& obj, bool commutative) {
+  if (!commutative || (obj.size() != 1) || !commutative_operator(obj.begin()->key()))
+    return nullptr;
+
+  const json::array* args = obj.begin()->value().if_array();
+
+  if (!args || (args->size() != 2) || contains_log((*args)[0]) || contains_log((*args)[1]))
+    return nullptr;
+
+  return args;
+}
+
+/// computes a hash of \p n that does not depend on the order of object keys
+///   and, if \p commutative is set, of the operands of commutative operators
+std::size_t canonical_hash(const json::value& n, bool commutative) {
+  std::size_t res = std::size_t(n.kind());
+
+  switch (n.kind()) {
+    case json::kind::null:
+      break;
+
+    case json::kind::bool_:
+      res = combine(res, n.get_bool());
+      break;
+
+    case json::kind::int64:
+      res = combine(res, std::hash<std::int64_t>{}(n.get_int64()));
+      break;
+
+    case json::kind::uint64:
+      res = combine(res, std::hash<std::uint64_t>{}(n.get_uint64()));
+      break;
+
+    case json::kind::double_:
+      // consistent with canonical_equal, which distinguishes 0.0 and -0.0
+      res = combine(res, std::hash<std::uint64_t>{}(std::bit_cast<std::uint64_t>(n.get_double())));
+      break;
+
+    case json::kind::string:
+      res = combine(res, std::hash<std::string_view>{}(n.get_string()));
+      break;
+
+    case json::kind::array:
+      for (const json::value& el : n.get_array())
+        res = combine(res, canonical_hash(el, commutative));
+      break;
+
+    case json::kind::object: {
+      const json::object& obj = n.get_object();
+
+      if (const json::array* args = commutative_operands(obj, commutative)) {
+        const std::size_t lhs = canonical_hash((*args)[0], commutative);
+        const std::size_t rhs = canonical_hash((*args)[1], commutative);
+
+        res = combine(res, std::hash<std::string_view>{}(obj.begin()->key()));
+        return combine(combine(res, std::min(lhs, rhs)), std::max(lhs, rhs));
+      }
+
+      // the sum does not depend on the order of the keys
+      for (const json::key_value_pair& el : obj)
+        res += combine( std::hash<std::string_view>{}(el.key()),
+                        canonical_hash(el.value(), commutative)
+                      );
+      break;
+    }
+  }
+
+  return res;
+}
+
+/// tests whether \p lhs and \p rhs are equal rules under the
+///   assumptions of canonical_hash
+/// \details
+///   doubles are compared by their bits; 1/0.0 and 1/-0.0 are different rules.
+bool canonical_equal(const json::value& lhs, const json::value& rhs, bool commutative) {
+  if (lhs.kind() != rhs.kind())
+    return false;
+
+  switch (lhs.kind()) {
+    case json::kind::null:    return true;
+    case json::kind::bool_:   return lhs.get_bool() == rhs.get_bool();
+    case json::kind::int64:   return lhs.get_int64() == rhs.get_int64();
+    case json::kind::uint64:  return lhs.get_uint64() == rhs.get_uint64();
+    case json::kind::double_: return (  std::bit_cast<std::uint64_t>(lhs.get_double())
+                                       == std::bit_cast<std::uint64_t>(rhs.get_double())
+                                       );
+    case json::kind::string:  return lhs.get_string() == std::string_view(rhs.get_string());
+
+    case json::kind::array: {
+      const json::array& larr = lhs.get_array();
+      const json::array& rarr = rhs.get_array();
+
+      if (larr.size() != rarr.size())
+        return false;
+
+      for (std::size_t i = 0; i < larr.size(); ++i)
+        if (!canonical_equal(larr[i], rarr[i], commutative))
+          return false;
+
+      return true;
+    }
+
+    case json::kind::object: {
+      const json::object& lobj = lhs.get_object();
+      const json::object& robj = rhs.get_object();
+
+      if (lobj.size() != robj.size())
+        return false;
+
+      const json::array* largs = commutative_operands(lobj, commutative);
+      const json::array* rargs = commutative_operands(robj, commutative);
+
+      if (largs && rargs && (lobj.begin()->key() == robj.begin()->key())) {
+        const json::array& l = *largs;
+        const json::array& r = *rargs;
+
+        return (  (canonical_equal(l[0], r[0], commutative) && canonical_equal(l[1], r[1], commutative))
+               || (canonical_equal(l[0], r[1], commutative) && canonical_equal(l[1], r[0], commutative))
+               );
+      }
+
+      for (const json::key_value_pair& el : lobj) {
+        const json::value* other = robj.if_contains(el.key());
+
+        if (!other || !canonical_equal(el.value(), *other, commutative))
+          return false;
+      }
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace
+
+/// internal state of a rule_cache
+struct rule_cache_data {
+  using compiled_rule = std::shared_future<std::shared_ptr<logic_rule>>;
+
+  struct entry {
+    std::size_t   hash;
+    std::uint64_t serial;    ///< identifies the entry
+    json::value   rule;      ///< the rule as it was first requested
+    compiled_rule compiled;  ///< ready when the rule is compiled
+  };
+
+  /// a part of the cache with its own lock and LRU order
+  struct shard {
+    std::mutex       mutex;
+    std::list<entry> lru = {};  ///< most recently used first
+    std::unordered_multimap<std::size_t, std::list<entry>::iterator> index = {};
+
+    /// returns the entry of \p n, or lru.end()
+    std::list<entry>::iterator find(std::size_t hash, const json::value& n, bool commutative);
+
+    /// removes the entry \p pos
+    void erase(std::list<entry>::iterator pos);
+  };
+
+  rule_cache_data(std::size_t capacity, const rule_cache_options& options)
+  : opts(options),
+    shards(std::max<std::size_t>(options.shards, 1)),
+    shard_capacity(std::max<std::size_t>((capacity + shards.size() - 1) / shards.size(), 1))
+  {}
+
+  shard& shard_of(std::size_t hash) { return shards[hash % shards.size()]; }
+
+  const rule_cache_options   opts;
+  std::deque<shard>          shards;
+  const std::size_t          shard_capacity;
+  std::atomic<std::uint64_t> hits      = 0;
+  std::atomic<std::uint64_t> misses    = 0;
+  std::atomic<std::uint64_t> waits     = 0;
+  std::atomic<std::uint64_t> evictions = 0;
+};
+
+std::list<rule_cache_data::entry>::iterator
+rule_cache_data::shard::find(std::size_t hash, const json::value& n, bool commutative) {
+  auto [beg, lim] = index.equal_range(hash);
+
+  for (; beg != lim; ++beg)
+    if (canonical_equal(beg->second->rule, n, commutative))
+      return beg->second;
+
+  return lru.end();
+}
+
+void rule_cache_data::shard::erase(std::list<entry>::iterator pos) {
+  auto [beg, lim] = index.equal_range(pos->hash);
+
+  while ((beg != lim) && (beg->second != pos)) ++beg;
+
+  assert(beg != lim);
+  index.erase(beg);
+  lru.erase(pos);
+}
+
+rule_cache::rule_cache(std::size_t capacity)
+: rule_cache(capacity, rule_cache_options{})
+{}
+
+rule_cache::rule_cache(std::size_t capacity, const rule_cache_options& opts)
+: data(std::make_unique<rule_cache_data>(capacity, opts))
+{}
+
+rule_cache::rule_cache(rule_cache&&)            = default;
+rule_cache& rule_cache::operator=(rule_cache&&) = default;
+rule_cache::~rule_cache()                       = default;
+
+std::shared_ptr<logic_rule> rule_cache::create_logic(std::string_view text) {
+  return create_logic(json::parse(text));
+}
+
+std::shared_ptr<logic_rule> rule_cache::create_logic(const json::value& n) {
+  const bool                                commutative = data->opts.commutative;
+  const std::size_t                         hash        = canonical_hash(n, commutative);
+  rule_cache_data::shard&                   part        = data->shard_of(hash);
+  rule_cache_data::compiled_rule            compiled;
+  std::uint64_t                             serial      = 0;
+
+  // only a miss compiles the rule and fulfills a promise
+  std::optional<std::promise<std::shared_ptr<logic_rule>>> promise;
+
+  {
+    std::lock_guard<std::mutex> lock(part.mutex);
+
+    if (auto pos = part.find(hash, n, commutative); pos != part.lru.end()) {
+      part.lru.splice(part.lru.begin(), part.lru, pos);
+      compiled = pos->compiled;
+    } else {
+      serial = data->misses++;
+      promise.emplace();
+      part.lru.push_front({hash, serial, n, promise->get_future().share()});
+      part.index.emplace(hash, part.lru.begin());
+
+      // evicted rules remain valid for their holders
+      while (part.lru.size() > data->shard_capacity) {
+        part.erase(std::prev(part.lru.end()));
+        ++data->evictions;
+      }
+    }
+  }
+
+  // a hit waits for a concurrent miss on the same rule
+  if (compiled.valid()) {
+    ++data->hits;
+
+    if (compiled.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      ++data->waits;
+
+    return compiled.get();
+  }
+
+  try {
+    auto rule = std::make_shared<logic_rule>(jsonlogic::create_logic(n, data->opts.logic));
+
+    promise->set_value(rule);
+    return rule;
+  } catch (...) {
+    // waiting requests receive the exception; later requests retry
+    promise->set_exception(std::current_exception());
+
+    std::lock_guard<std::mutex> lock(part.mutex);
+    auto [beg, lim] = part.index.equal_range(hash);
+
+    for (; beg != lim; ++beg) {
+      if (beg->second->serial == serial) {
+        part.erase(beg->second);
+        break;
+      }
+    }
+
+    throw;
+  }
+}
+
+rule_cache_statistics rule_cache::statistics() const {
+  rule_cache_statistics res;
+
+  res.hits      = data->hits;
+  res.misses    = data->misses;
+  res.waits     = data->waits;
+  res.evictions = data->evictions;
+
+  for (rule_cache_data::shard& part : data->shards) {
+    std::lock_guard<std::mutex> lock(part.mutex);
+
+    res.rules += part.lru.size();
+  }
+
+  return res;
+}
+
+void rule_cache::clear() {
+  for (rule_cache_data::shard& part : data->shards) {
+    std::lock_guard<std::mutex> lock(part.mutex);
+
+    part.index.clear();
+    part.lru.clear();
+  }
+}
+
+
+
+//
+// to value_base conversion
+
+any_value to_value(std::nullptr_t) { return nullptr; }
+any_value to_value(bool val) { return val; }
+any_value to_value(std::int64_t val) { return val; }
+any_value to_value(std::uint64_t val) { return val; }
+any_value to_value(double val) { return val; }
+any_value to_value(managed_string_view val) { return val; }
+
+any_value to_value(const json::value &n); // \todo remove after moving to logic.hpp
+
+
+any_value to_value(const json::value &n) {
+  any_value res;
+
+  switch (n.kind()) {
+    case json::kind::string: {
+      const json::string& str = n.get_string(); // \todo this may be unsafe..
+      count_allocations();
+      res = to_value(managed_string_view(&*str.begin(), str.size()));
+      break;
+    }
+
+    case json::kind::int64: {
+      res = to_value(n.get_int64());
+      break;
+    }
+
+    case json::kind::uint64: {
+      res = to_value(n.get_uint64());
+      break;
+    }
+
+    case json::kind::double_: {
+      res = to_value(n.get_double());
+      break;
+    }
+
+    case json::kind::bool_: {
+      res = to_value(n.get_bool());
+      break;
+    }
+
+    case json::kind::null: {
+      res = to_value(nullptr);
+      break;
+    }
+
+    case json::kind::array: {
+      std::vector<value_variant> values;
+      const json::array&         arr = n.get_array();
+
+      for (const json::value& val : arr)
+        values.emplace_back(to_value(val));
+
+      res = &mk_array_value(std::move(values));
+      break;
+    }
+
+    default:
+      unsupported();
+  }
+
+  return res;
+}
+
+
+any_value to_value(const any_expr& n)
+{
+  return down_cast<value_base>(*n).to_variant();
+}
+
+namespace {
+
+//
+// coercion functions
+
+struct internal_coercion_error {};
+struct not_int64_error : internal_coercion_error {};
+struct not_uint64_error : internal_coercion_error {};
+struct unpacked_array_req : internal_coercion_error {};
+
+
+template <class T>
+T from_string(std::string_view str, T el) {
+  auto [ptr, err] = std::from_chars(str.data(), str.data() + str.size(), el);
+
+  if (err != std::errc{}) {
+    CXX_UNLIKELY;
+    throw std::runtime_error{"logic.cc: in to_concrete(string_view, int64_t)"};
+  }
+
+  return el;
+}
+
+/// conversion to int64
+/// \{
+CXX_MAYBE_UNUSED inline std::int64_t to_concrete(std::int64_t v,
+                                                 const std::int64_t &) {
+  return v;
+}
+inline std::int64_t to_concrete(const managed_string_view& str, const std::int64_t &el) {
+  return from_string(str, el);
+}
+inline std::int64_t to_concrete(double v, const std::int64_t &) {
+  return static_cast<std::int64_t>(v);
+}
+inline std::int64_t to_concrete(bool v, const std::int64_t &) {
+  return static_cast<std::int64_t>(v);
+}
+inline std::int64_t to_concrete(std::nullptr_t, const std::int64_t &) {
+  return 0;
 }
 
 inline std::int64_t to_concrete(std::uint64_t v, const std::int64_t &) {
@@ -1210,17 +4194,20 @@ CXX_MAYBE_UNUSED inline double to_concrete(std::nullptr_t, const double &) {
 /// \{
 template <class Val>
 inline managed_string_view to_concrete(Val v, const std::string_view &) {
+  count_allocations();
   return managed_string_view(std::to_string(v));
 }
 inline managed_string_view to_concrete(bool v, const std::string_view &) {
   static constexpr const char* bool_string[] = {"false", "true"};
 
+  count_allocations();
   return managed_string_view(std::string_view(bool_string[v]));
 }
 CXX_MAYBE_UNUSED inline managed_string_view to_concrete(const managed_string_view &s, const std::string_view &) {
   return s;
 }
 inline managed_string_view to_concrete(std::nullptr_t, const std::string_view &) {
+  count_allocations();
   return managed_string_view(std::string_view("null"));
 }
 /// \}
@@ -2476,6 +5463,7 @@ struct operator_impl<cat> : string_operator_non_destructive {
     tmp.append(lhs.begin(), lhs.end());
     tmp.append(rhs.begin(), rhs.end());
 
+    count_allocations();
     return to_value(managed_string_view(std::move(tmp)));
   }
 
@@ -2504,6 +5492,7 @@ struct operator_impl<regex_match>
   using string_operator_non_destructive::result_type;
 
   result_type operator()(const managed_string_view& lhs, const managed_string_view& rhs) const {
+    count_allocations();
     std::regex rgx(lhs.c_str(), lhs.size());
 
     return to_value(std::regex_search(rhs.begin(), rhs.end(), rgx));
@@ -2527,11 +5516,27 @@ struct operator_impl<merge> : array_operator {
   }
 };
 
-using variant_logger = std::function<void(const value_variant&)>;
+/// reads the cycle counter; falls back to a steady clock on
+///   platforms without an accessible cycle counter.
+inline std::uint64_t cycle_count() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/// names the unit of cycle_count in profile reports
+constexpr const char* CYCLE_COUNTER_UNIT =
+#if defined(__x86_64__) || defined(__i386__)
+    "tsc";
+#else
+    "steady_clock";
+#endif
 
 struct evaluator : forwarding_visitor {
-  evaluator(variable_accessor varAccess, variant_logger& out)
-      : vars(std::move(varAccess)), logger(out), calcres(nullptr) {}
+  explicit evaluator(evaluation_context_data& context)
+      : ctx(context), frames(context.frames), calcres(nullptr) {}
 
   void visit(const equal &) final;
   void visit(const strict_equal &) final;
@@ -2580,18 +5585,43 @@ struct evaluator : forwarding_visitor {
 
   void visit(const error &) final;
 
+  void visit(const interned_expr &) final;
+
 #if WITH_JSON_LOGIC_CPP_EXTENSIONS
   void visit(const regex_match &) final;
 #endif /* WITH_JSON_LOGIC_CPP_EXTENSIONS */
 #if ENABLE_OPTIMIZATIONS
   void visit(const opt_membership_array &) final;
+  void visit(const common_subexpr &) final;
 #endif /* ENABLE_OPTIMIZATIONS */
 
   any_value eval(const expr &);
 
+  /// evaluates \p n and records its statistics in \p prof
+  any_value eval_profiled(const expr &n, evaluation_profile &prof);
+
+  /// evaluates the lambda body \p e with \p elem (and \p accu) bound
+  ///   to the innermost lambda frame.
+  any_value eval_lambda(const expr &e, const any_value &elem,
+                        const any_value *accu = nullptr);
+
+  using lambda_frame = evaluation_context_data::lambda_frame;
+
+  /// opens a lambda frame for the lifetime of the object
+  struct frame_guard {
+    explicit frame_guard(evaluator &ev) : calc(ev) { calc.frames.emplace_back(); }
+    ~frame_guard() { calc.frames.pop_back(); }
+
+    frame_guard(const frame_guard &) = delete;
+    frame_guard &operator=(const frame_guard &) = delete;
+
+   private:
+    evaluator &calc;
+  };
+
  private:
-  variable_accessor vars;
-  variant_logger& logger;
+  evaluation_context_data& ctx;
+  std::vector<lambda_frame>& frames;
   any_value calcres;
 
   evaluator(const evaluator &) = delete;
@@ -2599,6 +5629,18 @@ struct evaluator : forwarding_visitor {
   evaluator &operator=(const evaluator &) = delete;
   evaluator &operator=(evaluator &&) = delete;
 
+  /// resolves a variable by name or index
+  /// \details
+  ///   names that are not bound at compile time are looked up in the
+  ///   lambda frames first ("", "current", "accumulator"), before
+  ///   they are resolved through the variable slots or the
+  ///   variable accessor of the evaluation context.
+  any_value lookup(const any_value &key, int idx);
+
+  /// resolves the non-computed variable \p n with index \p idx
+  ///   at most once per evaluation.
+  const any_value& memoized_slot(const var &n, int idx);
+
   //
   // opers
 
@@ -2611,6 +5653,15 @@ struct evaluator : forwarding_visitor {
   ///   or the last expression otherwise
   void eval_short_circuit(const oper &n, bool val);
 
+  /// evaluates and/or, in adaptive order if a profile is available
+  void eval_junction(const junction &n, bool val);
+
+#if ENABLE_OPTIMIZATIONS
+  /// evaluates the operands of \p n in the order given by \p prof,
+  ///   but returns the same value as eval_short_circuit.
+  void eval_adaptive(const junction &n, bool val, junction_profile &prof);
+#endif /* ENABLE_OPTIMIZATIONS */
+
   /// reduction operation on all elements
   template <class binary_op_t>
   void reduce_sequence(const oper &n, binary_op_t op);
@@ -2638,26 +5689,16 @@ struct evaluator : forwarding_visitor {
 };
 
 struct sequence_function {
-  sequence_function(const expr &e, variant_logger &logstream)
-      : exp(e), logger(logstream) {}
+  sequence_function(const expr &e, evaluator &ev)
+      : exp(e), calc(ev) {}
 
   any_value operator()(const any_value &elem) const {
-    evaluator sub{[&elem](value_variant keyval, int) -> any_value {
-                    if (managed_string_view* pkey = std::get_if<managed_string_view>(&keyval)) {
-                      if (pkey->size() == 0)
-                        return elem;
-                    }
-
-                    return nullptr;
-                  },
-                  logger};
-
-    return sub.eval(exp);
+    return calc.eval_lambda(exp, elem);
   }
 
  private:
   const expr &exp;
-  variant_logger& logger;
+  evaluator& calc;
 };
 
 struct sequence_predicate : sequence_function {
@@ -2670,26 +5711,16 @@ struct sequence_predicate : sequence_function {
 
 
 struct sequence_reduction {
-  sequence_reduction(expr &e, variant_logger& logstream)
-      : exp(e), logger(logstream) {}
-
-  any_value operator()(any_value accu, any_value elem) const {
-    evaluator sub{[&accu, &elem](value_variant keyval, int) -> any_value {
-                    if (const managed_string_view *pkey = std::get_if<managed_string_view>(&keyval)) {
-                      CXX_LIKELY;
-                      if (*pkey == "current") return elem;
-                      if (*pkey == "accumulator") return accu;
-                    }
-                    return to_value(nullptr);
-                  },
-                  logger};
+  sequence_reduction(const expr &e, evaluator &ev)
+      : exp(e), calc(ev) {}
 
-    return sub.eval(exp);
+  any_value operator()(const any_value &accu, const any_value &elem) const {
+    return calc.eval_lambda(exp, elem, &accu);
   }
 
  private:
-  expr &exp;
-  variant_logger& logger;
+  const expr &exp;
+  evaluator& calc;
 };
 
 std::int64_t evaluator::unpack_optional_int_arg(const oper &n, int argpos,
@@ -2751,60 +5782,271 @@ void evaluator::reduce_sequence(const oper &n, binary_op_t op) {
     res = std::move(tmp2);
   }
 
-  calcres = std::move(res);
-}
+  calcres = std::move(res);
+}
+
+template <class binary_predicate_t>
+void evaluator::eval_pair_short_circuit(const oper &n,
+                                        binary_predicate_t pred) {
+  const int num = n.num_evaluated_operands();
+  assert(num >= 2);
+
+  bool res = true;
+  int idx = -1;
+  any_value rhs = eval(n.operand(++idx));
+
+  while (res && (idx != (num - 1))) {
+    any_value lhs = std::move(rhs);
+
+    rhs = eval(n.operand(++idx));
+    res = compute(lhs, rhs, pred);
+  }
+
+  calcres = res;
+}
+
+void evaluator::eval_short_circuit(const oper &n, bool val) {
+  const int num = n.num_evaluated_operands();
+
+  if (num == 0) {
+    CXX_UNLIKELY;
+    throw_type_error();
+  }
+
+  int idx = -1;
+  any_value tmpval = eval(n.operand(++idx));
+  //~ std::cerr << idx << ") " << oper << std::endl;
+
+  bool found = (idx == num - 1) || (truthy(tmpval) == val);
+
+  // loop until *aa == val or when *aa is the last valid element
+  while (!found) {
+    tmpval = eval(n.operand(++idx));
+
+    found = (idx == (num - 1)) || (truthy(tmpval) == val);
+  }
+
+  calcres = std::move(tmpval);
+}
+
+void evaluator::eval_junction(const junction &n, bool val) {
+#if ENABLE_OPTIMIZATIONS
+  if (ctx.profiles && (n.profile() != junction::no_profile)) {
+    CXX_UNLIKELY;
+    eval_adaptive(n, val, ctx.profiles[n.profile()]);
+    return;
+  }
+#endif /* ENABLE_OPTIMIZATIONS */
+
+  eval_short_circuit(n, val);
+}
+
+#if ENABLE_OPTIMIZATIONS
+
+namespace {
+
+/// number of evaluations of a junction before its operands are reordered
+constexpr std::uint32_t JUNCTION_REORDER_INTERVAL = 256;
+
+/// computes a new evaluation order from the observed operand statistics
+/// \details
+///   sorts operands by expected cost per decision (cost / probability
+///   of deciding the junction) and halves the statistics so that the
+///   order follows changes in the data.
+void reorder_operands(junction_profile &prof) {
+  using operand_stats = junction_profile::operand_stats;
+
+  auto rank = [&prof](int pos) -> double {
+                const operand_stats& st = prof.operands[pos];
+                const double cost = double(st.cost + 1) / double(st.evaluations + 1);
+                const double prob = double(st.decisions + 1) / double(st.evaluations + 2);
+
+                return cost / prob;
+              };
+
+  std::vector<double> ranks(prof.operands.size());
+
+  for (std::size_t i = 0; i < ranks.size(); ++i)
+    ranks[i] = rank(i);
+
+  std::stable_sort( prof.order.begin(), prof.order.end(),
+                    [&ranks](int lhs, int rhs) -> bool { return ranks[lhs] < ranks[rhs]; }
+                  );
+
+  for (operand_stats& st : prof.operands) {
+    st.evaluations /= 2;
+    st.decisions   /= 2;
+    st.cost        /= 2;
+  }
+
+  prof.evaluations = 0;
+}
+
+} // namespace
+
+void evaluator::eval_adaptive(const junction &n, bool val, junction_profile &prof) {
+  using clock = std::chrono::steady_clock;
+
+  const int num = n.num_evaluated_operands();
+
+  assert(std::size_t(num) == prof.order.size() && num <= 64);
+
+  // evaluates operand pos and records its statistics
+  auto evalop = [this, &n, &prof](int pos) -> any_value {
+                  junction_profile::operand_stats& st = prof.operands[pos];
+                  const clock::time_point start = clock::now();
+                  any_value res = eval(n.operand(pos));
+
+                  st.cost += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+                  ++st.evaluations;
+                  return res;
+                };
+
+  try {
+    std::uint64_t done = 0;
+    any_value     last;
+    bool          decided = false;
+
+    for (int pos : prof.order) {
+      any_value tmpval = evalop(pos);
+
+      done |= (std::uint64_t(1) << pos);
+
+      if (truthy(tmpval) == val) {
+        ++prof.operands[pos].decisions;
+
+        // the result is the first deciding operand in source order
+        for (int prev = 0; !decided && (prev < pos); ++prev) {
+          if (done & (std::uint64_t(1) << prev))
+            continue;
+
+          if (any_value prevval = evalop(prev); truthy(prevval) == val) {
+            ++prof.operands[prev].decisions;
+            tmpval  = std::move(prevval);
+            decided = true;
+          }
+        }
+
+        calcres = std::move(tmpval);
+        decided = true;
+        break;
+      }
+
+      if (pos == num - 1)
+        last = std::move(tmpval);
+    }
+
+    if (!decided)
+      calcres = std::move(last);
+  } catch (...) {
+    // an operand evaluated out of order may throw where source order
+    //   would have short-circuited.
+    eval_short_circuit(n, val);
+  }
+
+  if (++prof.evaluations == JUNCTION_REORDER_INTERVAL)
+    reorder_operands(prof);
+}
+
+#endif /* ENABLE_OPTIMIZATIONS */
+
+any_value evaluator::eval(const expr &n) {
+  if (ctx.profile) {
+    CXX_UNLIKELY;
+    return eval_profiled(n, *ctx.profile);
+  }
+
+  any_value res;
+
+  n.accept(*this);
+  res.swap(calcres);
+
+  return res;
+}
+
+any_value evaluator::eval_profiled(const expr &n, evaluation_profile &prof) {
+  const std::uint32_t parent = prof.current;
+  const std::uint32_t self   = prof.entry(parent, n);
+  const std::uint64_t allocs = value_allocations;
+  const std::uint64_t start  = cycle_count();
+
+  // entries may be added by nested evaluations; refer to them by index only
+  auto record = [&prof, self, parent, allocs, start]() -> node_profile& {
+                  node_profile& stats = prof.entries[self];
+
+                  stats.cycles      += cycle_count() - start;
+                  stats.allocations += value_allocations - allocs;
+                  ++stats.evaluations;
+                  prof.current = parent;
+                  return stats;
+                };
+
+  any_value res;
 
-template <class binary_predicate_t>
-void evaluator::eval_pair_short_circuit(const oper &n,
-                                        binary_predicate_t pred) {
-  const int num = n.num_evaluated_operands();
-  assert(num >= 2);
+  prof.current = self;
 
-  bool res = true;
-  int idx = -1;
-  any_value rhs = eval(n.operand(++idx));
+  try {
+    n.accept(*this);
+    res.swap(calcres);
+  } catch (...) {
+    record();
+    throw;
+  }
 
-  while (res && (idx != (num - 1))) {
-    any_value lhs = std::move(rhs);
+  node_profile& stats = record();
 
-    rhs = eval(n.operand(++idx));
-    res = compute(lhs, rhs, pred);
+  if (res.index() != mono_variant) {
+    if (truthy(res))
+      ++stats.truthy;
+    else
+      ++stats.falsy;
   }
 
-  calcres = res;
+  return res;
 }
 
-void evaluator::eval_short_circuit(const oper &n, bool val) {
-  const int num = n.num_evaluated_operands();
+any_value evaluator::eval_lambda(const expr &e, const any_value &elem,
+                                 const any_value *accu) {
+  assert(!frames.empty());
 
-  if (num == 0) {
-    CXX_UNLIKELY;
-    throw_type_error();
-  }
+  lambda_frame &frame = frames.back();
 
-  int idx = -1;
-  any_value tmpval = eval(n.operand(++idx));
-  //~ std::cerr << idx << ") " << oper << std::endl;
+  frame[var::element_slot]     = &elem;
+  frame[var::accumulator_slot] = accu;
 
-  bool found = (idx == num - 1) || (truthy(tmpval) == val);
+  return eval(e);
+}
 
-  // loop until *aa == val or when *aa is the last valid element
-  while (!found) {
-    tmpval = eval(n.operand(++idx));
+any_value evaluator::lookup(const any_value &key, int idx) {
+  if (!frames.empty()) {
+    if (const managed_string_view *pkey = std::get_if<managed_string_view>(&key)) {
+      if (pkey->size() == 0)
+        return deref(frames.back()[var::element_slot]);
 
-    found = (idx == (num - 1)) || (truthy(tmpval) == val);
-  }
+      const bool current = (*pkey == "current");
 
-  calcres = std::move(tmpval);
-}
+      if (current || (*pkey == "accumulator")) {
+        auto bound = [](const lambda_frame &f) -> bool {
+                       return f[var::accumulator_slot] != nullptr;
+                     };
 
-any_value evaluator::eval(const expr &n) {
-  any_value res;
+        if (auto pos = std::find_if(frames.rbegin(), frames.rend(), bound); pos != frames.rend())
+          return deref((*pos)[current ? var::element_slot : var::accumulator_slot]);
+      }
+    }
+  }
 
-  n.accept(*this);
-  res.swap(calcres);
+  if ((idx >= 0) && (std::size_t(idx) < ctx.slots.size())) {
+    CXX_LIKELY;
+    return ctx.slots[idx];
+  }
 
-  return res;
+  if (ctx.resolver == nullptr) {
+    CXX_UNLIKELY;
+    throw std::logic_error{"unable to access (computed) variable"};
+  }
+
+  return (*ctx.resolver)(key, idx);
 }
 
 void evaluator::visit(const equal &n) {
@@ -2839,9 +6081,9 @@ void evaluator::visit(const greater_or_equal &n) {
   eval_pair_short_circuit(n, operator_impl<greater_or_equal>{});
 }
 
-void evaluator::visit(const logical_and &n) { eval_short_circuit(n, false); }
+void evaluator::visit(const logical_and &n) { eval_junction(n, false); }
 
-void evaluator::visit(const logical_or &n) { eval_short_circuit(n, true); }
+void evaluator::visit(const logical_or &n) { eval_junction(n, true); }
 
 void evaluator::visit(const logical_not &n) {
   unary(n, operator_impl<logical_not>{});
@@ -2917,6 +6159,19 @@ void evaluator::visit(const opt_membership_array &n) {
   
   calcres = n.elems().count(lhs) > 0;
 }
+
+void evaluator::visit(const common_subexpr &n) {
+  const int idx = n.id();
+
+  assert((idx >= 0) && (std::size_t(idx) < ctx.shared_cache.size()));
+
+  if (ctx.shared_epoch[idx] != ctx.epoch) {
+    ctx.shared_cache[idx] = eval(n.shared());
+    ctx.shared_epoch[idx] = ctx.epoch;
+  }
+
+  calcres = ctx.shared_cache[idx];
+}
 #endif /*ENABLE_OPTIMIZATIONS*/
 
 void evaluator::visit(const substr &n) {
@@ -2961,12 +6216,14 @@ void evaluator::visit(const reduce &n) {
   expr &expr = n.operand(1);
   any_value accu = eval(n.operand(2));
 
-  auto op = [&expr, accu, calclogger = &this->logger]
+  auto op = [&expr, &accu, calc = this]
             (array_value const* v) -> any_value {
     variant_span spn = element_range(v);
+    frame_guard  scope{*calc};
+
     return std::accumulate( spn.begin(), spn.end(),
                             std::move(accu),
-                            sequence_reduction{expr, *calclogger}
+                            sequence_reduction{expr, *calc}
                           );
   };
 
@@ -2980,17 +6237,18 @@ empty_array_value() { return &mk_array_value(); }
 
 void evaluator::visit(const map &n) {
   any_value arr = eval(n.operand(0));
-  auto mapper = [&n, &arr, calclogger = &this->logger]
+  auto mapper = [&n, calc = this]
                  (array_value const* v) -> array_value const* {
     variant_span spn = element_range(v);
     expr &expr = n.operand(1);
+    frame_guard scope{*calc};
     std::vector<any_value> mapped_elements;
 
     mapped_elements.reserve(spn.size());
 
     std::transform(spn.begin(), spn.end(),
                    std::back_inserter(mapped_elements),
-                   sequence_function{expr, *calclogger});
+                   sequence_function{expr, *calc});
 
     return &mk_array_value(std::move(mapped_elements));
   };
@@ -3000,16 +6258,17 @@ void evaluator::visit(const map &n) {
 
 void evaluator::visit(const filter &n) {
   any_value arr = eval(n.operand(0));
-  auto filter = [&n, &arr, calclogger = &this->logger]
+  auto filter = [&n, calc = this]
                 (array_value const* v) -> array_value const* {
     variant_span spn = element_range(v);
     expr &expr = n.operand(1);
+    frame_guard scope{*calc};
     std::vector<any_value> filtered_elements;
 
     // non destructive predicate is required for evaluating and copying
     std::copy_if(spn.begin(), spn.end(),
                  std::back_inserter(filtered_elements),
-                 sequence_predicate{expr, *calclogger});
+                 sequence_predicate{expr, *calc});
 
     return &mk_array_value(std::move(filtered_elements));
   };
@@ -3020,13 +6279,14 @@ void evaluator::visit(const filter &n) {
 void evaluator::visit(const all &n) {
   any_value arr = eval(n.operand(0));
 
-  auto all_of = [&n, &arr, calclogger = &this->logger]
+  auto all_of = [&n, calc = this]
                 (array_value const* v) -> bool {
     variant_span spn = element_range(v);
     expr &expr = n.operand(1);
+    frame_guard scope{*calc};
 
     return std::all_of( spn.begin(), spn.end(),
-                        sequence_predicate{expr, *calclogger}
+                        sequence_predicate{expr, *calc}
                       );
   };
 
@@ -3038,13 +6298,14 @@ void evaluator::visit(const all &n) {
 void evaluator::visit(const none &n) {
   any_value arr = eval(n.operand(0));
 
-  auto none_of = [&n, &arr, calclogger = &this->logger]
+  auto none_of = [&n, calc = this]
                  (array_value const* v) -> bool {
     variant_span spn = element_range(v);
     expr &expr = n.operand(1);
+    frame_guard scope{*calc};
 
     return std::none_of( spn.begin(), spn.end(),
-                         sequence_predicate{expr, *calclogger}
+                         sequence_predicate{expr, *calc}
                        );
   };
 
@@ -3056,13 +6317,14 @@ void evaluator::visit(const none &n) {
 void evaluator::visit(const some &n) {
   any_value arr = eval(n.operand(0));
 
-  auto any_of = [&n, &arr, calclogger = &this->logger]
+  auto any_of = [&n, calc = this]
                 (array_value const* v) -> bool {
     variant_span spn = element_range(v);
     expr &expr = n.operand(1);
+    frame_guard scope{*calc};
 
     return std::any_of( spn.begin(), spn.end(),
-                        sequence_predicate{expr, *calclogger}
+                        sequence_predicate{expr, *calc}
                       );
   };
 
@@ -3073,13 +6335,72 @@ void evaluator::visit(const some &n) {
 
 void evaluator::visit(const error &) { unsupported(); }
 
+void evaluator::visit(const interned_expr &n) { calcres = eval(n.shared()); }
+
+const any_value& evaluator::memoized_slot(const var &n, int idx) {
+  assert((idx >= 0) && (std::size_t(idx) < ctx.slot_cache.size()));
+
+  any_value& cached = ctx.slot_cache[idx];
+
+  if (ctx.slot_epoch[idx] != ctx.epoch) {
+    // counts requests that throw as well
+    ++ctx.stats.slots_demanded;
+
+    // an unavailable variable is memoized as mono value,
+    //   so that it is not requested again.
+    try {
+      cached = (ctx.resolver && ctx.resolver->resolves_slots())
+                  ? (*ctx.resolver)(idx)
+                  : lookup(eval(n.operand(0)), idx);
+    } catch (const variable_resolution_error &) {
+      cached = any_value{};
+    }
+
+    ctx.slot_epoch[idx] = ctx.epoch;
+  }
+
+  if (cached.index() == mono_variant) {
+    CXX_UNLIKELY;
+    throw variable_resolution_error{"variable is not available"};
+  }
+
+  return cached;
+}
+
 void evaluator::visit(const var &n) {
   assert(n.num_evaluated_operands() >= 1);
 
-  any_value elm = eval(n.operand(0));
+  if (n.scope() != var::global_scope) {
+    assert(std::size_t(n.scope()) < frames.size());
+
+    calcres = deref(frames[n.scope()][n.num()]);
+    return;
+  }
 
   try {
-    calcres = vars(elm, n.num());
+    const int idx = n.num();
+
+    // non-computed names are resolved without materializing the key
+    if (idx >= 0) {
+      CXX_LIKELY;
+      if (std::size_t(idx) < ctx.slots.size()) {
+        CXX_LIKELY;
+        calcres = ctx.slots[idx];
+        return;
+      }
+
+      if (ctx.memoize_slots || ((std::size_t(idx) < ctx.slot_uses.size()) && (ctx.slot_uses[idx] > 1))) {
+        calcres = memoized_slot(n, idx);
+        return;
+      }
+
+      if (ctx.resolver && ctx.resolver->resolves_slots()) {
+        calcres = (*ctx.resolver)(idx);
+        return;
+      }
+    }
+
+    calcres = lookup(eval(n.operand(0)), idx);
   } catch (const variable_resolution_error &) {
     calcres = (n.num_evaluated_operands() > 1) ? eval(n.operand(1))
                                                : to_value(nullptr);
@@ -3107,7 +6428,7 @@ evaluator::missing_aux(const oper& n, std::size_t arrpos) {
 
   auto notavail = [calc = this](const any_value &val) -> bool {
     try {
-      any_value res = calc->vars(val, COMPUTED_VARIABLE_NAME);
+      any_value res = calc->lookup(val, COMPUTED_VARIABLE_NAME);
 
       return null_equivalent(res);
     } catch (const jsonlogic::variable_resolution_error &) {
@@ -3115,119 +6436,496 @@ evaluator::missing_aux(const oper& n, std::size_t arrpos) {
     }
   };
 
-  std::vector<value_variant> res;
+  std::vector<value_variant> res;
+
+  std::copy_if( std::make_move_iterator(elems.begin()), std::make_move_iterator(elems.end()),
+                std::back_inserter(res),
+                notavail
+              );
+
+  return { std::move(res),
+           elems.size() - res.size()
+         };
+}
+
+void evaluator::visit(const missing &n) {
+  std::vector<value_variant> res;
+
+  std::tie(res, std::ignore) = missing_aux(n, 0);
+
+  calcres = &mk_array_value(std::move(res));
+}
+
+void evaluator::visit(const missing_some &n) {
+  const std::uint64_t minreq = unpack_value<std::uint64_t>(eval(n.operand(0)));
+
+  auto [res, avail] = missing_aux(n, 1);
+
+  if (avail >= minreq)
+    res.clear();
+
+  calcres = &mk_array_value(std::move(res));
+}
+
+void evaluator::visit(const if_expr &n) {
+  const int num = n.num_evaluated_operands();
+
+  if (num == 0) {
+    calcres = to_value(nullptr);
+    return;
+  }
+
+  const int lim = num - 1;
+  int pos = 0;
+
+  while (pos < lim) {
+    if (truthy(eval(n.operand(pos)))) {
+      calcres = eval(n.operand(pos + 1));
+      return;
+    }
+
+    pos += 2;
+  }
+
+  calcres = (pos < num) ? eval(n.operand(pos)) : to_value(nullptr);
+}
+
+void evaluator::visit(const log &n) {
+  assert(n.num_evaluated_operands() == 1);
+
+  calcres = eval(n.operand(0));
+
+  ctx.logger(calcres);
+}
+
+void evaluator::visit(const array_value &n) {
+  count_allocations();
+  calcres = new array_value(n);
+}
+
+void evaluator::visit(const null_value &n) { _value(n); }
+void evaluator::visit(const bool_value &n) { _value(n); }
+void evaluator::visit(const int_value &n) { _value(n); }
+void evaluator::visit(const unsigned_int_value &n) { _value(n); }
+void evaluator::visit(const real_value &n) { _value(n); }
+void evaluator::visit(const string_value &n) { _value(n); }
+
+any_value eval_path(const managed_string_view& path, const json::object *obj) {
+  if (obj) {
+    if (auto pos = obj->find(path); pos != obj->end())
+      return jsonlogic::to_value(pos->value());
+
+    if (std::size_t pos = path.find('.'); pos != json::string::npos) {
+      managed_string_view selector = path.substr(0, pos);
+      managed_string_view suffix   = path.substr(pos + 1);
+
+      return eval_path(suffix, obj->at(selector).if_object());
+    }
+  }
+
+  throw variable_resolution_error{"in logic.cc::eval_path."};
+}
+
+template <class IntT>
+any_value eval_index(IntT idx, const json::array &arr) {
+  return jsonlogic::to_value(arr[idx]);
+}
+
+
+/// binds the variable access state to an evaluation context
+///   for the duration of an evaluation.
+struct context_binding {
+  context_binding( logic_data& rule,
+                   evaluation_context_data& context,
+                   const variable_resolver* resolver,
+                   std::span<const value_variant> slots
+                 )
+  : ctx(context)
+  {
+    if (ctx.in_use) {
+      CXX_UNLIKELY;
+      throw std::logic_error{"evaluation_context is already in use"};
+    }
+
+    ctx.in_use   = true;
+    ctx.resolver = resolver;
+    ctx.slots    = slots;
+
+    if (const std::size_t numshared = rule.common_subexpressions().size();
+        ctx.shared_cache.size() < numshared) {
+      ctx.shared_cache.resize(numshared);
+      ctx.shared_epoch.resize(numshared, 0);
+    }
+
+#if ENABLE_OPTIMIZATIONS
+    if (rule.adaptive_ordering && !rule.junction_profiles.empty())
+      ctx.profiles = rule.junction_profiles.data();
+#endif /* ENABLE_OPTIMIZATIONS */
+
+    if (rule.profile) {
+      CXX_UNLIKELY;
+      ctx.profile          = rule.profile.get();
+      ctx.profile->current = 0;
+    }
+
+    next_evaluation();
+  }
+
+  /// invalidates all memoized values
+  void next_evaluation() {
+    if (++ctx.epoch == 0) {
+      CXX_UNLIKELY;
+      std::fill(ctx.slot_epoch.begin(), ctx.slot_epoch.end(), 0);
+      std::fill(ctx.shared_epoch.begin(), ctx.shared_epoch.end(), 0);
+      ctx.epoch = 1;
+    }
+  }
+
+  /// turns on memoization for the variables with more than one use
+  void memoize(std::span<const std::uint32_t> uses) {
+    memoize(uses.size());
+    ctx.slot_uses = uses;
+  }
+
+  /// prepares the slot cache for \p numslots non-computed variables
+  void memoize(std::size_t numslots) {
+    if (ctx.slot_cache.size() < numslots) {
+      ctx.slot_cache.resize(numslots);
+      ctx.slot_epoch.resize(numslots, 0);
+    }
+
+    ++ctx.stats.evaluations;
+    ctx.stats.slots += numslots;
+  }
+
+  ~context_binding() {
+    ctx.profile       = nullptr;
+    ctx.profiles      = nullptr;
+    ctx.memoize_slots = false;
+    ctx.slot_uses     = {};
+    ctx.frames.clear();
+    ctx.slots    = {};
+    ctx.resolver = nullptr;
+    ctx.in_use   = false;
+  }
+
+ private:
+  evaluation_context_data& ctx;
+
+  context_binding(const context_binding&)            = delete;
+  context_binding& operator=(const context_binding&) = delete;
+};
+
+any_value apply( logic_data& rule,
+                 evaluation_context_data& ctx,
+                 const variable_resolver* vars,
+                 std::span<const value_variant> slots
+               ) {
+  assert(rule.syntax_tree().get());
+
+  context_binding binding{rule, ctx, vars, slots};
+  evaluator       ev{ctx};
+
+  // values from an accessor are memoized if a variable is read repeatedly
+  if (vars && rule.has_repeated_variables())
+    binding.memoize(rule.variable_uses());
+
+  return ev.eval(*rule.syntax_tree());
+}
+
+any_value apply_lazy( logic_data& rule,
+                      evaluation_context_data& ctx,
+                      const variable_resolver& provider
+                    ) {
+  assert(rule.syntax_tree().get());
+
+  context_binding binding{rule, ctx, &provider, {}};
+  evaluator       ev{ctx};
+
+  binding.memoize(rule.variable_names().size());
+  ctx.memoize_slots = true;
+  return ev.eval(*rule.syntax_tree());
+}
+
+/// returns the rules of a rule set
+const array& rule_array(const logic_data& rules) {
+  return down_cast<array>(*rules.syntax_tree());
+}
+
+/// evaluates each rule of the rule set \p rules and passes the
+///   result of the i-th rule to \p fn(i, result).
+/// \details
+///   all rules are evaluated within one evaluation, so that variables
+///   and common subexpressions are computed once for all rules.
+template <class Fn>
+void apply_each( logic_data& rules,
+                 evaluation_context_data& ctx,
+                 const variable_resolver* vars,
+                 std::span<const value_variant> slots,
+                 Fn fn
+               ) {
+  assert(rules.syntax_tree().get());
+
+  context_binding binding{rules, ctx, vars, slots};
+  evaluator       ev{ctx};
+
+  if (vars && rules.has_repeated_variables())
+    binding.memoize(rules.variable_uses());
+
+  std::size_t i = 0;
+
+  for (const any_expr& rule : rule_array(rules))
+    fn(i++, ev.eval(*rule));
+}
+
+/// returns true if \p num lies within \p range
+bool contains(const predicate_index::interval& range, double num) {
+  return (range.lo_open ? (range.lo < num) : (range.lo <= num))
+      && (range.hi_open ? (num < range.hi) : (num <= range.hi));
+}
+
+/// appends the rules with a range in [beg, lim) that contains \p num
+void select_ranges( const predicate_index::variable_conditions& conds,
+                    double num, std::size_t beg, std::size_t lim,
+                    std::vector<std::uint32_t>& selected
+                  ) {
+  if (beg >= lim)
+    return;
+
+  const std::size_t mid = beg + (lim - beg) / 2;
+
+  if (conds.maxhi[mid] < num)
+    return;
+
+  select_ranges(conds, num, beg, mid, selected);
+
+  const predicate_index::interval& range = conds.ranges[mid];
+
+  // the ranges in (mid, lim) start at or after range.lo
+  if (num < range.lo)
+    return;
+
+  if (contains(range, num))
+    selected.push_back(range.rule);
+
+  select_ranges(conds, num, mid + 1, lim, selected);
+}
+
+/// appends the rules whose condition in \p conds may hold for \p val
+void select_rules( const predicate_index::variable_conditions& conds,
+                   const value_variant& val,
+                   std::vector<std::uint32_t>& selected
+                 ) {
+  auto append = [&selected](const std::vector<std::uint32_t>& ids) -> void {
+                  selected.insert(selected.end(), ids.begin(), ids.end());
+                };
+
+  if (auto pos = conds.equal.find(val); pos != conds.equal.end())
+    append(pos->second);
+
+  // equality with a value of another type requires a conversion
+  for (const auto& [type, ids] : conds.typed)
+    if (type != val.index())
+      append(ids);
+
+  if (conds.ranges.empty())
+    return;
+
+  if (const std::optional<double> num = exact_number(val)) {
+    select_ranges(conds, *num, 0, conds.ranges.size(), selected);
+    return;
+  }
+
+  // comparisons with non-numbers require a conversion
+  for (const predicate_index::interval& range : conds.ranges)
+    selected.push_back(range.rule);
+}
+
+/// evaluates the rules of the rule set \p rules that the predicate
+///   index selects and passes the result of the i-th rule to \p fn(i, result).
+/// \details
+///   the rules are evaluated in order. Without index, all rules are evaluated.
+template <class Fn>
+void apply_selected( logic_data& rules,
+                     evaluation_context_data& ctx,
+                     const variable_resolver* vars,
+                     std::span<const value_variant> slots,
+                     Fn fn
+                   ) {
+  const predicate_index* index = rules.index.get();
+
+  if (index == nullptr) {
+    apply_each(rules, ctx, vars, slots, std::move(fn));
+    return;
+  }
+
+  context_binding binding{rules, ctx, vars, slots};
+  evaluator       ev{ctx};
 
-  std::copy_if( std::make_move_iterator(elems.begin()), std::make_move_iterator(elems.end()),
-                std::back_inserter(res),
-                notavail
-              );
+  // the variables read by the index are read again by the selected rules
+  if (vars) {
+    binding.memoize(rules.variable_names().size());
+    ctx.memoize_slots = true;
+  }
 
-  return { std::move(res),
-           elems.size() - res.size()
-         };
-}
+  std::vector<std::uint32_t> selected = index->unindexed;
 
-void evaluator::visit(const missing &n) {
-  std::vector<value_variant> res;
+  for (const predicate_index::variable_conditions& conds : index->variables)
+    select_rules(conds, ev.eval(*conds.variable), selected);
 
-  std::tie(res, std::ignore) = missing_aux(n, 0);
+  // a rule may be selected by several values of a hash bucket
+  std::sort(selected.begin(), selected.end());
+  selected.erase(std::unique(selected.begin(), selected.end()), selected.end());
 
-  calcres = &mk_array_value(std::move(res));
+  const array& all = rule_array(rules);
+
+  for (std::uint32_t i : selected)
+    fn(i, ev.eval(all.operand(i)));
 }
 
-void evaluator::visit(const missing_some &n) {
-  const std::uint64_t minreq = unpack_value<std::uint64_t>(eval(n.operand(0)));
+/// returns the first truthy rule of the rule set \p rules
+/// \details
+///   follows the first match plan; without plan, the rules are
+///   evaluated in order.
+std::optional<std::size_t>
+first_match( logic_data& rules,
+             evaluation_context_data& ctx,
+             const variable_resolver* vars,
+             std::span<const value_variant> slots
+           ) {
+  context_binding binding{rules, ctx, vars, slots};
+  evaluator       ev{ctx};
 
-  auto [res, avail] = missing_aux(n, 1);
+  if (vars && rules.has_repeated_variables())
+    binding.memoize(rules.variable_uses());
 
-  if (avail >= minreq)
-    res.clear();
+  const first_match_plan* plan = rules.plan.get();
 
-  calcres = &mk_array_value(std::move(res));
-}
+  if (plan == nullptr) {
+    std::size_t i = 0;
 
-void evaluator::visit(const if_expr &n) {
-  const int num = n.num_evaluated_operands();
+    for (const any_expr& rule : rule_array(rules)) {
+      if (truthy(ev.eval(*rule)))
+        return i;
 
-  if (num == 0) {
-    calcres = to_value(nullptr);
-    return;
+      ++i;
+    }
+
+    return std::nullopt;
   }
 
-  const int lim = num - 1;
-  int pos = 0;
+  const std::vector<first_match_plan::step>& steps = plan->steps;
+  std::size_t                                 pc    = 0;
 
-  while (pos < lim) {
-    if (truthy(eval(n.operand(pos)))) {
-      calcres = eval(n.operand(pos + 1));
-      return;
+  while (pc < steps.size()) {
+    const first_match_plan::step& st = steps[pc];
+    const bool holds = std::all_of( st.conditions.begin(), st.conditions.end(),
+                                    [&ev](const expr* cond) -> bool { return truthy(ev.eval(*cond)); }
+                                  );
+
+    if (!holds) {
+      pc = st.skip;
+      continue;
     }
 
-    pos += 2;
+    if (st.rule != first_match_plan::no_rule)
+      return st.rule;
+
+    ++pc;
   }
 
-  calcres = (pos < num) ? eval(n.operand(pos)) : to_value(nullptr);
+  return std::nullopt;
 }
 
-void evaluator::visit(const log &n) {
-  assert(n.num_evaluated_operands() == 1);
+std::vector<value_variant>
+apply_all( logic_data& rules,
+           evaluation_context_data& ctx,
+           const variable_resolver* vars,
+           std::span<const value_variant> slots
+         ) {
+  std::vector<value_variant> res(rule_array(rules).num_evaluated_operands());
 
-  calcres = eval(n.operand(0));
+  apply_each( rules, ctx, vars, slots,
+              [&res](std::size_t i, any_value val) -> void { res[i] = std::move(val); }
+            );
 
-  logger(calcres);
+  return res;
 }
 
-void evaluator::visit(const array_value &n) { calcres = new array_value(n); }
+std::vector<bool>
+truthy_rules( logic_data& rules,
+              evaluation_context_data& ctx,
+              const variable_resolver* vars,
+              std::span<const value_variant> slots
+            ) {
+  std::vector<bool> res(rule_array(rules).num_evaluated_operands(), false);
 
-void evaluator::visit(const null_value &n) { _value(n); }
-void evaluator::visit(const bool_value &n) { _value(n); }
-void evaluator::visit(const int_value &n) { _value(n); }
-void evaluator::visit(const unsigned_int_value &n) { _value(n); }
-void evaluator::visit(const real_value &n) { _value(n); }
-void evaluator::visit(const string_value &n) { _value(n); }
+  apply_selected( rules, ctx, vars, slots,
+                  [&res](std::size_t i, const any_value& val) -> void { res[i] = truthy(val); }
+                );
 
-any_value eval_path(const managed_string_view& path, const json::object *obj) {
-  if (obj) {
-    if (auto pos = obj->find(path); pos != obj->end())
-      return jsonlogic::to_value(pos->value());
+  return res;
+}
 
-    if (std::size_t pos = path.find('.'); pos != json::string::npos) {
-      managed_string_view selector = path.substr(0, pos);
-      managed_string_view suffix   = path.substr(pos + 1);
+std::vector<std::size_t>
+matching_rules( logic_data& rules,
+                evaluation_context_data& ctx,
+                const variable_resolver* vars,
+                std::span<const value_variant> slots
+              ) {
+  std::vector<std::size_t> res;
 
-      return eval_path(suffix, obj->at(selector).if_object());
-    }
-  }
+  apply_selected( rules, ctx, vars, slots,
+                  [&res](std::size_t i, const any_value& val) -> void {
+                    if (truthy(val)) res.push_back(i);
+                  }
+                );
 
-  throw variable_resolution_error{"in logic.cc::eval_path."};
+  return res;
 }
 
-template <class IntT>
-any_value eval_index(IntT idx, const json::array &arr) {
-  return jsonlogic::to_value(arr[idx]);
-}
+void apply_rows( logic_data& rule,
+                 evaluation_context_data& ctx,
+                 const value_variant* matrix, std::size_t n_rows, std::size_t stride,
+                 value_variant* out
+               ) {
+  assert(rule.syntax_tree().get());
 
+  if (stride < rule.variable_names().size()) {
+    CXX_UNLIKELY;
+    throw std::logic_error{"row stride is less than the number of variables"};
+  }
 
-any_value apply(const expr &exp, const variable_accessor &vars) {
-  variant_logger logger = [](const value_variant& val) -> void { std::cerr << val << std::endl; };
-  evaluator ev{vars, logger};
+  context_binding binding{rule, ctx, nullptr, {}};
+  evaluator       ev{ctx};
+  const expr&     exp = *rule.syntax_tree();
 
-  return ev.eval(exp);
-}
+  for (std::size_t row = 0; row < n_rows; ++row) {
+    if (row) binding.next_evaluation();
 
-any_value apply(logic_data& rule, const variable_accessor &vars) {
-  assert(rule.syntax_tree().get());
-  return jsonlogic::apply(*rule.syntax_tree(), vars);
+    ctx.slots = std::span<const value_variant>(matrix + row * stride, stride);
+    out[row]  = ev.eval(exp);
+  }
 }
 
-any_value apply(logic_data& rule) {
-  auto no_variables = [](value_variant, int) -> any_value { throw std::logic_error{"variable accessor not available"}; };
+/// calls \p fn with the thread's default evaluation context.
+/// \details
+///   if the default context is in use (e.g., an accessor evaluates
+///   another rule), \p fn is called with a temporary context.
+template <class Fn>
+auto with_default_context(Fn fn) -> decltype(fn(std::declval<evaluation_context_data&>())) {
+  thread_local evaluation_context defaultContext;
 
-  return jsonlogic::apply(rule, no_variables);
-}
+  evaluation_context_data& ctx = defaultContext.internal_data();
+
+  if (ctx.in_use) {
+    CXX_UNLIKELY;
+    evaluation_context tmpContext;
+
+    return fn(tmpContext.internal_data());
+  }
 
-any_value apply(logic_data& rule, std::vector<value_variant> vars) {
-  return jsonlogic::apply(rule, variant_accessor(std::move(vars)));
+  return fn(ctx);
 }
 
 }  // namespace
@@ -3235,6 +6933,8 @@ any_value apply(logic_data& rule, std::vector<value_variant> vars) {
 
 
 variable_accessor json_accessor(json::value data) {
+  // the std::function stores the accessor on the heap
+  count_allocations();
   return [data = std::move(data)](value_variant keyval, int) -> any_value {
     if (const managed_string_view *ppath = std::get_if<managed_string_view>(&keyval)) {
       //~ std::cerr << *ppath << std::endl;
@@ -3253,6 +6953,7 @@ variable_accessor json_accessor(json::value data) {
 }
 
 variable_accessor variant_accessor(std::vector<value_variant> vars) {
+  count_allocations();
   return [vars = std::move(vars)](value_variant, int idx) -> any_value {
     if ((idx >= 0) && (std::size_t(idx) < vars.size())) {
       CXX_LIKELY;
@@ -3366,6 +7067,199 @@ std::ostream &operator<<(std::ostream &os, any_expr &n) {
 
 expr &oper::operand(int n) const { return deref(this->at(n).get()); }
 
+//
+// profile reports
+
+std::uint32_t evaluation_profile::entry(std::uint32_t parent, const expr& n) {
+  auto [pos, fresh] = index.try_emplace({parent, &n}, std::uint32_t(entries.size()));
+
+  if (fresh)
+    entries.push_back(node_profile{&n, parent});
+
+  return pos->second;
+}
+
+std::uint32_t evaluation_profile::find(std::uint32_t parent, const expr& n) const {
+  auto pos = index.find({parent, &n});
+
+  return (pos == index.end()) ? npos : pos->second;
+}
+
+namespace {
+
+/// names the operator of a node in profile reports
+struct operator_namer : forwarding_visitor {
+  std::string_view name = "expr";
+
+  void visit(const equal &) final { name = "=="; }
+  void visit(const strict_equal &) final { name = "==="; }
+  void visit(const not_equal &) final { name = "!="; }
+  void visit(const strict_not_equal &) final { name = "!=="; }
+  void visit(const less &) final { name = "<"; }
+  void visit(const greater &) final { name = ">"; }
+  void visit(const less_or_equal &) final { name = "<="; }
+  void visit(const greater_or_equal &) final { name = ">="; }
+  void visit(const logical_and &) final { name = "and"; }
+  void visit(const logical_or &) final { name = "or"; }
+  void visit(const logical_not &) final { name = "!"; }
+  void visit(const logical_not_not &) final { name = "!!"; }
+  void visit(const add &) final { name = "+"; }
+  void visit(const subtract &) final { name = "-"; }
+  void visit(const multiply &) final { name = "*"; }
+  void visit(const divide &) final { name = "/"; }
+  void visit(const modulo &) final { name = "%"; }
+  void visit(const min &) final { name = "min"; }
+  void visit(const max &) final { name = "max"; }
+  void visit(const map &) final { name = "map"; }
+  void visit(const reduce &) final { name = "reduce"; }
+  void visit(const filter &) final { name = "filter"; }
+  void visit(const all &) final { name = "all"; }
+  void visit(const none &) final { name = "none"; }
+  void visit(const some &) final { name = "some"; }
+  void visit(const merge &) final { name = "merge"; }
+  void visit(const cat &) final { name = "cat"; }
+  void visit(const substr &) final { name = "substr"; }
+  void visit(const membership &) final { name = "in"; }
+  void visit(const var &) final { name = "var"; }
+  void visit(const missing &) final { name = "missing"; }
+  void visit(const missing_some &) final { name = "missing_some"; }
+  void visit(const log &) final { name = "log"; }
+  void visit(const array &) final { name = "array"; }
+  void visit(const if_expr &) final { name = "if"; }
+  void visit(const value_base &) final { name = "value"; }
+  void visit(const object_value &) final { name = "object"; }
+  void visit(const error &) final { name = "error"; }
+  void visit(const interned_expr &) final { name = "interned"; }
+
+#if WITH_JSON_LOGIC_CPP_EXTENSIONS
+  void visit(const regex_match &) final { name = "regex"; }
+#endif /* WITH_JSON_LOGIC_CPP_EXTENSIONS */
+
+#if ENABLE_OPTIMIZATIONS
+  void visit(const opt_membership_array &) final { name = "in"; }
+  void visit(const common_subexpr &) final { name = "common_subexpr"; }
+#endif /* ENABLE_OPTIMIZATIONS */
+};
+
+std::string_view operator_name(const expr &n) {
+  operator_namer namer;
+
+  n.accept(namer);
+  return namer.name;
+}
+
+/// returns the nodes that are evaluated as part of \p n
+std::vector<const expr*> profiled_children(const expr &n) {
+  std::vector<const expr*> res;
+
+#if ENABLE_OPTIMIZATIONS
+  if (const common_subexpr* cse = may_down_cast<common_subexpr>(n)) {
+    res.push_back(&cse->shared());
+    return res;
+  }
+#endif /* ENABLE_OPTIMIZATIONS */
+
+  if (const interned_expr* ref = may_down_cast<interned_expr>(n)) {
+    res.push_back(&ref->shared());
+    return res;
+  }
+
+  if (const oper* op = may_down_cast<oper>(n))
+    for (const any_expr& el : op->operands())
+      res.push_back(el.get());
+
+  return res;
+}
+
+json::value to_json(const value_variant &val) {
+  switch (val.index()) {
+    case bool_variant: return std::get<bool>(val);
+    case sint_variant: return std::get<std::int64_t>(val);
+    case uint_variant: return std::get<std::uint64_t>(val);
+    case real_variant: return std::get<double>(val);
+    case strv_variant: return json::string(std::get<managed_string_view>(val).view());
+
+    case sequ_variant: {
+      json::array res;
+
+      for (const value_variant& el : std::get<array_value const*>(val)->value())
+        res.push_back(to_json(el));
+
+      return res;
+    }
+
+    default: ;
+  }
+
+  return nullptr;
+}
+
+/// returns the statistics of \p n and its children
+///   as json object that mirrors the rule.
+json::value profile_report(const expr &n, const evaluation_profile &prof, std::uint32_t parent) {
+  const std::uint32_t self  = prof.find(parent, n);
+  const node_profile  stats = (self == evaluation_profile::npos) ? node_profile{} : prof.entries[self];
+  json::object        res;
+
+  res["op"] = operator_name(n);
+
+  if (const value_base* val = may_down_cast<value_base>(n))
+    res["value"] = to_json(val->to_variant());
+
+#if ENABLE_OPTIMIZATIONS
+  if (const common_subexpr* cse = may_down_cast<common_subexpr>(n))
+    res["id"] = cse->id();
+#endif /* ENABLE_OPTIMIZATIONS */
+
+  res["evaluations"] = stats.evaluations;
+  res["truthy"]      = stats.truthy;
+  res["falsy"]       = stats.falsy;
+  res["cycles"]      = stats.cycles;
+  res["allocations"] = stats.allocations;
+
+  if (std::vector<const expr*> children = profiled_children(n); !children.empty()) {
+    json::array operands;
+
+    for (const expr* child : children)
+      operands.push_back(profile_report(deref(child), prof, self));
+
+    res["operands"] = std::move(operands);
+  }
+
+  return res;
+}
+
+/// returns the label of a profile entry in folded stacks
+std::string folded_label(const expr &n) {
+  std::string res{operator_name(n)};
+
+  // name non-computed variables, e.g., var(x)
+  if (const var* v = may_down_cast<var>(n); v && v->size()) {
+    if (const string_value* str = may_down_cast<string_value>(v->operand(0))) {
+      res += '(';
+      res += str->value().view();
+      res += ')';
+    }
+  }
+
+  // ';' separates stack frames
+  std::replace(res.begin(), res.end(), ';', ',');
+  return res;
+}
+
+evaluation_profile& profile_data(const logic_data& rule) {
+  if (!rule.profile) {
+    CXX_UNLIKELY;
+    throw std::logic_error{"profiling is not enabled"};
+  }
+
+  return *rule.profile;
+}
+
+} // namespace
+
+std::uint64_t allocation_count() { return value_allocations; }
+
 //
 // logic_rule
 
@@ -3378,6 +7272,54 @@ logic_rule& logic_rule::operator=(logic_rule&&) = default;
 logic_rule::~logic_rule()                       = default;
 
 logic_data& logic_rule::internal_data() { return *data; }
+const logic_data& logic_rule::internal_data() const { return *data; }
+
+void logic_rule::adaptive_ordering(CXX_MAYBE_UNUSED bool enable) {
+#if ENABLE_OPTIMIZATIONS
+  data->adaptive_ordering = enable;
+#endif /* ENABLE_OPTIMIZATIONS */
+}
+
+void logic_rule::profiling(bool enable) {
+  if (enable)
+    data->profile = std::make_unique<evaluation_profile>();
+  else
+    data->profile.reset();
+}
+
+json::value logic_rule::profile_report() const {
+  const evaluation_profile& prof = profile_data(*data);
+  json::object              res;
+
+  res["counter"] = CYCLE_COUNTER_UNIT;
+  res["rule"]    = jsonlogic::profile_report(*data->syntax_tree(), prof, 0);
+  return res;
+}
+
+void logic_rule::write_folded_profile(std::ostream& os) const {
+  const evaluation_profile&       prof    = profile_data(*data);
+  const std::vector<node_profile>& entries = prof.entries;
+
+  // parents precede their children in entries
+  std::vector<std::uint64_t> childcycles(entries.size(), 0);
+
+  for (std::size_t i = entries.size() - 1; i > 0; --i)
+    childcycles[entries[i].parent] += entries[i].cycles;
+
+  std::vector<std::string> labels(entries.size());
+
+  for (std::size_t i = 1; i < entries.size(); ++i) {
+    const node_profile& stats  = entries[i];
+    const std::string&  prefix = labels[stats.parent];
+
+    labels[i] = prefix.empty() ? folded_label(*stats.node)
+                               : prefix + ';' + folded_label(*stats.node);
+
+    // exclusive cycles; nested timer reads may exceed the parent's
+    if (stats.cycles > childcycles[i])
+      os << labels[i] << ' ' << (stats.cycles - childcycles[i]) << '\n';
+  }
+}
 
 std::vector<std::string_view> const &logic_rule::variable_names() const {
   return data->variable_names();
@@ -3387,15 +7329,214 @@ bool logic_rule::has_computed_variable_names() const {
   return data->has_computed_variable_names();
 }
 
-any_value logic_rule::apply() { return jsonlogic::apply(*data); }
+any_value logic_rule::apply() {
+  auto no_variables = [](value_variant, int) -> any_value { throw std::logic_error{"variable accessor not available"}; };
+
+  return apply(no_variables);
+}
 
 
-any_value logic_rule::apply(const variable_accessor &var_accessor) {
-  return jsonlogic::apply(*data, var_accessor);
+any_value logic_rule::apply(variable_resolver vars) {
+  return with_default_context(
+           [this, &vars](evaluation_context_data& ctx) -> any_value {
+             return jsonlogic::apply(*data, ctx, &vars, {});
+           });
 }
 
 any_value logic_rule::apply(std::vector<value_variant> vars)  {
-  return jsonlogic::apply(*data, std::move(vars));
+  return apply(std::span<const value_variant>(vars));
+}
+
+any_value logic_rule::apply(std::span<const value_variant> vars)  {
+  return with_default_context(
+           [this, vars](evaluation_context_data& ctx) -> any_value {
+             return jsonlogic::apply(*data, ctx, nullptr, vars);
+           });
+}
+
+any_value logic_rule::apply(evaluation_context& ctx, variable_resolver vars) {
+  return jsonlogic::apply(*data, ctx.internal_data(), &vars, {});
+}
+
+any_value logic_rule::apply_lazy(variable_resolver provider) {
+  return with_default_context(
+           [this, &provider](evaluation_context_data& ctx) -> any_value {
+             return jsonlogic::apply_lazy(*data, ctx, provider);
+           });
+}
+
+any_value logic_rule::apply_lazy(evaluation_context& ctx, variable_resolver provider) {
+  return jsonlogic::apply_lazy(*data, ctx.internal_data(), provider);
+}
+
+any_value logic_rule::apply(evaluation_context& ctx, std::span<const value_variant> vars) {
+  return jsonlogic::apply(*data, ctx.internal_data(), nullptr, vars);
+}
+
+void logic_rule::apply_rows( const value_variant* matrix, std::size_t n_rows, std::size_t stride,
+                             value_variant* out
+                           ) {
+  with_default_context(
+    [this, matrix, n_rows, stride, out](evaluation_context_data& ctx) -> void {
+      jsonlogic::apply_rows(*data, ctx, matrix, n_rows, stride, out);
+    });
+}
+
+void logic_rule::apply_rows( evaluation_context& ctx,
+                             const value_variant* matrix, std::size_t n_rows, std::size_t stride,
+                             value_variant* out
+                           ) {
+  jsonlogic::apply_rows(*data, ctx.internal_data(), matrix, n_rows, stride, out);
 }
 
+//
+// rule_set
+
+rule_set::rule_set(std::unique_ptr<logic_data>&& rules_data)
+: data(std::move(rules_data))
+{}
+
+rule_set::rule_set(rule_set&&)            = default;
+rule_set& rule_set::operator=(rule_set&&) = default;
+rule_set::~rule_set()                     = default;
+
+logic_data& rule_set::internal_data() { return *data; }
+const logic_data& rule_set::internal_data() const { return *data; }
+
+std::size_t rule_set::size() const {
+  return rule_array(*data).num_evaluated_operands();
+}
+
+std::vector<std::string_view> const &rule_set::variable_names() const {
+  return data->variable_names();
+}
+
+bool rule_set::has_computed_variable_names() const {
+  return data->has_computed_variable_names();
+}
+
+std::size_t rule_set::indexed_rules() const {
+  if (!data->index)
+    return 0;
+
+  return size() - data->index->unindexed.size();
+}
+
+void rule_set::adaptive_ordering(CXX_MAYBE_UNUSED bool enable) {
+#if ENABLE_OPTIMIZATIONS
+  data->adaptive_ordering = enable;
+#endif /* ENABLE_OPTIMIZATIONS */
+}
+
+std::vector<value_variant> rule_set::apply(variable_resolver vars) {
+  return with_default_context(
+           [this, &vars](evaluation_context_data& ctx) -> std::vector<value_variant> {
+             return apply_all(*data, ctx, &vars, {});
+           });
+}
+
+std::vector<value_variant> rule_set::apply(evaluation_context& ctx, variable_resolver vars) {
+  return apply_all(*data, ctx.internal_data(), &vars, {});
+}
+
+std::vector<value_variant> rule_set::apply(std::span<const value_variant> vars) {
+  return with_default_context(
+           [this, vars](evaluation_context_data& ctx) -> std::vector<value_variant> {
+             return apply_all(*data, ctx, nullptr, vars);
+           });
+}
+
+std::vector<value_variant> rule_set::apply(evaluation_context& ctx, std::span<const value_variant> vars) {
+  return apply_all(*data, ctx.internal_data(), nullptr, vars);
+}
+
+std::vector<bool> rule_set::truthy_rules(variable_resolver vars) {
+  return with_default_context(
+           [this, &vars](evaluation_context_data& ctx) -> std::vector<bool> {
+             return jsonlogic::truthy_rules(*data, ctx, &vars, {});
+           });
+}
+
+std::vector<bool> rule_set::truthy_rules(evaluation_context& ctx, variable_resolver vars) {
+  return jsonlogic::truthy_rules(*data, ctx.internal_data(), &vars, {});
+}
+
+std::vector<bool> rule_set::truthy_rules(std::span<const value_variant> vars) {
+  return with_default_context(
+           [this, vars](evaluation_context_data& ctx) -> std::vector<bool> {
+             return jsonlogic::truthy_rules(*data, ctx, nullptr, vars);
+           });
+}
+
+std::vector<bool> rule_set::truthy_rules(evaluation_context& ctx, std::span<const value_variant> vars) {
+  return jsonlogic::truthy_rules(*data, ctx.internal_data(), nullptr, vars);
+}
+
+std::vector<std::size_t> rule_set::matching_rules(variable_resolver vars) {
+  return with_default_context(
+           [this, &vars](evaluation_context_data& ctx) -> std::vector<std::size_t> {
+             return jsonlogic::matching_rules(*data, ctx, &vars, {});
+           });
+}
+
+std::vector<std::size_t> rule_set::matching_rules(evaluation_context& ctx, variable_resolver vars) {
+  return jsonlogic::matching_rules(*data, ctx.internal_data(), &vars, {});
+}
+
+std::vector<std::size_t> rule_set::matching_rules(std::span<const value_variant> vars) {
+  return with_default_context(
+           [this, vars](evaluation_context_data& ctx) -> std::vector<std::size_t> {
+             return jsonlogic::matching_rules(*data, ctx, nullptr, vars);
+           });
+}
+
+std::vector<std::size_t> rule_set::matching_rules(evaluation_context& ctx, std::span<const value_variant> vars) {
+  return jsonlogic::matching_rules(*data, ctx.internal_data(), nullptr, vars);
+}
+
+std::optional<std::size_t> rule_set::first_match(variable_resolver vars) {
+  return with_default_context(
+           [this, &vars](evaluation_context_data& ctx) -> std::optional<std::size_t> {
+             return jsonlogic::first_match(*data, ctx, &vars, {});
+           });
+}
+
+std::optional<std::size_t> rule_set::first_match(evaluation_context& ctx, variable_resolver vars) {
+  return jsonlogic::first_match(*data, ctx.internal_data(), &vars, {});
+}
+
+std::optional<std::size_t> rule_set::first_match(std::span<const value_variant> vars) {
+  return with_default_context(
+           [this, vars](evaluation_context_data& ctx) -> std::optional<std::size_t> {
+             return jsonlogic::first_match(*data, ctx, nullptr, vars);
+           });
+}
+
+std::optional<std::size_t> rule_set::first_match(evaluation_context& ctx, std::span<const value_variant> vars) {
+  return jsonlogic::first_match(*data, ctx.internal_data(), nullptr, vars);
+}
+
+//
+// evaluation_context
+
+evaluation_context::evaluation_context()
+: data(std::make_unique<evaluation_context_data>())
+{
+  data->logger = [](const value_variant& val) -> void { std::cerr << val << std::endl; };
+}
+
+evaluation_context::evaluation_context(evaluation_context&&)            = default;
+evaluation_context& evaluation_context::operator=(evaluation_context&&) = default;
+evaluation_context::~evaluation_context()                               = default;
+
+void evaluation_context::logger(std::function<void(const value_variant&)> fn) {
+  data->logger = std::move(fn);
+}
+
+const evaluation_statistics& evaluation_context::statistics() const { return data->stats; }
+
+void evaluation_context::reset_statistics() { data->stats = evaluation_statistics{}; }
+
+evaluation_context_data& evaluation_context::internal_data() { return *data; }
+
 }  // namespace jsonlogic
@@ -1,14 +1,54 @@
 #include <boost/json.hpp>
 #include <boost/json/src.hpp>
 #include <boost/lexical_cast.hpp>
+#include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <jsonlogic/logic.hpp>
+#include <new>
+#include <optional>
+#include <set>
 #include <sstream>
 #include <vector>
 #include <ranges>
 
+/// number of heap allocations by the calling thread
+/// \details
+///    the replacements of the global allocation functions below count
+///    every allocation, including those inside the jsonlogic library.
+thread_local std::uint64_t heap_allocations = 0;
+
+void *operator new(std::size_t sz) {
+  ++heap_allocations;
+
+  if (void *mem = std::malloc(sz ? sz : 1))
+    return mem;
+
+  throw std::bad_alloc{};
+}
+
+void *operator new(std::size_t sz, std::align_val_t al) {
+  const std::size_t align = static_cast<std::size_t>(al);
+
+  // aligned_alloc requires a non-zero multiple of the alignment
+  const std::size_t size = (std::max<std::size_t>(sz, 1) + align - 1) / align * align;
+
+  ++heap_allocations;
+
+  if (void *mem = std::aligned_alloc(align, size))
+    return mem;
+
+  throw std::bad_alloc{};
+}
+
+// not inlined, so that free is not matched against new at call sites
+[[gnu::noinline]] void operator delete(void *mem) noexcept { std::free(mem); }
+void operator delete(void *mem, std::size_t) noexcept { ::operator delete(mem); }
+void operator delete(void *mem, std::align_val_t) noexcept { ::operator delete(mem); }
+void operator delete(void *mem, std::size_t, std::align_val_t) noexcept { ::operator delete(mem); }
+
 enum class ResultStatus : std::uint8_t {
   NoError = 0,  // no error
   Error = 1,    // error in execution. Set resultError if known
@@ -127,9 +167,54 @@ struct settings {
   bool quiet = false;
   bool generate_expected = false;
   bool simple_apply = false;
+  bool allocation_free = false;
+  bool from_text = false;
+  jsonlogic::logic_options options;
   std::string filename;
 };
 
+/// create_logic_from_text and create_logic disagree on a rule
+struct text_mismatch : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+/// creates the rule from its json text with options \p opts
+/// \throws text_mismatch if only one of create_logic and
+///         create_logic_from_text accepts the rule, or if the rules
+///         read different variables
+jsonlogic::logic_rule create_from_text(const bjsn::value &rule,
+                                       const jsonlogic::logic_options &opts) {
+  std::optional<jsonlogic::logic_rule> reference;
+
+  try {
+    reference.emplace(jsonlogic::create_logic(rule, opts));
+  } catch (const std::exception &) {
+  }
+
+  std::optional<jsonlogic::logic_rule> res;
+
+  try {
+    res.emplace(
+        jsonlogic::create_logic_from_text(bjsn::serialize(rule), opts));
+  } catch (const std::exception &ex) {
+    if (reference)
+      throw text_mismatch{std::string("only create_logic_from_text fails: ") +
+                          ex.what()};
+
+    throw;
+  }
+
+  if (!reference)
+    throw text_mismatch{"only create_logic fails"};
+
+  if (res->has_computed_variable_names() !=
+          reference->has_computed_variable_names() ||
+      !std::ranges::equal(res->variable_names(), reference->variable_names()))
+    throw text_mismatch{"the rules read different variables"};
+
+  return std::move(*res);
+}
+
 /// converts val to a value_variant
 /// \details
 ///    the object \p val's lifetime MUST exceeds the returned
@@ -186,22 +271,201 @@ std::string variant_to_string(const jsonlogic::value_variant& val)
   return os.str();
 }
 
+/// evaluates \p fn twice and throws if the second (steady state)
+///   evaluation allocates.
+template <class Fn>
+void require_allocation_free(Fn fn) {
+  fn();
+
+  const std::uint64_t before = heap_allocations;
+
+  fn();
+
+  if (const std::uint64_t allocs = heap_allocations - before)
+    throw std::runtime_error{"rule allocates in steady state: " +
+                             std::to_string(allocs) + " allocation(s)"};
+}
+
+/// checks that every node of the profile report \p node has all statistics,
+///   and adds the folded stacks of the evaluated nodes to \p stacks.
+/// \throws std::runtime_error if a statistic is missing
+void collect_profile_stacks(const bjsn::value &node, const std::string &prefix,
+                            std::set<std::string> &stacks) {
+  const bjsn::object &obj = node.as_object();
+
+  for (std::string_view key :
+       {"op", "evaluations", "truthy", "falsy", "cycles", "allocations"})
+    if (!obj.contains(key))
+      throw std::runtime_error{"profile node without " + std::string(key) +
+                               ": " + bjsn::serialize(node)};
+
+  const bjsn::value *operands = obj.if_contains("operands");
+  const bjsn::string &op = obj.at("op").as_string();
+  std::string label(op.data(), op.size());
+
+  // non-computed variables are labeled var(name)
+  if (label == "var" && operands && !operands->as_array().empty()) {
+    const bjsn::value *name =
+        operands->as_array()[0].as_object().if_contains("value");
+
+    if (name && name->is_string()) {
+      const bjsn::string &str = name->get_string();
+
+      label += '(';
+      label.append(str.data(), str.size());
+      label += ')';
+    }
+  }
+
+  std::replace(label.begin(), label.end(), ';', ',');
+
+  const std::string stack = prefix.empty() ? label : prefix + ';' + label;
+
+  if (bjsn::serialize(obj.at("evaluations")) != "0")
+    stacks.insert(stack);
+
+  if (operands)
+    for (const bjsn::value &sub : operands->as_array())
+      collect_profile_stacks(sub, stack, stacks);
+}
+
+/// compares the node \p got of a profile report with \p expected
+/// \details
+///    the properties in \p expected must match; cycles and allocations
+///    vary and are left out. Operands are compared when \p expected
+///    lists them.
+/// \throws std::runtime_error on a mismatch
+void compare_profile(const bjsn::value &got, const bjsn::value &expected,
+                     const std::string &path) {
+  const bjsn::object &obj = got.as_object();
+
+  for (const auto &prop : expected.as_object()) {
+    if (prop.key() == "operands")
+      continue;
+
+    const bjsn::value *val = obj.if_contains(prop.key());
+
+    if (!val || bjsn::serialize(*val) != bjsn::serialize(prop.value()))
+      throw std::runtime_error{path + ": expected " +
+                               bjsn::serialize(expected) + ", got " +
+                               bjsn::serialize(got)};
+  }
+
+  const bjsn::value *ops = expected.as_object().if_contains("operands");
+
+  if (!ops)
+    return;
+
+  const bjsn::value *gotops = obj.if_contains("operands");
+
+  if (!gotops || gotops->as_array().size() != ops->as_array().size())
+    throw std::runtime_error{path + ": operands differ: " +
+                             bjsn::serialize(got)};
+
+  for (std::size_t i = 0; i < ops->as_array().size(); ++i)
+    compare_profile(gotops->as_array()[i], ops->as_array()[i],
+                    path + '/' + std::to_string(i));
+}
+
+/// evaluates \p rule, created with \p opts, once with profiling and
+///   compares the report with \p expected (the report of the rule's
+///   root node).
+/// \details
+///    the stacks in the folded profile must be those of evaluated nodes,
+///    and both reports must throw std::logic_error when profiling is off.
+/// \throws std::runtime_error on a mismatch
+void check_profile(const bjsn::value &rule, const bjsn::value &data,
+                   const bjsn::value &expected,
+                   const jsonlogic::logic_options &opts) {
+  jsonlogic::logic_rule logic = jsonlogic::create_logic(rule, opts);
+  std::stringstream folded;
+
+  auto require_logic_error = [&logic, &folded](const std::string &when) {
+    try {
+      logic.profile_report();
+      throw std::runtime_error{"profile_report without profiling " + when};
+    } catch (const std::logic_error &) {
+    }
+
+    try {
+      logic.write_folded_profile(folded);
+      throw std::runtime_error{"write_folded_profile without profiling " +
+                               when};
+    } catch (const std::logic_error &) {
+    }
+  };
+
+  require_logic_error("before profiling(true)");
+  logic.profiling(true);
+
+  try {
+    logic.apply(jsonlogic::json_accessor(data));
+  } catch (const std::exception &) {
+    // failing nodes are counted as well
+  }
+
+  const bjsn::value report = logic.profile_report();
+  const bjsn::object &obj = report.as_object();
+  std::set<std::string> stacks;
+
+  if (!obj.contains("counter") || !obj.at("counter").is_string())
+    throw std::runtime_error{"profile without counter"};
+
+  collect_profile_stacks(obj.at("rule"), "", stacks);
+  compare_profile(obj.at("rule"), expected, "rule");
+  logic.write_folded_profile(folded);
+
+  std::string line;
+  std::size_t lines = 0;
+
+  // each line holds a stack and the exclusive cycles of its innermost node
+  while (std::getline(folded, line)) {
+    const std::size_t pos = line.rfind(' ');
+
+    if (pos == std::string::npos || !stacks.contains(line.substr(0, pos)) ||
+        boost::lexical_cast<std::uint64_t>(line.substr(pos + 1)) == 0)
+      throw std::runtime_error{"unexpected folded stack: " + line};
+
+    ++lines;
+  }
+
+  if (lines == 0)
+    throw std::runtime_error{"empty folded profile"};
+
+  logic.profiling(false);
+  require_logic_error("after profiling(false)");
+}
+
 std::string call_apply(settings &config, const bjsn::value &rule,
                                const bjsn::value &data) {
   using value_vector = std::vector<jsonlogic::value_variant>;
 
-  jsonlogic::logic_rule logic = jsonlogic::create_logic(rule);
+  jsonlogic::logic_rule logic =
+      config.from_text ? create_from_text(rule, config.options)
+                       : jsonlogic::create_logic(rule, config.options);
 
   if (config.simple_apply)
   {
     // simple_apply currently not supported; just call apply..
-    return variant_to_string(logic.apply(jsonlogic::json_accessor(data)));
+    jsonlogic::variable_accessor accessor = jsonlogic::json_accessor(data);
+    std::string res = variant_to_string(logic.apply(accessor));
+
+    if (config.allocation_free) {
+      jsonlogic::evaluation_context ctx;
+
+      require_allocation_free([&]() { return logic.apply(ctx, accessor); });
+    }
+
+    return res;
   }
 
   if (!logic.has_computed_variable_names()) {
     if (config.verbose)
       std::cerr << "execute with precomputed value array." << std::endl;
 
+    value_vector               values;
+    std::optional<std::string> res;
+
     try {
       auto value_maker =
           [&data](std::string_view nm) -> jsonlogic::value_variant {
@@ -211,16 +475,36 @@ std::string call_apply(settings &config, const bjsn::value &rule,
       // extract all variable values into vector
       auto const varvalues =
           logic.variable_names() | std::views::transform(value_maker);        
-          
-      return variant_to_string(logic.apply(value_vector(varvalues.begin(), varvalues.end())));
+      values.assign(varvalues.begin(), varvalues.end());
+      res = variant_to_string(logic.apply(values));
     } catch (...) {
     }
+
+    // outside of the try block, so that allocations are reported
+    if (res) {
+      if (config.allocation_free) {
+        jsonlogic::evaluation_context ctx;
+
+        require_allocation_free([&]() { return logic.apply(ctx, values); });
+      }
+
+      return *res;
+    }
   }
 
   if (config.verbose)
     std::cerr << "falling back to normal apply" << std::endl;
 
-  return variant_to_string(logic.apply(jsonlogic::json_accessor(data)));
+  jsonlogic::variable_accessor accessor = jsonlogic::json_accessor(data);
+  std::string res = variant_to_string(logic.apply(accessor));
+
+  if (config.allocation_free) {
+    jsonlogic::evaluation_context ctx;
+
+    require_allocation_free([&]() { return logic.apply(ctx, accessor); });
+  }
+
+  return res;
 }
 
 int main(int argc, const char **argv) {
@@ -237,6 +521,8 @@ int main(int argc, const char **argv) {
   auto setQuiet = [&config]() -> void { config.quiet = true; };
   auto setResult = [&config]() -> void { config.generate_expected = true; };
   auto setSimple = [&config]() -> void { config.simple_apply = true; };
+  auto setText = [&config]() -> void { config.from_text = true; };
+  auto setArena = [&config]() -> void { config.options.arena = true; };
   auto setFile = [&config](const std::string &name) -> bool {
     const bool jsonFile = endsWith(name, ".json");
 
@@ -257,6 +543,10 @@ int main(int argc, const char **argv) {
     || matchOpt0(arguments, argn, "--result", setResult)
     || matchOpt0(arguments, argn, "-s", setSimple)
     || matchOpt0(arguments, argn, "--simple", setSimple)
+    || matchOpt0(arguments, argn, "-t", setText)
+    || matchOpt0(arguments, argn, "--text", setText)
+    || matchOpt0(arguments, argn, "-a", setArena)
+    || matchOpt0(arguments, argn, "--arena", setArena)
     || noSwitch0(arguments, argn, setFile)
     ;
     // clang-format on
@@ -281,6 +571,10 @@ int main(int argc, const char **argv) {
   const bool isNonStandard =
       allobj.contains("nonstandard") && allobj["nonstandard"].as_bool();
 
+  // designated rules must not allocate once warmed up
+  config.allocation_free =
+      allobj.contains("allocationfree") && allobj["allocationfree"].as_bool();
+
   std::stringstream expStream;
   std::stringstream resStream;
 
@@ -291,6 +585,16 @@ int main(int argc, const char **argv) {
   else
     dat.emplace_object();
 
+  // tests with "profile" also compare the node statistics of an evaluation
+  if (allobj.contains("profile")) {
+    try {
+      check_profile(rule, dat, allobj["profile"], config.options);
+    } catch (const std::exception &ex) {
+      std::cerr << "test failed: " << ex.what() << std::endl;
+      return 1;
+    }
+  }
+
   try {
     std::string res = call_apply(config, rule, dat);
 
@@ -309,6 +613,10 @@ int main(int argc, const char **argv) {
 
     result_matches_expected = expStream.str() == resStream.str();
     resultStatus = ResultStatus::NoError;
+  } catch (const text_mismatch &ex) {
+    // fails also tests that expect an error
+    std::cerr << "test failed: " << ex.what() << std::endl;
+    return 1;
   } catch (const std::exception &ex) {
     resultStatus = ResultStatus::Error;
     resultError = ex.what();
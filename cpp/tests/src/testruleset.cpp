@@ -0,0 +1,928 @@
+#include <boost/json.hpp>
+#include <boost/json/src.hpp>
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <jsonlogic/logic.hpp>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Checks that rules evaluated together agree with the rules evaluated
+//   one by one (logic_rule::apply).
+//
+// testruleset [-v|-q] [--arena] file.json
+//   file holds {"rules": [...], "data": [...]} and optionally
+//   "indexed", the expected number of rules in the predicate index.
+// testruleset [-v|-q] [--arena] --corpus dir
+//   evaluates the rules of all test files in dir (testeval's format)
+//   as one rule_set against the data of each file.
+// testruleset [-v|-q] [--arena] --wide n
+//   evaluates n rules {"==":[{"var":"vK"},K]}, each with its own variable.
+// testruleset [-v|-q] [--arena] --deep
+//   stores and loads deeply nested rules, and rejects an image whose
+//   nesting would exhaust the stack of the loader.
+// --arena creates and loads the rules with logic_options{.arena = true};
+//   it applies to the modes that follow it.
+//
+// For each data object, the rule_set's apply, truthy_rules, matching_rules
+// and first_match (with a json accessor and, if all variables are given,
+// with a value array) are compared with the individual rules, and so are
+// a rule_set and rules loaded from images and rules created by a
+// rule_store and by rule_caches. first_match must log what the individual
+// rules up to the first truthy rule log. Truncated images and images with
+// extra node records must be rejected. Each rule is also applied with
+// adaptive ordering to the data objects in turn, often enough for the
+// operands of and/or to be reordered, lazily with a slot provider that
+// counts the requested variables, and with value arrays, row by row and
+// as one block of rows (apply_rows).
+
+namespace bjsn = boost::json;
+
+namespace {
+
+struct settings {
+  bool verbose = false;
+  bool quiet = false;
+  jsonlogic::logic_options options;
+};
+
+settings config;
+std::size_t failures = 0;
+
+std::string to_string(const jsonlogic::value_variant &val) {
+  std::stringstream os;
+
+  os << val;
+  return os.str();
+}
+
+void fail(const std::string &what, std::size_t row, const std::string &detail) {
+  ++failures;
+
+  if (!config.quiet)
+    std::cerr << "row " << row << ": " << what << ": " << detail << std::endl;
+}
+
+/// the results of the individual rules for one data object;
+///   std::nullopt when a rule throws.
+using results = std::vector<std::optional<jsonlogic::value_variant>>;
+
+/// evaluation context that appends the output of log to \p out
+jsonlogic::evaluation_context recording_context(std::string &out) {
+  jsonlogic::evaluation_context ctx;
+
+  ctx.logger([&out](const jsonlogic::value_variant &val) {
+    out += to_string(val);
+    out += '\n';
+  });
+  return ctx;
+}
+
+template <class Fn>
+std::optional<jsonlogic::value_variant> try_apply(Fn fn) {
+  try {
+    return fn();
+  } catch (const std::exception &) {
+    return std::nullopt;
+  }
+}
+
+/// compares the result of an individually created rule with \p expected
+void check_result(const std::string &what, std::size_t row, std::size_t rule,
+                  const std::optional<jsonlogic::value_variant> &expected,
+                  const std::optional<jsonlogic::value_variant> &got) {
+  if (expected.has_value() != got.has_value() ||
+      (expected && to_string(*expected) != to_string(*got)))
+    fail(what, row,
+         "rule " + std::to_string(rule) + " expected " +
+             (expected ? to_string(*expected) : "error") + ", got " +
+             (got ? to_string(*got) : "error"));
+}
+
+/// compares the results of rule_set::apply with \p expected
+/// \details
+///    when a rule fails, the evaluation of the set must fail.
+template <class Fn>
+void check_apply(const std::string &what, std::size_t row,
+                 const results &expected, Fn fn) {
+  const bool fails = std::ranges::any_of(
+      expected, [](const auto &res) { return !res.has_value(); });
+
+  try {
+    std::vector<jsonlogic::value_variant> got = fn();
+
+    if (fails)
+      fail(what, row, "no error although a rule fails");
+    else if (got.size() != expected.size())
+      fail(what, row, "wrong number of results");
+    else
+      for (std::size_t i = 0; i < got.size(); ++i)
+        check_result(what, row, i, expected[i], got[i]);
+  } catch (const std::exception &ex) {
+    if (!fails)
+      fail(what, row, std::string("unexpected error: ") + ex.what());
+  }
+}
+
+/// compares truthy_rules with \p expected
+/// \details
+///    rules that fail may be excluded by the predicate index; then they
+///    are not truthy. Otherwise, the evaluation must fail.
+template <class Fn>
+void check_truthy(const std::string &what, std::size_t row,
+                  const results &expected, Fn fn) {
+  std::vector<bool> got;
+
+  try {
+    got = fn();
+  } catch (const std::exception &ex) {
+    if (std::ranges::all_of(expected,
+                            [](const auto &res) { return res.has_value(); }))
+      fail(what, row, std::string("unexpected error: ") + ex.what());
+
+    return;
+  }
+
+  if (got.size() != expected.size()) {
+    fail(what, row, "wrong number of results");
+    return;
+  }
+
+  for (std::size_t i = 0; i < got.size(); ++i) {
+    const bool truthy = expected[i] && jsonlogic::truthy(*expected[i]);
+
+    if (got[i] != truthy)
+      fail(what, row, "rule " + std::to_string(i) + " expected " +
+                          (truthy ? "truthy" : "falsy"));
+  }
+}
+
+/// compares matching_rules with the truthy rules in \p expected
+template <class Fn>
+void check_matching(const std::string &what, std::size_t row,
+                    const results &expected, Fn fn) {
+  std::vector<std::size_t> got;
+
+  try {
+    got = fn();
+  } catch (const std::exception &ex) {
+    if (std::ranges::all_of(expected,
+                            [](const auto &res) { return res.has_value(); }))
+      fail(what, row, std::string("unexpected error: ") + ex.what());
+
+    return;
+  }
+
+  std::vector<std::size_t> truthy;
+
+  for (std::size_t i = 0; i < expected.size(); ++i)
+    if (expected[i] && jsonlogic::truthy(*expected[i]))
+      truthy.push_back(i);
+
+  if (got != truthy)
+    fail(what, row, "matching rules differ");
+}
+
+/// compares first_match with the first truthy rule in \p expected
+/// \details
+///    may fail only if a rule before the first truthy rule fails.
+///    The output of log (\p logged) must be the output of the rules
+///    up to the first truthy rule (\p logs), each evaluated once.
+template <class Fn>
+void check_first(const std::string &what, std::size_t row,
+                 const results &expected,
+                 const std::vector<std::string> &logs, std::string &logged,
+                 Fn fn) {
+  std::optional<std::size_t> first;
+  bool failing = false;
+
+  for (std::size_t i = 0; !first && i < expected.size(); ++i) {
+    if (!expected[i])
+      failing = true;
+    else if (jsonlogic::truthy(*expected[i]))
+      first = i;
+  }
+
+  logged.clear();
+
+  try {
+    const std::optional<std::size_t> got = fn();
+
+    if (got != first) {
+      fail(what, row,
+           "expected " + (first ? std::to_string(*first) : "none") +
+               ", got " + (got ? std::to_string(*got) : "none"));
+      return;
+    }
+
+    std::string log;
+
+    for (std::size_t i = 0; i < (first ? *first + 1 : logs.size()); ++i)
+      log += logs[i];
+
+    if (logged != log)
+      fail(what, row, "log output differs: " + logged);
+  } catch (const std::exception &ex) {
+    if (!failing)
+      fail(what, row, std::string("unexpected error: ") + ex.what());
+  }
+}
+
+/// returns the values of \p names in \p data, if all are present and
+///   can be passed in a value array.
+std::optional<std::vector<jsonlogic::value_variant>>
+value_array(const bjsn::value &data,
+            const std::vector<std::string_view> &names) {
+  const bjsn::object *obj = data.if_object();
+  std::vector<jsonlogic::value_variant> res;
+
+  if (obj == nullptr)
+    return std::nullopt;
+
+  for (std::string_view name : names) {
+    const bjsn::value *val = obj->if_contains(name);
+
+    if (val == nullptr)
+      return std::nullopt;
+
+    switch (val->kind()) {
+    case bjsn::kind::string: {
+      const bjsn::string &str = val->get_string();
+
+      res.emplace_back(jsonlogic::managed_string_view(
+          std::string_view(str.data(), str.size())));
+      break;
+    }
+
+    case bjsn::kind::int64:
+      res.emplace_back(val->get_int64());
+      break;
+
+    case bjsn::kind::uint64:
+      res.emplace_back(val->get_uint64());
+      break;
+
+    case bjsn::kind::double_:
+      res.emplace_back(val->get_double());
+      break;
+
+    case bjsn::kind::bool_:
+      res.emplace_back(val->get_bool());
+      break;
+
+    case bjsn::kind::null:
+      res.emplace_back(nullptr);
+      break;
+
+    default:
+      return std::nullopt;
+    }
+  }
+
+  return res;
+}
+
+/// checks all evaluation paths of rule_set \p set for one data object
+void check_set(const std::string &label, jsonlogic::rule_set &set,
+               std::size_t row, const bjsn::value &data,
+               const results &expected, const std::vector<std::string> &logs) {
+  std::string logged;
+  jsonlogic::evaluation_context ctx = recording_context(logged);
+  jsonlogic::variable_accessor acc = jsonlogic::json_accessor(data);
+
+  check_apply(label + " apply", row, expected,
+              [&] { return set.apply(ctx, acc); });
+  check_truthy(label + " truthy_rules", row, expected,
+               [&] { return set.truthy_rules(ctx, acc); });
+  check_matching(label + " matching_rules", row, expected,
+                 [&] { return set.matching_rules(ctx, acc); });
+  check_first(label + " first_match", row, expected, logs, logged,
+              [&] { return set.first_match(ctx, acc); });
+
+  if (set.has_computed_variable_names())
+    return;
+
+  std::optional<std::vector<jsonlogic::value_variant>> values =
+      value_array(data, set.variable_names());
+
+  if (!values)
+    return;
+
+  std::span<const jsonlogic::value_variant> vals(*values);
+
+  check_apply(label + " apply(span)", row, expected,
+              [&] { return set.apply(ctx, vals); });
+  check_truthy(label + " truthy_rules(span)", row, expected,
+               [&] { return set.truthy_rules(ctx, vals); });
+  check_matching(label + " matching_rules(span)", row, expected,
+                 [&] { return set.matching_rules(ctx, vals); });
+  check_first(label + " first_match(span)", row, expected, logs, logged,
+              [&] { return set.first_match(ctx, vals); });
+}
+
+// a rule image starts with an 8 byte magic and four 32 bit fields,
+//   followed by the section of node records (64 bit offset and count).
+constexpr std::size_t image_nodes = 24;
+constexpr std::size_t image_node_size = 16;
+
+/// returns the node records of \p image
+std::vector<std::byte> node_records(const std::vector<std::byte> &image) {
+  std::uint64_t section[2];
+
+  std::memcpy(section, image.data() + image_nodes, sizeof(section));
+
+  const auto beg = image.begin() + section[0];
+
+  return std::vector<std::byte>(beg, beg + section[1] * image_node_size);
+}
+
+/// returns \p image with its node section replaced by \p nodes
+std::vector<std::byte> with_nodes(std::vector<std::byte> image,
+                                  const std::vector<std::byte> &nodes) {
+  const std::uint64_t section[2] = {(image.size() + 7) & ~std::uint64_t(7),
+                                    nodes.size() / image_node_size};
+
+  image.resize(section[0]);
+  image.insert(image.end(), nodes.begin(), nodes.end());
+  std::memcpy(image.data() + image_nodes, section, sizeof(section));
+  return image;
+}
+
+/// checks that \p load rejects \p image
+template <class Load>
+void check_rejected(const std::string &what, std::span<const std::byte> image,
+                    Load load) {
+  try {
+    load(image);
+    fail(what, 0, "image accepted");
+  } catch (const std::exception &) {
+  }
+}
+
+/// checks that corruptions of the valid \p image are rejected
+template <class Load>
+void check_corrupt_images(const std::string &what,
+                          const std::vector<std::byte> &image, Load load) {
+  for (std::size_t len = 0; len < image.size(); ++len)
+    check_rejected(what + " truncated to " + std::to_string(len),
+                   std::span(image.data(), len), load);
+
+  // a node record after the last subtree
+  std::vector<std::byte> nodes = node_records(image);
+
+  nodes.insert(nodes.end(), nodes.end() - image_node_size, nodes.end());
+  check_rejected(what + " with an extra node", with_nodes(image, nodes), load);
+}
+
+/// number of applications of a rule with adaptive ordering; and/or
+///   operands are reordered after every 256 evaluations.
+constexpr std::size_t adaptive_applications = 1000;
+
+/// applies each of \p rules with adaptive ordering to \p rows in turn
+/// \details
+///    the results and the output of log must be those of source order
+///    evaluation (\p expected and \p logs, indexed by row and rule),
+///    also when the order changes and when operands throw.
+void check_adaptive(const std::vector<bjsn::value> &rules,
+                    const std::vector<bjsn::value> &rows,
+                    const std::vector<results> &expected,
+                    const std::vector<std::vector<std::string>> &logs) {
+  if (rows.empty())
+    return;
+
+  for (std::size_t i = 0; i < rules.size(); ++i) {
+    jsonlogic::logic_rule logic =
+        jsonlogic::create_logic(rules[i], config.options);
+    std::string logged;
+    jsonlogic::evaluation_context ctx = recording_context(logged);
+    const std::size_t failed = failures;
+
+    logic.adaptive_ordering(true);
+
+    // stop at the first difference of a rule
+    for (std::size_t k = 0; k < adaptive_applications && failures == failed;
+         ++k) {
+      const std::size_t row = k % rows.size();
+      auto acc = [&] { return jsonlogic::json_accessor(rows[row]); };
+
+      logged.clear();
+      check_result("adaptive rule", row, i, expected[row][i], try_apply([&] {
+                     return logic.apply(ctx, acc());
+                   }));
+
+      if (logged != logs[row][i])
+        fail("adaptive rule", row,
+             "rule " + std::to_string(i) + " log output differs: " + logged);
+    }
+  }
+}
+
+/// resolves variables with a json accessor and counts the requests of
+///   each non-computed variable
+struct counting_provider {
+  jsonlogic::variable_accessor &acc;
+  const std::vector<std::string_view> &names;
+  std::vector<std::size_t> requests;
+
+  jsonlogic::value_variant operator()(int idx) {
+    ++requests.at(idx);
+    return acc(jsonlogic::managed_string_view(names[idx]), idx);
+  }
+
+  jsonlogic::value_variant operator()(const jsonlogic::value_variant &key,
+                                      int idx) {
+    return acc(key, idx);
+  }
+};
+
+/// applies each of \p rules lazily to each of \p rows
+/// \details
+///    a variable must be requested at most once per evaluation, and only
+///    if an evaluation with a json accessor reads it, so variables of
+///    operands skipped by short-circuit evaluation are never requested.
+///    The results and the output of log must be \p expected and \p logs,
+///    and the statistics of the context must count the requests.
+void check_lazy(const std::vector<bjsn::value> &rules,
+                const std::vector<bjsn::value> &rows,
+                const std::vector<results> &expected,
+                const std::vector<std::vector<std::string>> &logs) {
+  for (std::size_t i = 0; i < rules.size(); ++i) {
+    jsonlogic::logic_rule logic =
+        jsonlogic::create_logic(rules[i], config.options);
+    const std::vector<std::string_view> &names = logic.variable_names();
+    const std::string what = "apply_lazy of rule " + std::to_string(i);
+    std::string logged;
+    jsonlogic::evaluation_context ctx = recording_context(logged);
+    std::size_t demanded = 0;
+
+    for (std::size_t row = 0; row < rows.size(); ++row) {
+      jsonlogic::variable_accessor acc = jsonlogic::json_accessor(rows[row]);
+      std::vector<bool> read(names.size(), false);
+      auto reading = [&](const jsonlogic::value_variant &key, int idx) {
+        if (idx >= 0)
+          read.at(idx) = true;
+
+        return acc(key, idx);
+      };
+      std::string ignored;
+      jsonlogic::evaluation_context reference = recording_context(ignored);
+
+      try_apply([&] { return logic.apply(reference, reading); });
+
+      counting_provider provider{acc, names,
+                                 std::vector<std::size_t>(names.size())};
+
+      logged.clear();
+      check_result("apply_lazy", row, i, expected[row][i], try_apply([&] {
+                     return logic.apply_lazy(ctx, provider);
+                   }));
+
+      if (logged != logs[row][i])
+        fail(what, row, "log output differs: " + logged);
+
+      for (std::size_t k = 0; k < names.size(); ++k) {
+        const std::string name(names[k]);
+
+        if (provider.requests[k] > 1)
+          fail(what, row, name + " requested more than once");
+        else if (provider.requests[k] == 0 && read[k])
+          fail(what, row, name + " not requested");
+        else if (provider.requests[k] == 1 && !read[k])
+          fail(what, row, name + " requested, but not read");
+
+        demanded += provider.requests[k];
+      }
+    }
+
+    const jsonlogic::evaluation_statistics &stats = ctx.statistics();
+
+    if (stats.evaluations != rows.size() ||
+        stats.slots != rows.size() * names.size() ||
+        stats.slots_demanded != demanded)
+      fail(what, 0,
+           "statistics " + std::to_string(stats.evaluations) + "/" +
+               std::to_string(stats.slots) + "/" +
+               std::to_string(stats.slots_demanded) + ", expected " +
+               std::to_string(rows.size()) + "/" +
+               std::to_string(rows.size() * names.size()) + "/" +
+               std::to_string(demanded));
+
+    ctx.reset_statistics();
+
+    if (ctx.statistics().evaluations != 0)
+      fail(what, 0, "statistics not reset");
+  }
+}
+
+/// evaluates each of \p rules for the elements of \p rows that provide
+///   all of its variables, row by row with a value array, and as a block
+///   of rows with apply_rows
+/// \details
+///    the results of apply with a value array must be \p expected.
+///    apply_rows must produce the results and the output of log of the
+///    row by row evaluations, or fail when a row fails. A stride below
+///    the number of variables must be rejected with std::logic_error.
+void check_rows(const std::vector<bjsn::value> &rules,
+                const std::vector<bjsn::value> &rows,
+                const std::vector<results> &expected) {
+  for (std::size_t i = 0; i < rules.size(); ++i) {
+    jsonlogic::logic_rule logic =
+        jsonlogic::create_logic(rules[i], config.options);
+
+    if (logic.has_computed_variable_names())
+      continue;
+
+    const std::vector<std::string_view> &names = logic.variable_names();
+    const std::string what = "apply_rows of rule " + std::to_string(i);
+
+    // one value between rows, so that rows are not adjacent
+    const std::size_t stride = names.size() + 1;
+    std::vector<jsonlogic::value_variant> matrix;
+    std::vector<std::size_t> used;
+
+    for (std::size_t row = 0; row < rows.size(); ++row) {
+      std::optional<std::vector<jsonlogic::value_variant>> values =
+          value_array(rows[row], names);
+
+      if (!values)
+        continue;
+
+      matrix.insert(matrix.end(), values->begin(), values->end());
+      matrix.emplace_back(nullptr);
+      used.push_back(row);
+    }
+
+    std::string logged;
+    jsonlogic::evaluation_context ctx = recording_context(logged);
+    results single;
+
+    for (std::size_t k = 0; k < used.size(); ++k) {
+      std::span<const jsonlogic::value_variant> vals(
+          matrix.data() + k * stride, names.size());
+
+      single.push_back(try_apply([&] { return logic.apply(ctx, vals); }));
+      check_result("apply(span)", used[k], i, expected[used[k]][i],
+                   single.back());
+    }
+
+    const std::string log = logged;
+    const bool fails = std::ranges::any_of(
+        single, [](const auto &res) { return !res.has_value(); });
+    std::vector<jsonlogic::value_variant> out(used.size());
+
+    logged.clear();
+
+    try {
+      logic.apply_rows(ctx, matrix.data(), used.size(), stride, out.data());
+
+      if (fails)
+        fail(what, 0, "no error although a row fails");
+
+      for (std::size_t k = 0; k < used.size() && !fails; ++k)
+        check_result(what, used[k], i, single[k], out[k]);
+
+      if (!fails && logged != log)
+        fail(what, 0, "log output differs: " + logged);
+    } catch (const std::exception &ex) {
+      if (!fails)
+        fail(what, 0, std::string("unexpected error: ") + ex.what());
+    }
+
+    if (names.empty())
+      continue;
+
+    // the stride is checked before any row is evaluated
+    try {
+      logic.apply_rows(matrix.data(), 0, names.size() - 1, out.data());
+      fail(what, 0, "stride below the number of variables accepted");
+    } catch (const std::logic_error &) {
+    }
+  }
+}
+
+/// evaluates \p rules for each element of \p rows, individually and together
+void check_rules(const std::vector<bjsn::value> &rules,
+                 const std::vector<bjsn::value> &rows,
+                 std::optional<std::size_t> indexed) {
+  std::vector<jsonlogic::logic_rule> logics;
+  std::vector<jsonlogic::logic_rule> loaded_logics;
+
+  for (const bjsn::value &rule : rules) {
+    logics.push_back(jsonlogic::create_logic(rule, config.options));
+
+    const std::vector<std::byte> image = jsonlogic::save_image(logics.back());
+
+    loaded_logics.push_back(jsonlogic::load_logic(image, config.options));
+    check_corrupt_images("rule image", image, [](auto img) {
+      return jsonlogic::load_logic(img, config.options);
+    });
+    check_rejected("rule image as rule_set", image, [](auto img) {
+      return jsonlogic::load_rule_set(img, config.options);
+    });
+  }
+
+  jsonlogic::rule_set set = jsonlogic::create_rule_set(rules, config.options);
+  jsonlogic::rule_set loaded =
+      jsonlogic::load_rule_set(jsonlogic::save_image(set), config.options);
+
+  if (config.verbose)
+    std::cerr << rules.size() << " rules, " << set.indexed_rules()
+              << " indexed, " << set.variable_names().size() << " variables"
+              << std::endl;
+
+  // without optimizations, no rule is indexed
+  if (ENABLE_OPTIMIZATIONS && indexed && set.indexed_rules() != *indexed)
+    fail("indexed_rules", 0,
+         "expected " + std::to_string(*indexed) + ", got " +
+             std::to_string(set.indexed_rules()));
+
+  if (loaded.indexed_rules() != set.indexed_rules())
+    fail("indexed_rules of the loaded image", 0, "differs");
+
+  // rules that share subtrees or compiled rules must evaluate alike
+  jsonlogic::rule_store store;
+  jsonlogic::rule_cache cache(
+      rules.size(), jsonlogic::rule_cache_options{.logic = config.options});
+  jsonlogic::rule_cache commutative(rules.size(),
+                                    jsonlogic::rule_cache_options{
+                                        .commutative = true,
+                                        .logic = config.options});
+  std::vector<jsonlogic::logic_rule> stored;
+  std::vector<std::shared_ptr<jsonlogic::logic_rule>> cached;
+
+  for (const bjsn::value &rule : rules) {
+    stored.push_back(store.create_logic(rule));
+    cached.push_back(cache.create_logic(rule));
+    cached.push_back(commutative.create_logic(rule));
+  }
+
+  std::vector<results> row_results;
+  std::vector<std::vector<std::string>> row_logs;
+
+  for (std::size_t row = 0; row < rows.size(); ++row) {
+    const bjsn::value &data = rows[row];
+    std::string logged;
+    jsonlogic::evaluation_context ctx = recording_context(logged);
+    results expected;
+    std::vector<std::string> logs;
+
+    for (jsonlogic::logic_rule &logic : logics) {
+      logged.clear();
+      expected.push_back(try_apply(
+          [&] { return logic.apply(ctx, jsonlogic::json_accessor(data)); }));
+      logs.push_back(logged);
+    }
+
+    check_set("rule_set", set, row, data, expected, logs);
+    check_set("loaded rule_set", loaded, row, data, expected, logs);
+
+    // when rules fail, the rules that succeed are checked in a set of their own
+    if (std::ranges::any_of(expected,
+                            [](const auto &res) { return !res.has_value(); })) {
+      std::vector<bjsn::value> succeeding;
+      results subset;
+      std::vector<std::string> subset_logs;
+
+      for (std::size_t i = 0; i < rules.size(); ++i) {
+        if (!expected[i])
+          continue;
+
+        succeeding.push_back(rules[i]);
+        subset.push_back(expected[i]);
+        subset_logs.push_back(logs[i]);
+      }
+
+      jsonlogic::rule_set part =
+          jsonlogic::create_rule_set(succeeding, config.options);
+
+      check_set("succeeding rules", part, row, data, subset, subset_logs);
+    }
+
+    for (std::size_t i = 0; i < rules.size(); ++i) {
+      auto acc = [&] { return jsonlogic::json_accessor(data); };
+
+      // results and log output must be those of the rule
+      auto check = [&](const std::string &what, auto apply) {
+        logged.clear();
+        check_result(what, row, i, expected[i], try_apply(apply));
+
+        if (logged != logs[i])
+          fail(what, row, "log output differs: " + logged);
+      };
+
+      check("loaded rule", [&] { return loaded_logics[i].apply(ctx, acc()); });
+      check("rule_store", [&] { return stored[i].apply(ctx, acc()); });
+      check("rule_cache", [&] { return cached[2 * i]->apply(ctx, acc()); });
+      check("commutative rule_cache",
+            [&] { return cached[2 * i + 1]->apply(ctx, acc()); });
+    }
+
+    row_results.push_back(std::move(expected));
+    row_logs.push_back(std::move(logs));
+  }
+
+  check_adaptive(rules, rows, row_results, row_logs);
+  check_lazy(rules, rows, row_results, row_logs);
+  check_rows(rules, rows, row_results);
+}
+
+bjsn::value parse_file(const std::string &filename) {
+  std::ifstream is{filename};
+
+  if (!is)
+    throw std::runtime_error("cannot open " + filename);
+
+  std::stringstream text;
+
+  text << is.rdbuf();
+  return bjsn::parse(text.str());
+}
+
+/// checks a file with {"rules": [...], "data": [...]}
+void run_file(const std::string &filename) {
+  const bjsn::value test = parse_file(filename);
+  const bjsn::object &obj = test.as_object();
+  const bjsn::array &rules = obj.at("rules").as_array();
+  const bjsn::array &rows = obj.at("data").as_array();
+  std::optional<std::size_t> indexed;
+
+  if (const bjsn::value *num = obj.if_contains("indexed"))
+    indexed = std::size_t(num->as_int64());
+
+  const std::vector<bjsn::value> all(rules.begin(), rules.end());
+
+  check_rules(all, std::vector<bjsn::value>(rows.begin(), rows.end()),
+              indexed);
+
+  const std::vector<std::byte> image =
+      jsonlogic::save_image(jsonlogic::create_rule_set(all, config.options));
+
+  check_corrupt_images("rule_set image", image, [](auto img) {
+    return jsonlogic::load_rule_set(img, config.options);
+  });
+  check_rejected("rule_set image as rule", image, [](auto img) {
+    return jsonlogic::load_logic(img, config.options);
+  });
+}
+
+/// checks the rules of the test files in \p dir as one rule_set
+void run_corpus(const std::string &dir) {
+  std::vector<std::filesystem::path> files;
+
+  for (const auto &entry : std::filesystem::directory_iterator(dir))
+    if (entry.path().extension() == ".json")
+      files.push_back(entry.path());
+
+  // a stable order of the rules
+  std::ranges::sort(files);
+
+  std::vector<bjsn::value> rules;
+  std::vector<bjsn::value> rows;
+
+  for (const std::filesystem::path &file : files) {
+    const bjsn::value test = parse_file(file.string());
+    const bjsn::object &obj = test.as_object();
+    const bjsn::value &rule = obj.at("rule");
+
+    // the data of the test is used, even if the rule cannot be created
+    rows.push_back(obj.contains("data") ? obj.at("data")
+                                        : bjsn::value(bjsn::object()));
+
+    try {
+      jsonlogic::create_logic(rule, config.options);
+      rules.push_back(rule);
+    } catch (const std::exception &) {
+    }
+  }
+
+  check_rules(rules, rows, std::nullopt);
+}
+
+/// checks \p n rules that each read their own variable
+void run_wide(std::size_t n) {
+  std::vector<bjsn::value> rules;
+  bjsn::object row;
+
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::string name = "v" + std::to_string(i);
+    bjsn::object var, test;
+    bjsn::array args;
+
+    var["var"] = name;
+    args.push_back(std::move(var));
+    args.push_back(std::int64_t(i));
+    test["=="] = std::move(args);
+    rules.push_back(std::move(test));
+    row[name] = std::int64_t(i);
+  }
+
+  jsonlogic::rule_set set = jsonlogic::create_rule_set(rules, config.options);
+  const bjsn::value data(std::move(row));
+  const results expected(n, jsonlogic::value_variant(true));
+  const std::vector<std::string> logs(n);
+
+  check_set("rule_set", set, 0, data, expected, logs);
+}
+
+/// returns the rule {"!": ... {"!": {"var": "x"}}} with \p depth operators
+bjsn::value nested_rule(std::size_t depth) {
+  bjsn::object var;
+
+  var["var"] = "x";
+
+  bjsn::value res(std::move(var));
+
+  for (std::size_t i = 0; i < depth; ++i) {
+    bjsn::object op;
+
+    op["!"] = std::move(res);
+    res = std::move(op);
+  }
+
+  return res;
+}
+
+/// checks images of deeply nested rules
+void run_deep() {
+  bjsn::object row;
+
+  row["x"] = 1;
+
+  const bjsn::value data(std::move(row));
+  jsonlogic::logic_rule rule =
+      jsonlogic::create_logic(nested_rule(1000), config.options);
+  const std::vector<std::byte> image = jsonlogic::save_image(rule);
+  jsonlogic::logic_rule loaded = jsonlogic::load_logic(image, config.options);
+  std::string logged;
+  jsonlogic::evaluation_context ctx = recording_context(logged);
+
+  check_result("loaded deep rule", 0, 0,
+               rule.apply(ctx, jsonlogic::json_accessor(data)),
+               loaded.apply(ctx, jsonlogic::json_accessor(data)));
+
+  try {
+    jsonlogic::save_image(
+        jsonlogic::create_logic(nested_rule(5000), config.options));
+    fail("save_image", 0, "a rule nested 5000 levels deep was stored");
+  } catch (const std::length_error &) {
+  }
+
+  // a million nested ! in front of the var node
+  const std::vector<std::byte> nodes = node_records(image);
+  std::vector<std::byte> deep;
+
+  deep.reserve(1000000 * image_node_size + nodes.size());
+
+  for (std::size_t i = 0; i < 1000000; ++i)
+    deep.insert(deep.end(), nodes.begin(), nodes.begin() + image_node_size);
+
+  deep.insert(deep.end(), nodes.begin(), nodes.end());
+  check_rejected("deeply nested image", with_nodes(image, deep),
+                 [](auto img) {
+                   return jsonlogic::load_logic(img, config.options);
+                 });
+}
+
+} // namespace
+
+int main(int argc, const char **argv) try {
+  std::vector<std::string> arguments(argv + 1, argv + argc);
+  std::size_t argn = 0;
+
+  for (; argn < arguments.size() && arguments[argn].starts_with("-"); ++argn) {
+    const std::string &arg = arguments[argn];
+
+    if (arg == "-v" || arg == "--verbose")
+      config.verbose = true;
+    else if (arg == "-q" || arg == "--quiet")
+      config.quiet = true;
+    else if (arg == "--arena")
+      config.options.arena = true;
+    else if (arg == "--corpus" && argn + 1 < arguments.size())
+      run_corpus(arguments[++argn]);
+    else if (arg == "--wide" && argn + 1 < arguments.size())
+      run_wide(boost::lexical_cast<std::size_t>(arguments[++argn]));
+    else if (arg == "--deep")
+      run_deep();
+    else
+      throw std::runtime_error("unrecognized argument: " + arg);
+  }
+
+  for (; argn < arguments.size(); ++argn)
+    run_file(arguments[argn]);
+
+  if (failures && !config.quiet)
+    std::cerr << failures << " check(s) failed" << std::endl;
+
+  return failures != 0;
+} catch (const std::exception &ex) {
+  std::cerr << "test failed: " << ex.what() << std::endl;
+  return 1;
+}